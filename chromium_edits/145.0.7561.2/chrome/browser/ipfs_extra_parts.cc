@@ -1,5 +1,8 @@
 #include "ipfs_extra_parts.h"
 
+#include "browser_process.h"
+#include "ipfs_omnibox_prefetch.h"
+#include "net/system_network_context_manager.h"
 #include "profiles/profile.h"
 
 #include <components/ipfs/inter_request_state.h>
@@ -7,4 +10,12 @@
 void IpfsExtraParts::PostProfileInit(Profile* profile, bool /* is_initial_profile */ ) {
   DCHECK(profile);
   ipfs::InterRequestState::CreateForBrowserContext(profile, profile->GetPrefs());
+  // The same ones the Interceptor hands over on each load, but prefetches
+  //   can come before any ipfs:// load has happened.
+  if (auto* net = g_browser_process->system_network_context_manager()) {
+    auto& state = ipfs::InterRequestState::FromBrowserContext(profile);
+    state.http_loader_factory(net->GetURLLoaderFactory());
+    state.network_context(net->GetContext());
+  }
+  IpfsOmniboxPrefetch::AttachTo(profile);
 }
@@ -0,0 +1,74 @@
+#include "ipfs_omnibox_prefetch.h"
+
+#include "autocomplete/autocomplete_controller_emitter_factory.h"
+#include "profiles/profile.h"
+
+#include <base/functional/bind.h>
+#include <base/memory/ptr_util.h>
+#include <components/ipfs/inter_request_state.h>
+#include <components/omnibox/browser/autocomplete_match.h>
+#include <components/omnibox/browser/autocomplete_result.h>
+
+#include <utility>
+
+namespace {
+char const kUserDataKey[] = "ipfs_omnibox_prefetch";
+}
+
+void IpfsOmniboxPrefetch::AttachTo(Profile* profile) {
+  DCHECK(profile);
+  if (profile->GetUserData(kUserDataKey)) {
+    return;
+  }
+  profile->SetUserData(kUserDataKey,
+                       base::WrapUnique(new IpfsOmniboxPrefetch(profile)));
+}
+IpfsOmniboxPrefetch::IpfsOmniboxPrefetch(Profile* profile)
+    : profile_{profile} {
+  profile_observation_.Observe(profile);
+  if (auto* emitter =
+          AutocompleteControllerEmitterFactory::GetForBrowserContext(profile)) {
+    omnibox_.Observe(emitter);
+  }
+}
+IpfsOmniboxPrefetch::~IpfsOmniboxPrefetch() = default;
+
+void IpfsOmniboxPrefetch::OnResultChanged(AutocompleteController* controller,
+                                          bool default_match_changed) {
+  if (!default_match_changed || !controller) {
+    return;
+  }
+  auto* match = controller->result().default_match();
+  pending_ = match ? match->destination_url : GURL{};
+  // Each keystroke changes it; restarting the timer waits out the typing.
+  //   Unretained: the timer belongs to this.
+  settle_.Start(FROM_HERE, kSettle,
+                base::BindOnce(&IpfsOmniboxPrefetch::Settled,
+                               base::Unretained(this)));
+}
+void IpfsOmniboxPrefetch::Settled() {
+  auto url = std::exchange(pending_, GURL{});
+  if (url == hinted_) {
+    return;
+  }
+  using ipfs::Prefetcher;
+  if (hinted_.is_valid() &&
+      Prefetcher::RootOf(url) == Prefetcher::RootOf(hinted_)) {
+    // Another page under the same root: that's what's being prefetched.
+    hinted_ = url;
+    return;
+  }
+  auto& prefetcher =
+      ipfs::InterRequestState::FromBrowserContext(profile_).prefetcher();
+  // Typing on past the hinted URL, to something else entirely.
+  if (hinted_.is_valid()) {
+    prefetcher.Cancel(hinted_);
+  }
+  hinted_ = prefetcher.Prefetch(url) ? url : GURL{};
+}
+void IpfsOmniboxPrefetch::OnProfileWillBeDestroyed(Profile*) {
+  // The emitter is a keyed service, gone before the profile's user data.
+  omnibox_.Reset();
+  profile_observation_.Reset();
+  settle_.Stop();
+}
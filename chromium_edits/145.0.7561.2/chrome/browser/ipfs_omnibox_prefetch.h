@@ -0,0 +1,58 @@
+#ifndef IPFS_OMNIBOX_PREFETCH_H_
+#define IPFS_OMNIBOX_PREFETCH_H_
+
+#include <base/memory/raw_ptr.h>
+#include <base/scoped_observation.h>
+#include <base/supports_user_data.h>
+#include <base/time/time.h>
+#include <base/timer/timer.h>
+#include <chrome/browser/profiles/profile_observer.h>
+#include <components/omnibox/browser/autocomplete_controller.h>
+#include <components/omnibox/browser/autocomplete_controller_emitter.h>
+#include <url/gurl.h>
+
+class Profile;
+
+/*! Hints the profile's IPFS prefetcher with the omnibox's default match
+ *  \details Once the default match has settled (stayed the same for
+ *    kSettle) on an ipfs:// or ipns:// URL, its root is prefetched - not
+ *    every partial name typed on the way there. The previous hint is
+ *    cancelled when a match with a different root of any kind settles.
+ *    A hint isn't cancelled just because the omnibox closed: that's usually
+ *    the navigation it was for starting. Owned by the profile, and detached
+ *    from the omnibox before the profile's services go away.
+ */
+class IpfsOmniboxPrefetch : public base::SupportsUserData::Data,
+                            public AutocompleteController::Observer,
+                            public ProfileObserver {
+ public:
+  /*! How long the default match must stay put to be worth a prefetch */
+  static constexpr base::TimeDelta kSettle = base::Milliseconds(300);
+
+  static void AttachTo(Profile*);
+  ~IpfsOmniboxPrefetch() override;
+
+  // AutocompleteController::Observer
+  void OnResultChanged(AutocompleteController*,
+                       bool default_match_changed) override;
+
+  // ProfileObserver
+  void OnProfileWillBeDestroyed(Profile*) override;
+
+ private:
+  raw_ptr<Profile> profile_;
+  GURL hinted_;
+  /*! The default match waiting to settle */
+  GURL pending_;
+  base::OneShotTimer settle_;
+  base::ScopedObservation<AutocompleteControllerEmitter,
+                          AutocompleteController::Observer>
+      omnibox_{this};
+  base::ScopedObservation<Profile, ProfileObserver> profile_observation_{this};
+
+  explicit IpfsOmniboxPrefetch(Profile*);
+
+  void Settled();
+};
+
+#endif  // IPFS_OMNIBOX_PREFETCH_H_
@@ -2,44 +2,145 @@
 
 #include <ipfs_client/cid.h>
 #include <ipfs_client/identity_cid.h>
+#include <base/containers/lru_cache.h>
 #include <base/logging.h>
+#include <base/no_destructor.h>
+#include <base/strings/utf_string_conversions.h>
+#include <base/synchronization/lock.h>
 
+#include <algorithm>
+#include <optional>
 #include <sstream>
 
-bool url::CanonicalizeIpfsURL(std::string_view spec,
-                              const Parsed& parsed,
-                              SchemeType scheme_type,
-                              CharsetConverter* charset_converter,
-                              CanonOutput* output,
-                              Parsed* output_parsed) {
-  if (spec.size() < 1) {
+namespace {
+/*! Host as written -> host as Cid::to_string() writes it
+ *  \details The same few roots get canonicalized over and over: every GURL
+ *    built for a navigation or subresource. Any thread may build a GURL.
+ */
+class CanonicalHosts {
+ public:
+  static constexpr std::size_t kMaxEntries = 512UL;
+
+  std::optional<std::string> Get(std::string_view host) {
+    base::AutoLock lock{lock_};
+    auto it = memo_.Get(std::string{host});
+    if (it == memo_.end()) {
+      return std::nullopt;
+    }
+    return it->second;
+  }
+  void Put(std::string_view host, std::string canonical) {
+    base::AutoLock lock{lock_};
+    memo_.Put(std::string{host}, std::move(canonical));
+  }
+
+ private:
+  base::Lock lock_;
+  base::HashingLRUCache<std::string, std::string> memo_{kMaxEntries};
+};
+/*! \brief Already how Cid::to_string() would write it: CIDv1 in base32
+ *  \details Checked without decoding. A CIDv1 in base32 is 'b' then the
+ *    version byte 0x01: its top 5 bits make 'a', and its low 3 bits start
+ *    the next character, so that's one of 'e'-'h'. After that it is the
+ *    lower-case base32 alphabet, at a length some whole number of bytes
+ *    can encode to, with the bits left over in the last character zero.
+ *    Whether the codec and multihash within make sense is left to whoever
+ *    loads it, as for any other CID.
+ */
+bool LooksCanonical(std::string_view host) {
+  if (host.size() < 8UL || !host.starts_with("ba") || host[2] < 'e' ||
+      host[2] > 'h') {
     return false;
   }
-  if ( parsed.host.len < 1 ) {
+  // Bits of padding in the last character, by the length of the base32
+  //   after the multibase prefix, mod 8. -1: no whole number of bytes.
+  constexpr int kUnusedBits[] = {0, -1, 2, -1, 4, 1, -1, 3};
+  auto unused = kUnusedBits[(host.size() - 1UL) % 8UL];
+  if (unused < 0) {
+    return false;
+  }
+  auto base32 = [](char c) {
+    return (c >= 'a' && c <= 'z') || (c >= '2' && c <= '7');
+  };
+  if (!std::all_of(host.begin(), host.end(), base32)) {
     return false;
   }
-  auto cid_str = spec.substr( parsed.host.begin, static_cast<std::size_t>(parsed.host.len) );
-  auto cid = ipfs::Cid(cid_str);
+  auto last = host.back();
+  auto value = last >= 'a' ? last - 'a' : last - '2' + 26;
+  return (value & ((1 << unused) - 1)) == 0;
+}
+std::string CanonicalHost(std::string_view host) {
+  static base::NoDestructor<CanonicalHosts> memo;
+  if (auto hit = memo->Get(host)) {
+    return *hit;
+  }
+  auto cid = ipfs::Cid(host);
   if ( !cid.valid() ) {
-    cid = ipfs::id_cid::forText( std::string{cid_str} + " is not a valid CID." );
+    cid = ipfs::id_cid::forText( std::string{host} + " is not a valid CID." );
+  }
+  auto rv = cid.to_string();
+  if (!rv.empty()) {
+    memo->Put(host, rv);
+  }
+  return rv;
+}
+/*! parsed, for the same spec but with a host host_len long */
+url::Parsed WithHostLength(url::Parsed parsed, int host_len) {
+  auto delta = host_len - parsed.host.len;
+  parsed.host.len = host_len;
+  for (auto* after : {&parsed.port, &parsed.path, &parsed.query, &parsed.ref}) {
+    if (after->is_valid()) {
+      after->begin += delta;
+    }
   }
-  auto as_str = cid.to_string();
-  if ( as_str.empty() ) {
+  return parsed;
+}
+std::string Narrow(std::string_view host) {
+  return std::string{host};
+}
+std::string Narrow(std::u16string_view host) {
+  // CIDs are ASCII, but convert properly in case someone's typed something
+  //   else: it gets quoted in the error.
+  return base::UTF16ToUTF8(host);
+}
+/*! \brief Either width. Only the host is ever converted to 8-bit, so a
+ *    16-bit spec stays 16-bit and isn't copied unless the host changes.
+ */
+template <class CHAR>
+bool DoCanonicalizeIpfsURL(std::basic_string_view<CHAR> spec,
+                           const url::Parsed& parsed,
+                           url::SchemeType scheme_type,
+                           url::CharsetConverter* charset_converter,
+                           url::CanonOutput* output,
+                           url::Parsed* output_parsed) {
+  if (spec.size() < 1) {
+    return false;
+  }
+  if ( parsed.host.len < 1 ) {
     return false;
   }
-  std::string stdurl{ spec.substr(0UL, static_cast<std::size_t>(parsed.host.begin)) };
-  // LOG(ERROR) << "stdurl starts as '" << stdurl
-  //            << "' before I append '" << as_str
-  //            << "' while the CID string was '" << cid_str
-  //            << "' parsed.host: len=" << parsed.host.len << " begin=" << parsed.host.begin
-  //            << " parsed.host.end=" << parsed.host.end();
-  stdurl.append( as_str );
+  auto cid_str = Narrow(spec.substr( parsed.host.begin, static_cast<std::size_t>(parsed.host.len) ));
+  std::string as_str;
+  if (!LooksCanonical(cid_str)) {
+    as_str = CanonicalHost(cid_str);
+    if (as_str.empty()) {
+      return false;
+    }
+  }
+  if (as_str.empty() || as_str == cid_str) {
+    // Host stays as it is, so nothing to splice in.
+    return url::CanonicalizeStandardUrl(spec.data(), parsed, scheme_type,
+                                        charset_converter, output,
+                                        output_parsed);
+  }
+  std::basic_string<CHAR> stdurl{ spec.substr(0UL, static_cast<std::size_t>(parsed.host.begin)) };
+  stdurl.append( as_str.begin(), as_str.end() );
   spec.remove_prefix(parsed.host.end());
   stdurl.append(spec);
-  auto len = static_cast<int>(stdurl.size());
-  Parsed parsed_input;
-  ParseStandardURL(stdurl.data(), len, &parsed_input);
-  return CanonicalizeStandardUrl(
+  // Everything after the host just moved over: no need to parse it again.
+  auto parsed_input =
+      WithHostLength(parsed, static_cast<int>(as_str.size()));
+  return url::CanonicalizeStandardUrl(
       stdurl.data(),
       parsed_input,
       scheme_type,
@@ -47,21 +148,16 @@ bool url::CanonicalizeIpfsURL(std::string_view spec,
       output, output_parsed
     );
 }
-namespace {
-
-using from_view = bool (*)(std::u16string_view, url::CanonOutput*);
-using from_ptr = bool (*)(char16_t const*, std::size_t, url::CanonOutput*);
-
-#pragma clang diagnostic push
-#pragma clang diagnostic ignored "-Wunused-function"
-void do_convert(from_view foo, std::u16string_view input, url::CanonOutput* output) {
-  foo(input, output);
-}
-void do_convert(from_ptr foo, std::u16string_view input, url::CanonOutput* output) {
-  foo(input.data(), input.size(), output);
-}
-#pragma clang diagnostic pop
+}  // namespace
 
+bool url::CanonicalizeIpfsURL(std::string_view spec,
+                              const Parsed& parsed,
+                              SchemeType scheme_type,
+                              CharsetConverter* charset_converter,
+                              CanonOutput* output,
+                              Parsed* output_parsed) {
+  return DoCanonicalizeIpfsURL(spec, parsed, scheme_type, charset_converter,
+                               output, output_parsed);
 }
 bool url::CanonicalizeIpfsURL(std::basic_string_view<char16_t> spec,
                               const Parsed& parsed,
@@ -69,8 +165,6 @@ bool url::CanonicalizeIpfsURL(std::basic_string_view<char16_t> spec,
                               CharsetConverter* query_converter,
                               CanonOutput* output,
                               Parsed* new_parsed) {
-  RawCanonOutput<2048> as8;
-  do_convert(&ConvertUTF16ToUTF8, spec, &as8);
-  return CanonicalizeIpfsURL({as8.data(), as8.length()}, parsed, scheme_type,
-                             query_converter, output, new_parsed);
+  return DoCanonicalizeIpfsURL(spec, parsed, scheme_type, query_converter,
+                               output, new_parsed);
 }
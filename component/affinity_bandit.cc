@@ -0,0 +1,115 @@
+#include "affinity_bandit.h"
+
+#include <base/rand_util.h>
+
+#include <algorithm>
+#include <cmath>
+
+using Self = ipfs::AffinityBandit;
+
+namespace {
+/*! Weight of each observation in the typical time */
+constexpr double kTypicalWeight = 0.05;
+}  // namespace
+
+Self::AffinityBandit() : AffinityBandit(base::RandUint64()) {}
+Self::AffinityBandit(std::uint64_t seed) : rng_{seed} {}
+Self::~AffinityBandit() noexcept = default;
+
+void Self::Record(std::string_view gateway,
+                  gw::GatewayRequestType typ,
+                  int status,
+                  base::TimeDelta total,
+                  std::size_t bytes) {
+  auto reward = 0.0;
+  if (status / 100 == 2) {
+    auto units = std::max(1.0, static_cast<double>(bytes) / kUnitBytes);
+    auto mine = std::max(total.InMillisecondsF(), 1.0) / units;
+    auto [it, fresh] = typical_ms_.emplace(typ, mine);
+    if (!fresh) {
+      it->second += kTypicalWeight * (mine - it->second);
+    }
+    // Typical speed earns 0.75; much faster approaches 1, much slower 0.5.
+    reward = 0.5 + 0.5 * it->second / (it->second + mine);
+  }
+  auto g = arms_.find(gateway);
+  if (g == arms_.end()) {
+    g = arms_.emplace(std::string{gateway}, ByType{}).first;
+  }
+  auto& arm = g->second[typ];
+  // Decay toward the uniform prior, Beta(1,1).
+  arm.alpha = 1.0 + (arm.alpha - 1.0) * kDecay + reward;
+  arm.beta = 1.0 + (arm.beta - 1.0) * kDecay + (1.0 - reward);
+  changed_[g->first] = ++generation_;
+}
+std::size_t Self::generation(std::string_view gateway) const {
+  auto it = changed_.find(gateway);
+  return it == changed_.end() ? 0UL : it->second;
+}
+base::Value::Dict Self::ToDict(std::string_view gateway) const {
+  base::Value::Dict result;
+  auto g = arms_.find(gateway);
+  if (g == arms_.end()) {
+    return result;
+  }
+  for (auto& [typ, arm] : g->second) {
+    base::Value::List ab;
+    ab.Append(arm.alpha);
+    ab.Append(arm.beta);
+    result.Set(name(typ), std::move(ab));
+  }
+  return result;
+}
+void Self::Load(std::string_view gateway, base::Value::Dict const& dict) {
+  ByType loaded;
+  for (auto [k, v] : dict) {
+    auto typ = gw::from_name(k);
+    auto* ab = v.GetIfList();
+    if (!typ || !ab || ab->size() != 2UL) {
+      continue;
+    }
+    auto a = (*ab)[0].GetIfDouble();
+    auto b = (*ab)[1].GetIfDouble();
+    // Beta(1,1) is the prior; nothing decays below it.
+    if (a && b && *a >= 1.0 && *b >= 1.0) {
+      loaded[*typ] = Arm{*a, *b};
+    }
+  }
+  if (loaded.empty()) {
+    return;
+  }
+  auto& arms = arms_[std::string{gateway}];
+  for (auto& [typ, arm] : loaded) {
+    arms[typ] = arm;
+  }
+  changed_[std::string{gateway}] = ++generation_;
+}
+auto Self::Find(std::string_view gateway, gw::GatewayRequestType typ) const
+    -> Arm const* {
+  auto g = arms_.find(gateway);
+  if (g == arms_.end()) {
+    return nullptr;
+  }
+  auto a = g->second.find(typ);
+  return a == g->second.end() ? nullptr : &a->second;
+}
+std::optional<int> Self::Sample(std::string_view gateway,
+                                gw::GatewayRequestType typ) {
+  auto* arm = Find(gateway, typ);
+  if (!arm) {
+    return std::nullopt;
+  }
+  // Beta(a,b) is X/(X+Y) for X ~ Gamma(a), Y ~ Gamma(b).
+  auto x = std::gamma_distribution<double>{arm->alpha}(rng_);
+  auto y = std::gamma_distribution<double>{arm->beta}(rng_);
+  auto theta = x + y > 0.0 ? x / (x + y) : 0.5;
+  auto a = std::lround((theta - 0.5) * 2.0 * kSpread);
+  return std::clamp(static_cast<int>(a), -kSpread, kSpread);
+}
+std::optional<double> Self::Mean(std::string_view gateway,
+                                 gw::GatewayRequestType typ) const {
+  if (auto* arm = Find(gateway, typ)) {
+    return arm->alpha / (arm->alpha + arm->beta);
+  }
+  return std::nullopt;
+}
@@ -0,0 +1,98 @@
+#ifndef IPFS_AFFINITY_BANDIT_H_
+#define IPFS_AFFINITY_BANDIT_H_
+
+#include <ipfs_client/gw/gateway_request_type.h>
+
+#include <base/time/time.h>
+#include <base/values.h>
+
+#include <cstdint>
+#include <map>
+#include <optional>
+#include <random>
+#include <string>
+#include <string_view>
+
+namespace ipfs {
+
+/*! Learns which gateways are good at which types of request
+ *  \details A Thompson-sampling bandit with one arm per (gateway, request
+ *    type). Each arm is a Beta posterior over how rewarding a request there
+ *    is: failure scores 0, success 0.5-1 depending on how its time per unit
+ *    of data compares to what's typical for that type. Old evidence decays,
+ *    so a gateway that changes behaviour is noticed. Owned by
+ *    InterRequestState, fed by ChromiumHttp, sampled by
+ *    ChromiumIpfsGatewayConfig when ranking gateways. The posteriors are
+ *    what gets persisted, never the samples.
+ */
+class AffinityBandit {
+ public:
+  /*! Weight kept by older observations at each new one */
+  static constexpr double kDecay = 0.98;
+  /*! Affinities written are in [-kSpread, kSpread] */
+  static constexpr int kSpread = 4;
+  /*! Bodies are judged per this much data, so big ones aren't penalized */
+  static constexpr std::size_t kUnitBytes = 64UL * 1024UL;
+
+  /*! Randomly seeded */
+  AffinityBandit();
+  /*! Deterministic: the same seed & observations give the same samples */
+  explicit AffinityBandit(std::uint64_t seed);
+  ~AffinityBandit() noexcept;
+
+  AffinityBandit(AffinityBandit const&) = delete;
+  AffinityBandit& operator=(AffinityBandit const&) = delete;
+
+  /*! \brief Note the outcome of a request
+   *  \param gateway \see GatewayThrottle::GatewayKey
+   *  \param status HTTP status, or one synthesized for a network error
+   *  \param total Time from sending to the end of the body
+   *  \param bytes Size of the body
+   */
+  void Record(std::string_view gateway,
+              gw::GatewayRequestType,
+              int status,
+              base::TimeDelta total,
+              std::size_t bytes);
+
+  /*! \brief Draw from the arm's posterior
+   *  \return An affinity, or nullopt if nothing has been observed
+   */
+  std::optional<int> Sample(std::string_view gateway, gw::GatewayRequestType);
+
+  /*! \return The posterior mean reward, if anything has been observed */
+  std::optional<double> Mean(std::string_view gateway,
+                             gw::GatewayRequestType) const;
+
+  /*! \brief Incremented on every observation */
+  std::size_t generation() const { return generation_; }
+
+  /*! \return generation() as of this gateway's last change, or 0 */
+  std::size_t generation(std::string_view gateway) const;
+
+  /*! \brief Serialize a gateway's arms, for preferences
+   *  \return Request type name -> [alpha, beta], or empty if none
+   */
+  base::Value::Dict ToDict(std::string_view gateway) const;
+
+  /*! \brief Restore what ToDict produced */
+  void Load(std::string_view gateway, base::Value::Dict const&);
+
+ private:
+  struct Arm {
+    double alpha = 1.0;
+    double beta = 1.0;
+  };
+  using ByType = std::map<gw::GatewayRequestType, Arm>;
+  std::map<std::string, ByType, std::less<>> arms_;
+  std::map<std::string, std::size_t, std::less<>> changed_;
+  /*! Moving average of milliseconds per unit, over all gateways */
+  std::map<gw::GatewayRequestType, double> typical_ms_;
+  std::mt19937_64 rng_;
+  std::size_t generation_ = 0UL;
+
+  Arm const* Find(std::string_view, gw::GatewayRequestType) const;
+};
+}  // namespace ipfs
+
+#endif  // IPFS_AFFINITY_BANDIT_H_
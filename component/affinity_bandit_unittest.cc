@@ -0,0 +1,76 @@
+#include "affinity_bandit.h"
+
+#include <gtest/gtest.h>
+
+using T = ipfs::gw::GatewayRequestType;
+
+namespace {
+constexpr char kGw[] = "https://gw.example/";
+constexpr char kOther[] = "https://other.example/";
+}  // namespace
+
+TEST(AffinityBanditTest, UnknownArmsAreLeftAlone) {
+  ipfs::AffinityBandit b{1U};
+  EXPECT_FALSE(b.Sample(kGw, T::Block));
+  EXPECT_FALSE(b.Mean(kGw, T::Block));
+  b.Record(kGw, T::Block, 200, base::Milliseconds(50), 1024U);
+  EXPECT_TRUE(b.Sample(kGw, T::Block));
+  EXPECT_FALSE(b.Sample(kGw, T::Ipns));
+  EXPECT_FALSE(b.Sample(kOther, T::Block));
+}
+
+TEST(AffinityBanditTest, SameSeedSameSamples) {
+  ipfs::AffinityBandit a{42U};
+  ipfs::AffinityBandit b{42U};
+  for (auto i = 0; i < 20; ++i) {
+    auto status = i % 3 ? 200 : 504;
+    a.Record(kGw, T::Car, status, base::Milliseconds(10 * i), 4096U * i);
+    b.Record(kGw, T::Car, status, base::Milliseconds(10 * i), 4096U * i);
+  }
+  for (auto i = 0; i < 100; ++i) {
+    EXPECT_EQ(a.Sample(kGw, T::Car), b.Sample(kGw, T::Car)) << i;
+  }
+}
+
+TEST(AffinityBanditTest, LearnsPerType) {
+  ipfs::AffinityBandit b{7U};
+  for (auto i = 0; i < 60; ++i) {
+    b.Record(kGw, T::Block, 200, base::Milliseconds(20), 1024U);
+    b.Record(kOther, T::Block, 200, base::Milliseconds(400), 1024U);
+    b.Record(kGw, T::Ipns, 501, base::Milliseconds(30), 0U);
+  }
+  EXPECT_GT(*b.Mean(kGw, T::Block), *b.Mean(kOther, T::Block));
+  EXPECT_LT(*b.Mean(kGw, T::Ipns), 0.1);
+  auto good = 0;
+  for (auto i = 0; i < 100; ++i) {
+    good += *b.Sample(kGw, T::Block) > *b.Sample(kGw, T::Ipns);
+  }
+  EXPECT_GT(good, 95);
+}
+
+TEST(AffinityBanditTest, PosteriorsRoundTrip) {
+  ipfs::AffinityBandit a{5U};
+  EXPECT_TRUE(a.ToDict(kGw).empty());
+  for (auto i = 0; i < 30; ++i) {
+    a.Record(kGw, T::Block, i % 4 ? 200 : 504, base::Milliseconds(40), 1024U);
+    a.Record(kGw, T::Ipns, 200, base::Milliseconds(90), 512U);
+  }
+  EXPECT_EQ(a.generation(kOther), 0UL);
+  EXPECT_EQ(a.generation(kGw), a.generation());
+  ipfs::AffinityBandit b{6U};
+  b.Load(kGw, a.ToDict(kGw));
+  EXPECT_DOUBLE_EQ(*b.Mean(kGw, T::Block), *a.Mean(kGw, T::Block));
+  EXPECT_DOUBLE_EQ(*b.Mean(kGw, T::Ipns), *a.Mean(kGw, T::Ipns));
+  EXPECT_FALSE(b.Mean(kGw, T::Car));
+  EXPECT_EQ(b.ToDict(kGw), a.ToDict(kGw));
+}
+
+TEST(AffinityBanditTest, SizeIsAllowedFor) {
+  ipfs::AffinityBandit b{3U};
+  // Same time per 64KiB: a big CAR shouldn't look worse than a small one.
+  for (auto i = 0; i < 60; ++i) {
+    b.Record(kGw, T::Car, 200, base::Milliseconds(1000), 100U * 64U * 1024U);
+    b.Record(kOther, T::Car, 200, base::Milliseconds(10), 64U * 1024U);
+  }
+  EXPECT_NEAR(*b.Mean(kGw, T::Car), *b.Mean(kOther, T::Car), 0.02);
+}
@@ -2,7 +2,6 @@
 #include <services/network/public/cpp/resource_request.h>
 #include <services/network/public/cpp/simple_url_loader.h>
 #include <services/network/public/mojom/url_response_head.mojom.h>
-#include <base/strings/string_number_conversions.h>
 
 
 using Self = ipfs::BlockHttpRequest;
@@ -34,19 +33,26 @@ Self::~BlockHttpRequest() noexcept {}
 void Self::Send(raw_ptr<network::mojom::URLLoaderFactory> loader_factory) {
   auto req = std::make_unique<network::ResourceRequest>();
   req->url = GURL{inf_.url};
-  req->priority = net::HIGHEST;  // TODO
+  req->priority = priority_;
   if (!inf_.accept.empty()) {
     req->headers.SetHeader("Accept", inf_.accept);
   }
   using L = network::SimpleURLLoader;
+  sent_ = base::TimeTicks::Now();
   loader_ = L::Create(std::move(req), kTrafficAnnotation, FROM_HERE);
   loader_->SetTimeoutDuration(base::Seconds(inf_.timeout_seconds));
   loader_->SetAllowHttpErrorResults(true);
   loader_->SetOnResponseStartedCallback(
       base::BindOnce(&Self::OnResponseHead, base::Unretained(this)));
+  DCHECK(loader_factory);
+  if (chunk_observer_) {
+    // The loader only holds a raw pointer to its consumer.
+    streaming_self_ = shared_from_this();
+    loader_->DownloadAsStream(loader_factory, this);
+    return;
+  }
   auto bound = base::BindOnce(&Self::OnResponse, base::Unretained(this),
                               shared_from_this());
-  DCHECK(loader_factory);
   if (auto sz = inf_.max_response_size) {
     loader_->DownloadToString(loader_factory, std::move(bound), sz.value());
   } else {
@@ -57,8 +63,44 @@ void Self::Send(raw_ptr<network::mojom::URLLoaderFactory> loader_factory) {
 void Self::OnResponse(std::shared_ptr<Self>,
                       std::unique_ptr<std::string> body) {
   DCHECK(loader_);
+  Finish(loader_->NetError(), body ? std::string_view{*body} : "");
+}
+void Self::OnDataReceived(std::string_view chunk, base::OnceClosure resume) {
+  if (http_error_) {
+    std::move(resume).Run();
+    return;
+  }
+  streamed_bytes_ += chunk.size();
+  // The observer may cancel this, e.g. a CAR whose last waiter went away,
+  //   and with it drop the last reference to this (& to the observer).
+  auto keep_alive = shared_from_this();
+  auto more = chunk_observer_(chunk);
+  if (!loader_) {
+    // Cancelled: nobody to report to.
+    return;
+  }
+  if (more) {
+    std::move(resume).Run();
+    return;
+  }
+  // Safe: SimpleURLLoader tolerates deletion from within its callbacks.
+  //   Dropping it (and the status) first makes this report a failure.
+  loader_.reset();
+  response_code_ = 0;
+  abandoned_ = true;
+  Finish(net::ERR_ABORTED, "");
+}
+void Self::OnComplete(bool) {
+  DCHECK(loader_);
+  Finish(loader_->NetError(), "");
+}
+void Self::OnRetry(base::OnceClosure start_retry) {
+  std::move(start_retry).Run();
+}
+void Self::Finish(int net_error, std::string_view body) {
+  auto keep_alive = std::move(streaming_self_);
   int status;
-  switch (loader_->NetError()) {
+  switch (net_error) {
     case net::Error::OK:
       status = 200;
       break;
@@ -66,34 +108,43 @@ void Self::OnResponse(std::shared_ptr<Self>,
       status = 408;
       break;
     default:
-      status = 500;
+      status = abandoned_ ? kAbandoned : 500;
   }
   //  auto sz = body ? body->size() : 0UL;
-  auto const* head = loader_->ResponseInfo();
+  done_.RunAndReset();
+  auto const* head = loader_ ? loader_->ResponseInfo() : nullptr;
   if (head) {
     OnResponseHead({}, *head);
   }
-  auto sp = status_line_.find(' ');
-  if (sp < status_line_.size()) {
-    auto status_code_str = std::string_view{status_line_}.substr(sp + 1);
-    if (!base::StringToInt(status_code_str, &status)) {
-      status = 0;
-    }
+  if (response_code_ > 0) {
+    status = response_code_;
   }
-  if (body) {
-    callback_(status, *body, header_accessor_);
-  } else {
-    callback_(status, "", header_accessor_);
+  if (timing_observer_) {
+    auto now = base::TimeTicks::Now();
+    auto ttfb = head_received_.is_null() ? base::TimeDelta{}
+                                         : head_received_ - sent_;
+    timing_observer_(status, ttfb, now - sent_,
+                     body.size() + streamed_bytes_);
   }
+  callback_(status, body, header_accessor_);
 }
 void Self::OnResponseHead(
-    GURL const&,
+    GURL const& final_url,
     network::mojom::URLResponseHead const& response_head) {
+  // OnResponse re-enters here with an empty URL; only observe the real one.
+  if (final_url.is_valid()) {
+    head_received_ = base::TimeTicks::Now();
+    if (head_observer_) {
+      head_observer_(response_head);
+    }
+  }
   if (!response_head.headers) {
     return;
   }
   auto head = response_head.headers;
-  status_line_ = head->GetStatusLine();
+  // Not parsed from the status line: HTTP/1.1 puts a reason phrase after it.
+  response_code_ = head->response_code();
+  http_error_ = response_code_ / 100 != 2;
   header_accessor_ = [head](std::string_view k) {
     std::string val;
     head->EnumerateHeader(nullptr, k, &val);
@@ -102,4 +153,21 @@ void Self::OnResponseHead(
 }
 void Self::Cancel() {
   loader_.reset();
+  done_.RunAndReset();
+  streaming_self_.reset();
+}
+void Self::SetPriority(net::RequestPriority p) {
+  priority_ = p;
+}
+void Self::StreamTo(ChunkObserver obs) {
+  chunk_observer_ = std::move(obs);
+}
+void Self::ObserveHead(HeadObserver obs) {
+  head_observer_ = std::move(obs);
+}
+void Self::ObserveTiming(TimingObserver obs) {
+  timing_observer_ = std::move(obs);
+}
+void Self::HoldUntilDone(base::ScopedClosureRunner r) {
+  done_ = std::move(r);
 }
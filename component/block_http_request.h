@@ -6,6 +6,11 @@
 #include <ipfs_client/ctx/http_api.h>
 #include <vocab/raw_ptr.h>
 
+#include <base/functional/callback_helpers.h>
+#include <base/time/time.h>
+#include <net/base/request_priority.h>
+#include <services/network/public/cpp/simple_url_loader_stream_consumer.h>
+
 namespace network {
 struct ResourceRequest;
 class SimpleURLLoader;
@@ -21,16 +26,24 @@ namespace ipfs {
 /*! Manages lifetime for a single HTTP request to an IPFS gateway.
  *  Not strictly for a block necessarily, thought that was the case when the name was chosen.
  */
-class BlockHttpRequest : public std::enable_shared_from_this<BlockHttpRequest> {
+class BlockHttpRequest : public std::enable_shared_from_this<BlockHttpRequest>,
+                         public network::SimpleURLLoaderStreamConsumer {
   std::unique_ptr<network::SimpleURLLoader> loader_;
 
  public:
   using HttpCompleteCallback = ctx::HttpApi::OnComplete;
 
+  /*! \brief Pseudo-status for a response given up on here, not by the
+   *    gateway, e.g. a body the ChunkObserver rejected
+   *  \details Says nothing about the gateway's health or speed, so it must
+   *    not be held against it. 499 as in nginx's "client closed request".
+   */
+  static constexpr int kAbandoned = 499;
+
   /*! Initialize a request
    */
   BlockHttpRequest(ipfs::HttpRequestDescription, HttpCompleteCallback);
-  ~BlockHttpRequest() noexcept;
+  ~BlockHttpRequest() noexcept override;
 
   /*! \brief Send the HTTP request to the gateway
    *  \param loader_factory Used to create URL Loaders for HTTP(s)
@@ -38,17 +51,71 @@ class BlockHttpRequest : public std::enable_shared_from_this<BlockHttpRequest> {
   void Send(raw_ptr<network::mojom::URLLoaderFactory> loader_factory);
   void Cancel();
 
+  /*! \brief Must be set before Send; defaults to net::HIGHEST
+   *  \details net::IDLE for speculative work, e.g. a prefetch
+   */
+  void SetPriority(net::RequestPriority);
+
+  /*! \brief Something to be told about the response head, when it arrives
+   *  \details Used for per-gateway bookkeeping, e.g. negotiated protocol.
+   */
+  using HeadObserver =
+      std::function<void(network::mojom::URLResponseHead const&)>;
+  void ObserveHead(HeadObserver);
+
+  /*! \brief Told how long the request took, and how much body arrived,
+   *    just before the completion callback is called.
+   *  \details ttfb is zero if no response head ever arrived.
+   */
+  using TimingObserver = std::function<void(int status,
+                                            base::TimeDelta ttfb,
+                                            base::TimeDelta total,
+                                            std::size_t bytes)>;
+  void ObserveTiming(TimingObserver);
+
+  /*! \brief Receive the body piece by piece as it arrives
+   *  \details Must be set before Send. The completion callback then gets an
+   *    empty body. Return false from the observer to abandon the request;
+   *    the completion callback still gets called, with kAbandoned.
+   */
+  using ChunkObserver = std::function<bool(std::string_view)>;
+  void StreamTo(ChunkObserver);
+
+  // network::SimpleURLLoaderStreamConsumer
+  void OnDataReceived(std::string_view, base::OnceClosure resume) override;
+  void OnComplete(bool success) override;
+  void OnRetry(base::OnceClosure start_retry) override;
+
+  /*! \brief Hold on to something until this request is finished or cancelled
+   *  \details Typically a GatewayThrottle slot.
+   */
+  void HoldUntilDone(base::ScopedClosureRunner);
+
  private:
   ipfs::HttpRequestDescription const inf_;
   HttpCompleteCallback callback_;
-  std::string status_line_;
+  net::RequestPriority priority_ = net::HIGHEST;
+  /*! From the response head; 0 until there is one */
+  int response_code_ = 0;
   ctx::HttpApi::Hdrs header_accessor_ = [](auto) {
     return std::string{};
   };
+  HeadObserver head_observer_;
+  TimingObserver timing_observer_;
+  ChunkObserver chunk_observer_;
+  std::size_t streamed_bytes_ = 0UL;
+  /*! Error bodies aren't streamed, so the status (e.g. 429) survives */
+  bool http_error_ = false;
+  bool abandoned_ = false;
+  std::shared_ptr<BlockHttpRequest> streaming_self_;
+  base::TimeTicks sent_;
+  base::TimeTicks head_received_;
+  base::ScopedClosureRunner done_;
 
   void OnResponseHead(GURL const&, network::mojom::URLResponseHead const&);
   void OnResponse(std::shared_ptr<BlockHttpRequest>,
                   std::unique_ptr<std::string> body);
+  void Finish(int net_error, std::string_view body);
 };
 }  // namespace ipfs
 
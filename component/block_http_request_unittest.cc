@@ -0,0 +1,176 @@
+#include "block_http_request.h"
+
+#include "affinity_bandit.h"
+#include "chromium_http.h"
+#include "circuit_breaker.h"
+#include "gateway_latencies.h"
+#include "gateway_throttle.h"
+
+#include <base/memory/scoped_refptr.h>
+#include <base/run_loop.h>
+#include <base/test/task_environment.h>
+#include <net/base/request_priority.h>
+#include <net/http/http_response_headers.h>
+#include <net/http/http_util.h>
+#include <services/network/public/cpp/url_loader_completion_status.h>
+#include <services/network/public/mojom/url_response_head.mojom.h>
+#include <services/network/test/test_url_loader_factory.h>
+#include <url/gurl.h>
+
+#include <gtest/gtest.h>
+
+#include <string>
+#include <string_view>
+
+using T = ipfs::gw::GatewayRequestType;
+
+namespace {
+constexpr char kGw[] = "http://localhost:8080/";
+constexpr char kUrl[] =
+    "http://localhost:8080/ipfs/"
+    "bafkreigh2akiscaildcqabsyg3dfr6chu3fgpregiymsck7e7aqa4s52zy";
+
+class BlockHttpRequestTest : public testing::Test {
+ protected:
+  /*! \param head Status line and headers, one per line */
+  void Respond(std::string_view head, std::string_view body = "") {
+    auto h = network::mojom::URLResponseHead::New();
+    h->headers = base::MakeRefCounted<net::HttpResponseHeaders>(
+        net::HttpUtil::AssembleRawHeaders(head));
+    factory_.AddResponse(GURL{kUrl}, std::move(h), body,
+                         network::URLLoaderCompletionStatus{net::OK});
+  }
+  static ipfs::HttpRequestDescription Desc() {
+    ipfs::HttpRequestDescription desc;
+    desc.url = kUrl;
+    desc.accept = "application/vnd.ipld.raw";
+    desc.timeout_seconds = 30;
+    return desc;
+  }
+  /*! \return The status the completion callback was given */
+  int Fetch() {
+    auto desc = Desc();
+    auto status = -1;
+    base::RunLoop loop;
+    auto done = [&](auto s, auto, auto const& hdrs) {
+      status = s;
+      retry_after_ = hdrs("Retry-After");
+      loop.Quit();
+    };
+    auto req = std::make_shared<ipfs::BlockHttpRequest>(desc, done);
+    Prepare(*req, desc);
+    req->Send(&factory_);
+    loop.Run();
+    return status;
+  }
+  /*! Hook the request up before it's sent */
+  virtual void Prepare(ipfs::BlockHttpRequest&,
+                       ipfs::HttpRequestDescription const&) {}
+
+  base::test::TaskEnvironment env_{
+      base::test::TaskEnvironment::TimeSource::MOCK_TIME};
+  network::TestURLLoaderFactory factory_;
+  std::string retry_after_;
+};
+/*! Wired to the gateway's bookkeeping as ChromiumHttp wires its requests */
+class ObservedRequestTest : public BlockHttpRequestTest {
+ protected:
+  void Prepare(ipfs::BlockHttpRequest& req,
+               ipfs::HttpRequestDescription const& desc) override {
+    ipfs::ChromiumHttp::Observe(req, kGw, desc, throttle_, latencies_,
+                                bandit_);
+  }
+
+  ipfs::GatewayThrottle throttle_;
+  ipfs::GatewayLatencies latencies_;
+  ipfs::AffinityBandit bandit_{1U};
+};
+}  // namespace
+
+TEST_F(BlockHttpRequestTest, StatusIgnoresHttp1ReasonPhrase) {
+  Respond("HTTP/1.1 200 OK\nContent-Type: application/vnd.ipld.raw\n\n",
+          "block");
+  EXPECT_EQ(Fetch(), 200);
+  Respond("HTTP/1.1 404 Not Found\n\n");
+  EXPECT_EQ(Fetch(), 404);
+}
+
+TEST_F(BlockHttpRequestTest, CancelledByItsOwnChunkObserver) {
+  Respond("HTTP/1.1 200 OK\n\n", "a CAR, say");
+  auto answered = false;
+  auto req = std::make_shared<ipfs::BlockHttpRequest>(
+      Desc(), [&answered](auto, auto, auto const&) { answered = true; });
+  auto* raw = req.get();
+  auto chunks = 0;
+  req->StreamTo([raw, &chunks](std::string_view) {
+    ++chunks;
+    raw->Cancel();
+    return false;
+  });
+  req->Send(&factory_);
+  // Now only the request itself keeps it alive while streaming.
+  req.reset();
+  base::RunLoop().RunUntilIdle();
+  EXPECT_EQ(chunks, 1);
+  EXPECT_FALSE(answered);
+}
+
+TEST_F(BlockHttpRequestTest, SentAtItsPriority) {
+  auto req = std::make_shared<ipfs::BlockHttpRequest>(
+      Desc(), [](auto, auto, auto const&) {});
+  req->SetPriority(net::IDLE);
+  req->Send(&factory_);
+  ASSERT_EQ(factory_.NumPending(), 1);
+  EXPECT_EQ(factory_.pending_requests()->front().request.priority, net::IDLE);
+  req->Cancel();
+}
+
+TEST_F(BlockHttpRequestTest, Http1SuccessDoesNotTripBreaker) {
+  ipfs::CircuitBreaker brk;
+  Respond("HTTP/1.1 200 OK\n\n", "block");
+  for (auto i = 0; i < ipfs::CircuitBreaker::kTripAfter * 2; ++i) {
+    brk.Record(kGw, Fetch());
+  }
+  EXPECT_FALSE(brk.IsOpen(kGw));
+  Respond("HTTP/1.1 502 Bad Gateway\n\n");
+  for (auto i = 0; i < ipfs::CircuitBreaker::kTripAfter; ++i) {
+    brk.Record(kGw, Fetch());
+  }
+  EXPECT_TRUE(brk.IsOpen(kGw));
+}
+
+TEST_F(ObservedRequestTest, Http1SuccessIsTimed) {
+  Respond("HTTP/1.1 200 OK\n\n", "block");
+  ASSERT_EQ(Fetch(), 200);
+  EXPECT_TRUE(latencies_.Find(kGw, T::Block));
+  EXPECT_TRUE(latencies_.ExpectedMillis(kGw, T::Block));
+  EXPECT_GT(latencies_.generation(kGw), 0UL);
+}
+
+TEST_F(ObservedRequestTest, Http1SuccessRewardsTheArm) {
+  Respond("HTTP/1.1 200 OK\n\n", "block");
+  for (auto i = 0; i < 10; ++i) {
+    ASSERT_EQ(Fetch(), 200);
+  }
+  ASSERT_TRUE(bandit_.Mean(kGw, T::Block));
+  EXPECT_GT(*bandit_.Mean(kGw, T::Block), 0.5);
+  Respond("HTTP/1.1 504 Gateway Timeout\n\n");
+  for (auto i = 0; i < 30; ++i) {
+    ASSERT_EQ(Fetch(), 504);
+  }
+  EXPECT_LT(*bandit_.Mean(kGw, T::Block), 0.5);
+}
+
+TEST_F(ObservedRequestTest, Http1TooManyRequestsPausesTheGateway) {
+  Respond("HTTP/1.1 429 Too Many Requests\nRetry-After: 7\n\n");
+  auto status = Fetch();
+  ASSERT_EQ(status, 429);
+  EXPECT_EQ(retry_after_, "7");
+  throttle_.RecordResponse(
+      kGw, status,
+      ipfs::GatewayThrottle::ParseRetryAfter(retry_after_, base::Time::Now()));
+  EXPECT_TRUE(throttle_.paused(kGw));
+  EXPECT_FALSE(ipfs::CircuitBreaker::IsHealthFailure(status));
+  env_.FastForwardBy(base::Seconds(7));
+  EXPECT_FALSE(throttle_.paused(kGw));
+}
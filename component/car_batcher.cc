@@ -0,0 +1,464 @@
+#include "car_batcher.h"
+
+#include "car_reader.h"
+#include "multibase.h"
+
+#include <base/functional/bind.h>
+#include <base/logging.h>
+#include <base/strings/string_util.h>
+#include <base/task/sequenced_task_runner.h>
+
+#include <ipfs_client/cid.h>
+
+#include <algorithm>
+#include <set>
+
+using Self = ipfs::CarBatcher;
+
+namespace {
+using namespace std::literals;
+auto constexpr kRawType = "application/vnd.ipld.raw"sv;
+auto constexpr kCarType = "application/vnd.ipld.car"sv;
+
+/*! The gateway part of a request URL, up to and including its last '/' */
+std::string_view GatewayOf(std::string_view url) {
+  return url.substr(0UL, url.find("/ipfs/") + 1UL);
+}
+
+std::string BlockHeader(std::string_view k) {
+  if (base::EqualsCaseInsensitiveASCII(k, "content-type")) {
+    return std::string{kRawType};
+  }
+  return {};
+}
+
+struct PbLink {
+  ipfs::ByteView hash;
+  std::uint64_t tsize = 0U;
+};
+/*! Read one protobuf field; only varint & length-delimited are expected */
+bool NextField(ipfs::ByteView& bytes,
+               std::uint64_t& field,
+               std::uint64_t& varint,
+               ipfs::ByteView& delimited) {
+  auto key = ipfs::CarReader::ReadVarint(bytes);
+  if (!key) {
+    return false;
+  }
+  field = *key >> 3;
+  switch (*key & 7U) {
+    case 0U:
+      if (auto v = ipfs::CarReader::ReadVarint(bytes)) {
+        varint = *v;
+        return true;
+      }
+      return false;
+    case 2U:
+      if (auto len = ipfs::CarReader::ReadVarint(bytes);
+          len && *len <= bytes.size()) {
+        delimited = bytes.first(static_cast<std::size_t>(*len));
+        bytes = bytes.subspan(static_cast<std::size_t>(*len));
+        return true;
+      }
+      return false;
+    default:
+      return false;
+  }
+}
+/*! Strictly parse a dag-pb node, so that raw leaves aren't mistaken for one
+ *  \return Whether it parsed
+ */
+bool ScanDagPb(ipfs::ByteView bytes, std::vector<PbLink>& links, bool& is_file) {
+  std::uint64_t field = 0U;
+  std::uint64_t varint = 0U;
+  ipfs::ByteView sub;
+  is_file = false;
+  while (!bytes.empty()) {
+    if (!NextField(bytes, field, varint, sub)) {
+      return false;
+    }
+    if (field == 2U) {
+      PbLink link;
+      while (!sub.empty()) {
+        ipfs::ByteView inner;
+        if (!NextField(sub, field, varint, inner)) {
+          return false;
+        }
+        if (field == 1U) {
+          link.hash = inner;
+        } else if (field == 3U) {
+          link.tsize = varint;
+        } else if (field != 2U) {
+          return false;
+        }
+      }
+      if (link.hash.empty()) {
+        return false;
+      }
+      links.push_back(link);
+    } else if (field == 1U) {
+      // UnixFS Data: field 1 is the type, and 2 is File.
+      ipfs::ByteView inner;
+      if (NextField(sub, field, varint, inner) && field == 1U) {
+        is_file = varint == 2U;
+      }
+    } else {
+      return false;
+    }
+  }
+  return true;
+}
+}  // namespace
+
+Self::CarBatcher() = default;
+Self::~CarBatcher() noexcept = default;
+
+auto Self::Batchable(HttpRequestDescription const& desc) const
+    -> std::optional<std::string> {
+  if (desc.accept.find(kRawType) == std::string::npos) {
+    return std::nullopt;
+  }
+  auto cid = Normalize(CidOf(desc.url));
+  if (cid.empty() ||
+      !(parent_of_.contains(cid) || SpareFor(cid, GatewayOf(desc.url)))) {
+    return std::nullopt;
+  }
+  return cid;
+}
+auto Self::Add(std::string cid,
+               HttpRequestDescription desc,
+               OnComplete cb,
+               Sender single,
+               StreamSender stream) -> Canceller {
+  if (SpareFor(cid, GatewayOf(desc.url))) {
+    return AnswerFromSpare(cid, std::move(cb));
+  }
+  auto& parent = parent_of_.at(cid);
+  auto& bid = collecting_[parent];
+  if (!bid) {
+    bid = next_id_++;
+    batches_[bid].parent = parent;
+    // Siblings are requested in a single pass of the DAG walk.
+    base::SequencedTaskRunner::GetCurrentDefault()->PostTask(
+        FROM_HERE,
+        base::BindOnce(&Self::Flush, weak_factory_.GetWeakPtr(), bid));
+  }
+  auto batch = bid;
+  Waiter w;
+  w.id = next_id_++;
+  w.cid = std::move(cid);
+  w.desc = std::move(desc);
+  w.cb = std::move(cb);
+  w.single = std::move(single);
+  w.stream = std::move(stream);
+  auto id = w.id;
+  batches_[batch].waiters.push_back(std::move(w));
+  auto wk = weak_factory_.GetWeakPtr();
+  return [wk, batch, id]() {
+    if (wk) {
+      wk->Cancel(batch, id);
+    }
+  };
+}
+void Self::Flush(std::size_t bid) {
+  auto it = batches_.find(bid);
+  if (it == batches_.end()) {
+    return;
+  }
+  auto& b = it->second;
+  collecting_.erase(b.parent);
+  if (b.waiters.empty()) {
+    batches_.erase(it);
+    return;
+  }
+  std::set<std::string_view> distinct;
+  std::map<std::string_view, int> gateways;
+  for (auto& w : b.waiters) {
+    distinct.insert(w.cid);
+    gateways[GatewayOf(w.desc.url)]++;
+  }
+  auto p = parents_.find(b.parent);
+  if (distinct.size() < kMinBatch || p == parents_.end() ||
+      p->second.total_size > kMaxCarBytes) {
+    for (auto& w : b.waiters) {
+      SendSingly(bid, w);
+    }
+    return;
+  }
+  // The gateway most requests were bound for, i.e. the scheduler's favourite
+  auto gw = std::max_element(gateways.begin(), gateways.end(),
+                             [](auto& a, auto& c) { return a.second < c.second; })
+                ->first;
+  HttpRequestDescription car;
+  car.url = std::string{gw};
+  car.url.append("ipfs/").append(b.parent).append("?dag-scope=");
+  car.url.append(p->second.is_file ? "entity" : "all");
+  car.accept = std::string{kCarType};
+  car.timeout_seconds = 0;
+  for (auto& w : b.waiters) {
+    car.timeout_seconds = std::max(car.timeout_seconds, w.desc.timeout_seconds);
+  }
+  // One round trip, but more bytes than any one block.
+  car.timeout_seconds *= 2;
+  VLOG(1) << "Fetching " << distinct.size() << " siblings as " << car.url;
+  auto wk = weak_factory_.GetWeakPtr();
+  auto reader = std::make_shared<CarReader>(
+      [wk, bid, gateway = std::string{gw}](ByteView cid, ByteView block) {
+        if (wk) {
+          wk->OnBlock(bid, gateway, cid, block);
+        }
+      },
+      kMaxCarBytes * 2UL);
+  auto chunks = [reader](std::string_view chunk) {
+    return reader->Feed(chunk);
+  };
+  auto done = [wk, bid, reader](int status, auto, auto const&) {
+    if (wk) {
+      wk->OnCarDone(bid, reader->complete() ? status : 500);
+    }
+  };
+  b.sent = true;
+  b.gateway = std::string{gw};
+  cars_sent_++;
+  auto stream = b.waiters.front().stream;
+  auto cancel = stream(std::move(car), done, chunks);
+  if (auto again = batches_.find(bid); again != batches_.end()) {
+    again->second.cancel = std::move(cancel);
+  }
+}
+void Self::SendSingly(std::size_t bid, Waiter& w) {
+  auto wk = weak_factory_.GetWeakPtr();
+  auto id = w.id;
+  auto cb = w.cb;
+  auto finished = [wk, bid, id, cb](int status, auto body, auto const& hdrs) {
+    if (wk) {
+      wk->Finished(bid, id);
+    }
+    cb(status, body, hdrs);
+  };
+  w.cancel = w.single(w.desc, finished);
+}
+void Self::OnBlock(std::size_t bid,
+                   std::string const& gateway,
+                   ByteView cid_bytes,
+                   ByteView bytes) {
+  Cid parsed{cid_bytes};
+  if (!parsed.valid()) {
+    return;
+  }
+  auto cid = multibase::CidV1Base32(cid_bytes);
+  std::string_view block{reinterpret_cast<char const*>(bytes.data()),
+                         bytes.size()};
+  Learn(cid, block);
+  auto it = batches_.find(bid);
+  if (it == batches_.end()) {
+    Keep(cid, block, gateway);
+    return;
+  }
+  auto& b = it->second;
+  auto waiting = [&cid](Waiter const& x) { return x.cid == cid && !x.cancel; };
+  // Only requests bound for the gateway that served the CAR are answered
+  //   from it, so the scheduler credits the right one. The same block bound
+  //   elsewhere keeps waiting: the scheduler will cancel those copies now it
+  //   has the block, or else they fall back like anything the CAR lacked.
+  auto served_here = [&gateway, &waiting](Waiter const& x) {
+    return waiting(x) && GatewayOf(x.desc.url) == gateway;
+  };
+  std::vector<OnComplete> cbs;
+  for (auto& w : b.waiters) {
+    if (served_here(w)) {
+      cbs.push_back(std::move(w.cb));
+    }
+  }
+  if (cbs.empty()) {
+    // Nobody asked this gateway for it; don't make them wait for the rest.
+    Keep(cid, block, gateway);
+    for (auto& w : b.waiters) {
+      if (waiting(w)) {
+        SendSingly(bid, w);
+      }
+    }
+    return;
+  }
+  std::erase_if(b.waiters, served_here);
+  blocks_batched_++;
+  for (auto& cb : cbs) {
+    cb(200, block, &BlockHeader);
+  }
+}
+void Self::OnCarDone(std::size_t bid, int status) {
+  auto it = batches_.find(bid);
+  if (it == batches_.end()) {
+    return;
+  }
+  auto& b = it->second;
+  b.cancel = {};
+  if (status / 100 != 2) {
+    VLOG(1) << "CAR for " << b.parent << " failed (" << status << "), "
+              << b.waiters.size() << " block requests fall back.";
+  }
+  if (b.waiters.empty()) {
+    batches_.erase(it);
+    return;
+  }
+  for (auto& w : b.waiters) {
+    if (!w.cancel) {
+      SendSingly(bid, w);
+    }
+  }
+}
+void Self::Finished(std::size_t bid, std::size_t id) {
+  auto it = batches_.find(bid);
+  if (it == batches_.end()) {
+    return;
+  }
+  std::erase_if(it->second.waiters, [id](auto& w) { return w.id == id; });
+  if (it->second.waiters.empty() && !it->second.cancel &&
+      !Collecting(bid, it->second)) {
+    batches_.erase(it);
+  }
+}
+void Self::Cancel(std::size_t bid, std::size_t id) {
+  auto it = batches_.find(bid);
+  if (it == batches_.end()) {
+    return;
+  }
+  auto& b = it->second;
+  auto w = std::find_if(b.waiters.begin(), b.waiters.end(),
+                        [id](auto& x) { return x.id == id; });
+  if (w == b.waiters.end()) {
+    return;
+  }
+  auto cancel = std::move(w->cancel);
+  b.waiters.erase(w);
+  Canceller car;
+  // Until it's flushed, Flush is due and will drop an empty batch itself.
+  if (b.waiters.empty() && !Collecting(bid, b)) {
+    car = std::move(b.cancel);
+    batches_.erase(it);
+  }
+  if (cancel) {
+    cancel();
+  }
+  if (car) {
+    car();
+  }
+}
+bool Self::Collecting(std::size_t bid, Batch const& b) const {
+  auto c = collecting_.find(b.parent);
+  return c != collecting_.end() && c->second == bid;
+}
+void Self::Learn(std::string const& cid, std::string_view block) {
+  if (cid.empty() || parents_.contains(cid)) {
+    return;
+  }
+  std::vector<PbLink> links;
+  bool is_file = false;
+  if (!ScanDagPb(as_bytes(block), links, is_file) || links.empty()) {
+    return;
+  }
+  Parent p;
+  p.is_file = is_file;
+  for (auto& l : links) {
+    Cid child{l.hash};
+    if (!child.valid()) {
+      return;
+    }
+    p.children.push_back(multibase::CidV1Base32(l.hash));
+    p.total_size += static_cast<std::size_t>(l.tsize);
+  }
+  for (auto& c : p.children) {
+    parent_of_[c] = cid;
+  }
+  parents_.emplace(cid, std::move(p));
+  parent_order_.push_back(cid);
+  while (parents_.size() > kMaxParents) {
+    auto old = parents_.find(parent_order_.front());
+    parent_order_.pop_front();
+    if (old == parents_.end()) {
+      continue;
+    }
+    for (auto& c : old->second.children) {
+      if (auto po = parent_of_.find(c);
+          po != parent_of_.end() && po->second == old->first) {
+        parent_of_.erase(po);
+      }
+    }
+    parents_.erase(old);
+  }
+}
+void Self::Keep(std::string cid,
+                std::string_view block,
+                std::string gateway) {
+  if (block.size() > kMaxSpareBytes / 4UL || spare_.contains(cid)) {
+    return;
+  }
+  spare_bytes_ += block.size();
+  spare_order_.push_back(cid);
+  spare_.emplace(std::move(cid),
+                 Spare{std::move(gateway), std::string{block}});
+  while (spare_bytes_ > kMaxSpareBytes && !spare_order_.empty()) {
+    auto it = spare_.find(spare_order_.front());
+    spare_order_.pop_front();
+    if (it != spare_.end()) {
+      spare_bytes_ -= it->second.block.size();
+      spare_.erase(it);
+    }
+  }
+}
+bool Self::SpareFor(std::string const& cid, std::string_view gw) const {
+  // Answered on another gateway's behalf, the scheduler would credit (and
+  //   learn to favour) one that was never asked.
+  auto it = spare_.find(cid);
+  return it != spare_.end() && it->second.gateway == gw;
+}
+auto Self::AnswerFromSpare(std::string const& cid, OnComplete cb)
+    -> Canceller {
+  auto node = spare_.extract(cid);
+  spare_bytes_ -= node.mapped().block.size();
+  blocks_batched_++;
+  auto live = std::make_shared<bool>(true);
+  auto answer = [](std::shared_ptr<bool> live, OnComplete cb,
+                   std::string block) {
+    if (*live) {
+      cb(200, block, &BlockHeader);
+    }
+  };
+  base::SequencedTaskRunner::GetCurrentDefault()->PostTask(
+      FROM_HERE, base::BindOnce(answer, live, std::move(cb),
+                                std::move(node.mapped().block)));
+  return [live]() { *live = false; };
+}
+std::string Self::Normalize(std::string_view cid_str) {
+  if (cid_str.empty()) {
+    return {};
+  }
+  // The spellings gateways and links use in practice are decoded here, the
+  //   same way OnBlock spells what it reads. Other multibases go to Cid.
+  std::optional<std::vector<std::byte>> bin;
+  if (cid_str[0] == 'b' || cid_str[0] == 'B') {
+    bin = multibase::DecodeBase32(cid_str.substr(1UL));
+  } else if (cid_str.size() == 46UL && cid_str.starts_with("Qm")) {
+    bin = multibase::DecodeBase58Btc(cid_str);
+  }
+  if (bin) {
+    return Cid{*bin}.valid() ? multibase::CidV1Base32(*bin) : std::string{};
+  }
+  Cid cid{cid_str};
+  return cid.valid() ? cid.to_string() : std::string{};
+}
+std::string_view Self::CidOf(std::string_view url) {
+  auto i = url.find("/ipfs/");
+  if (i == std::string_view::npos) {
+    return {};
+  }
+  url.remove_prefix(i + 6UL);
+  return url.substr(0UL, url.find_first_of("/?#"));
+}
+
+Self::Waiter::Waiter() = default;
+Self::Waiter::Waiter(Waiter&&) = default;
+auto Self::Waiter::operator=(Waiter&&) -> Waiter& = default;
+Self::Waiter::~Waiter() noexcept = default;
+Self::Batch::Batch() = default;
+Self::Batch::~Batch() noexcept = default;
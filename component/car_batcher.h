@@ -0,0 +1,153 @@
+#ifndef IPFS_CAR_BATCHER_H_
+#define IPFS_CAR_BATCHER_H_
+
+#include "block_http_request.h"
+
+#include <ipfs_client/ctx/http_api.h>
+
+#include <base/memory/weak_ptr.h>
+
+#include <deque>
+#include <functional>
+#include <map>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace ipfs {
+
+/*! Coalesces requests for sibling blocks into one CAR request
+ *  \details Every dag-pb block fetched is scanned for links, so for each
+ *    block we may know its parent and the parent's cumulative size (Tsize).
+ *    Raw block requests for children of the same parent, issued together,
+ *    become a single `application/vnd.ipld.car` request for the parent -
+ *    `dag-scope=entity` for a file, `dag-scope=all` for anything else, and
+ *    only if the whole thing is small enough. The CAR is parsed as it
+ *    streams in and each block handed to the requests for it that were
+ *    bound for the CAR's gateway. Blocks nobody
+ *    is waiting on yet are held briefly, since the walk will likely ask for
+ *    them next - but only for requests bound for the gateway that served
+ *    them, for the same reason. Anything the CAR didn't deliver falls back to an
+ *    ordinary request to the gateway originally chosen for it.
+ */
+class CarBatcher {
+ public:
+  using Canceller = ctx::HttpApi::Canceller;
+  using OnComplete = ctx::HttpApi::OnComplete;
+  /*! Send a single request the usual way */
+  using Sender =
+      std::function<Canceller(HttpRequestDescription, OnComplete)>;
+  /*! Send a request, streaming its body */
+  using StreamSender = std::function<
+      Canceller(HttpRequestDescription, OnComplete, BlockHttpRequest::ChunkObserver)>;
+
+  /*! Don't bother with a CAR for fewer siblings than this */
+  static constexpr std::size_t kMinBatch = 3UL;
+  /*! Don't ask for a CAR whose DAG (per Tsize) is bigger than this */
+  static constexpr std::size_t kMaxCarBytes = 8UL << 20;
+  /*! Bound on unclaimed blocks held from CARs */
+  static constexpr std::size_t kMaxSpareBytes = 16UL << 20;
+  /*! Bound on how many parents' links are remembered */
+  static constexpr std::size_t kMaxParents = 4096UL;
+
+  CarBatcher();
+  ~CarBatcher() noexcept;
+
+  CarBatcher(CarBatcher const&) = delete;
+  CarBatcher& operator=(CarBatcher const&) = delete;
+
+  /*! \return The requested CID, normalized, if this request is batchable */
+  std::optional<std::string> Batchable(HttpRequestDescription const&) const;
+
+  /*! \brief Take over a request
+   *  \param cid From Batchable()
+   */
+  Canceller Add(std::string cid,
+                HttpRequestDescription,
+                OnComplete,
+                Sender,
+                StreamSender);
+
+  /*! \brief Note the links in a block, if it's dag-pb
+   *  \param cid Normalized (\see Normalize) CID of the block
+   */
+  void Learn(std::string const& cid, std::string_view block);
+
+  /*! \return A consistent string form for a CID, or empty if not a CID */
+  static std::string Normalize(std::string_view cid_str);
+
+  /*! \return The CID a gateway URL asks for, not normalized */
+  static std::string_view CidOf(std::string_view url);
+
+  std::size_t cars_sent() const { return cars_sent_; }
+  std::size_t blocks_batched() const { return blocks_batched_; }
+
+ private:
+  struct Parent {
+    std::size_t total_size = 0UL;
+    bool is_file = false;
+    std::vector<std::string> children;
+  };
+  struct Waiter {
+    Waiter();
+    Waiter(Waiter&&);
+    Waiter& operator=(Waiter&&);
+    ~Waiter() noexcept;
+    std::size_t id;
+    std::string cid;
+    HttpRequestDescription desc;
+    OnComplete cb;
+    Sender single;
+    StreamSender stream;
+    Canceller cancel;
+  };
+  /*! A block from a CAR that nobody was waiting on */
+  struct Spare {
+    /*! The gateway that served it */
+    std::string gateway;
+    std::string block;
+  };
+  struct Batch {
+    Batch();
+    ~Batch() noexcept;
+    std::string parent;
+    /*! The gateway the CAR was requested from, once sent */
+    std::string gateway;
+    std::vector<Waiter> waiters;
+    bool sent = false;
+    Canceller cancel;
+  };
+  std::map<std::string, std::string> parent_of_;
+  std::map<std::string, Parent> parents_;
+  std::deque<std::string> parent_order_;
+  std::map<std::string, Spare> spare_;
+  std::deque<std::string> spare_order_;
+  std::size_t spare_bytes_ = 0UL;
+  std::map<std::size_t, Batch> batches_;
+  std::map<std::string, std::size_t> collecting_;
+  std::size_t next_id_ = 1UL;
+  std::size_t cars_sent_ = 0UL;
+  std::size_t blocks_batched_ = 0UL;
+  base::WeakPtrFactory<CarBatcher> weak_factory_{this};
+
+  void Flush(std::size_t batch);
+  void SendSingly(std::size_t batch, Waiter&);
+  /*! \param gateway The one the CAR came from */
+  void OnBlock(std::size_t batch,
+               std::string const& gateway,
+               ByteView cid,
+               ByteView block);
+  void OnCarDone(std::size_t batch, int status);
+  void Finished(std::size_t batch, std::size_t waiter);
+  void Cancel(std::size_t batch, std::size_t waiter);
+  /*! \return Whether requests may still join this batch */
+  bool Collecting(std::size_t batch, Batch const&) const;
+  void Keep(std::string cid, std::string_view block, std::string gateway);
+  /*! \return Whether a spare block can answer a request bound for gw */
+  bool SpareFor(std::string const& cid, std::string_view gw) const;
+  Canceller AnswerFromSpare(std::string const& cid, OnComplete);
+};
+}  // namespace ipfs
+
+#endif  // IPFS_CAR_BATCHER_H_
@@ -0,0 +1,190 @@
+#include "car_batcher.h"
+
+#include "multibase.h"
+
+#include <base/run_loop.h>
+#include <base/test/task_environment.h>
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <functional>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace {
+constexpr char kGwA[] = "https://a.example/";
+constexpr char kGwB[] = "https://b.example/";
+
+std::string Varint(std::uint64_t v) {
+  std::string rv;
+  for (; v >= 0x80U; v >>= 7) {
+    rv.push_back(static_cast<char>((v & 0x7FU) | 0x80U));
+  }
+  rv.push_back(static_cast<char>(v));
+  return rv;
+}
+/*! A binary CIDv1 with a sha2-256-sized digest of fill; never checked */
+std::string BinCid(char codec, char fill) {
+  std::string rv{'\x01', codec, '\x12', '\x20'};
+  rv.append(32UL, fill);
+  return rv;
+}
+std::string Text(std::string const& bin) {
+  return ipfs::multibase::CidV1Base32(ipfs::as_bytes(bin));
+}
+/*! A dag-pb directory linking to children, each claiming 1 KiB */
+std::string DagPb(std::vector<std::string> const& children) {
+  std::string rv;
+  for (auto& c : children) {
+    auto link = "\x0a" + Varint(c.size()) + c + "\x18" + Varint(1024U);
+    rv.append("\x12").append(Varint(link.size())).append(link);
+  }
+  return rv;
+}
+/*! A CARv1 of (binary CID, block) sections, after a header nobody reads */
+std::string Car(std::vector<std::pair<std::string, std::string>> const& bs) {
+  std::string rv = Varint(3U) + "abc";
+  for (auto& [cid, block] : bs) {
+    rv.append(Varint(cid.size() + block.size())).append(cid).append(block);
+  }
+  return rv;
+}
+
+class CarBatcherTest : public testing::Test {
+ protected:
+  CarBatcherTest() {
+    for (auto fill : {'0', '1', '2', '3'}) {
+      children_.push_back(BinCid('\x55', fill));
+    }
+    batcher_.Learn(Text(parent_), DagPb(children_));
+  }
+  static std::string Url(std::string const& gw, std::string const& child) {
+    return gw + "ipfs/" + Text(child);
+  }
+  /*! Ask gateway for a child. Its answer goes in answers_ under its URL. */
+  void Add(std::string const& gw, std::string const& child) {
+    ipfs::HttpRequestDescription desc;
+    desc.url = Url(gw, child);
+    desc.accept = "application/vnd.ipld.raw";
+    desc.timeout_seconds = 10;
+    auto cid = batcher_.Batchable(desc);
+    ASSERT_TRUE(cid) << desc.url;
+    auto answer = [this, url = desc.url](auto status, auto, auto const&) {
+      answers_[url] = status;
+      if (on_answer_) {
+        on_answer_();
+      }
+    };
+    auto single = [this](ipfs::HttpRequestDescription d,
+                         ipfs::CarBatcher::OnComplete) {
+      singles_.push_back(d.url);
+      return ipfs::CarBatcher::Canceller{[]() {}};
+    };
+    auto stream = [this](ipfs::HttpRequestDescription d,
+                         ipfs::CarBatcher::OnComplete done,
+                         ipfs::BlockHttpRequest::ChunkObserver chunks) {
+      car_url_ = d.url;
+      car_done_ = std::move(done);
+      car_chunks_ = std::move(chunks);
+      return ipfs::CarBatcher::Canceller{[this]() { car_cancelled_ = true; }};
+    };
+    cancel_[desc.url] = batcher_.Add(*cid, desc, answer, single, stream);
+  }
+  void Settle() { base::RunLoop().RunUntilIdle(); }
+
+  base::test::TaskEnvironment env_;
+  ipfs::CarBatcher batcher_;
+  std::string parent_ = BinCid('\x70', 'p');
+  std::vector<std::string> children_;
+  std::map<std::string, int> answers_;
+  std::map<std::string, ipfs::CarBatcher::Canceller> cancel_;
+  std::function<void()> on_answer_;
+  std::vector<std::string> singles_;
+  std::string car_url_;
+  ipfs::CarBatcher::OnComplete car_done_;
+  ipfs::BlockHttpRequest::ChunkObserver car_chunks_;
+  bool car_cancelled_ = false;
+};
+}  // namespace
+
+TEST_F(CarBatcherTest, SiblingsBecomeOneCar) {
+  for (auto i = 0; i < 3; ++i) {
+    Add(kGwA, children_[i]);
+  }
+  Settle();
+  EXPECT_TRUE(singles_.empty());
+  EXPECT_EQ(car_url_, kGwA + ("ipfs/" + Text(parent_)) + "?dag-scope=all");
+  ASSERT_TRUE(car_chunks_);
+  EXPECT_TRUE(car_chunks_(Car({{children_[0], "zero"},
+                               {children_[1], "one"},
+                               {children_[2], "two"}})));
+  for (auto i = 0; i < 3; ++i) {
+    EXPECT_EQ(answers_[Url(kGwA, children_[i])], 200) << i;
+  }
+  EXPECT_EQ(batcher_.blocks_batched(), 3UL);
+}
+
+TEST_F(CarBatcherTest, LastWaiterCancelledFromABlockCallback) {
+  for (auto i = 0; i < 3; ++i) {
+    Add(kGwA, children_[i]);
+  }
+  Settle();
+  ASSERT_TRUE(car_chunks_);
+  // The first answer makes the rest unnecessary, e.g. the page went away.
+  on_answer_ = [this]() {
+    on_answer_ = nullptr;
+    for (auto i = 1; i < 3; ++i) {
+      std::move(cancel_.at(Url(kGwA, children_[i])))();
+    }
+  };
+  car_chunks_(Car({{children_[0], "zero"}, {children_[1], "one"}}));
+  EXPECT_TRUE(car_cancelled_);
+  EXPECT_EQ(answers_.size(), 1UL);
+  EXPECT_TRUE(singles_.empty());
+}
+
+TEST_F(CarBatcherTest, OnlyWaitersBoundForTheCarsGatewayAreAnswered) {
+  for (auto i = 0; i < 3; ++i) {
+    Add(kGwA, children_[i]);
+  }
+  Add(kGwB, children_[0]);
+  Settle();
+  ASSERT_TRUE(car_url_.starts_with(kGwA)) << car_url_;
+  car_chunks_(Car({{children_[0], "zero"}}));
+  EXPECT_EQ(answers_[Url(kGwA, children_[0])], 200);
+  EXPECT_FALSE(answers_.contains(Url(kGwB, children_[0])));
+  EXPECT_TRUE(singles_.empty());
+  // The CAR ends without the rest: everything still waiting goes singly,
+  //   each to the gateway it was bound for.
+  car_done_(200, "", [](auto) { return std::string{}; });
+  EXPECT_EQ(singles_.size(), 3UL);
+  EXPECT_NE(std::find(singles_.begin(), singles_.end(),
+                      Url(kGwB, children_[0])),
+            singles_.end());
+}
+
+TEST_F(CarBatcherTest, SpareBlocksOnlyAnswerTheirOwnGateway) {
+  for (auto i = 0; i < 3; ++i) {
+    Add(kGwA, children_[i]);
+  }
+  Settle();
+  car_chunks_(Car({{children_[0], "zero"},
+                   {children_[1], "one"},
+                   {children_[2], "two"},
+                   {children_[3], "three"}}));
+  car_done_(200, "", [](auto) { return std::string{}; });
+  ASSERT_EQ(answers_.size(), 3UL);
+  // Nobody asked for the last one. Asked of another gateway, it's fetched.
+  Add(kGwB, children_[3]);
+  Settle();
+  EXPECT_EQ(singles_, std::vector<std::string>{Url(kGwB, children_[3])});
+  EXPECT_FALSE(answers_.contains(Url(kGwB, children_[3])));
+  // Asked of the one that served it, it's already here.
+  Add(kGwA, children_[3]);
+  Settle();
+  EXPECT_EQ(answers_[Url(kGwA, children_[3])], 200);
+  EXPECT_EQ(singles_.size(), 1UL);
+}
@@ -0,0 +1,96 @@
+#include "car_reader.h"
+
+#include <base/logging.h>
+
+using Self = ipfs::CarReader;
+
+Self::CarReader(OnBlock cb, std::size_t max_bytes)
+    : on_block_{std::move(cb)}, max_bytes_{max_bytes} {}
+Self::~CarReader() noexcept = default;
+
+bool Self::Feed(std::string_view chunk) {
+  if (failed_) {
+    return false;
+  }
+  fed_ += chunk.size();
+  if (fed_ > max_bytes_) {
+    LOG(WARNING) << "CAR exceeded " << max_bytes_ << " bytes, abandoning.";
+    failed_ = true;
+    return false;
+  }
+  buffer_.append(chunk);
+  std::size_t used = 0UL;
+  while (used < buffer_.size()) {
+    auto n = Next(as_bytes(std::string_view{buffer_}.substr(used)));
+    if (!n) {
+      failed_ = true;
+      return false;
+    }
+    if (!*n) {
+      break;
+    }
+    used += *n;
+  }
+  buffer_.erase(0UL, used);
+  return true;
+}
+auto Self::Next(ByteView bytes) -> std::optional<std::size_t> {
+  auto rest = bytes;
+  auto len = ReadVarint(rest);
+  if (!len) {
+    // A varint is at most 10 bytes; if we have more than that it's garbage.
+    return bytes.size() > 10UL ? std::nullopt : std::optional{0UL};
+  }
+  auto prefix = bytes.size() - rest.size();
+  if (*len > max_bytes_) {
+    return std::nullopt;
+  }
+  if (rest.size() < *len) {
+    return 0UL;
+  }
+  auto section = rest.first(static_cast<std::size_t>(*len));
+  if (!header_done_) {
+    // DAG-CBOR {roots, version}. Only the version would matter, and a
+    //   CARv2 wouldn't have parsed this far as a sensible length anyway.
+    header_done_ = true;
+    return prefix + section.size();
+  }
+  auto cid_len = CidLength(section);
+  if (!cid_len) {
+    return std::nullopt;
+  }
+  blocks_++;
+  on_block_(section.first(*cid_len), section.subspan(*cid_len));
+  return prefix + section.size();
+}
+bool Self::complete() const {
+  return header_done_ && buffer_.empty() && !failed_;
+}
+auto Self::CidLength(ByteView bytes) -> std::optional<std::size_t> {
+  if (bytes.size() >= 34UL && bytes[0] == std::byte{0x12} &&
+      bytes[1] == std::byte{0x20}) {
+    return 34UL;  // CIDv0: a bare sha2-256 multihash
+  }
+  auto rest = bytes;
+  auto version = ReadVarint(rest);
+  auto codec = ReadVarint(rest);
+  auto hash_type = ReadVarint(rest);
+  auto digest_len = ReadVarint(rest);
+  if (!version || *version != 1U || !codec || !hash_type || !digest_len ||
+      *digest_len > rest.size()) {
+    return std::nullopt;
+  }
+  return bytes.size() - rest.size() + static_cast<std::size_t>(*digest_len);
+}
+auto Self::ReadVarint(ByteView& bytes) -> std::optional<std::uint64_t> {
+  std::uint64_t result = 0U;
+  for (auto i = 0UL; i < bytes.size() && i < 10UL; ++i) {
+    auto b = std::to_integer<std::uint64_t>(bytes[i]);
+    result |= (b & 0x7FU) << (7U * i);
+    if (!(b & 0x80U)) {
+      bytes = bytes.subspan(i + 1UL);
+      return result;
+    }
+  }
+  return std::nullopt;
+}
@@ -0,0 +1,65 @@
+#ifndef IPFS_CAR_READER_H_
+#define IPFS_CAR_READER_H_
+
+#include <vocab/byte_view.h>
+
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <string>
+#include <string_view>
+
+namespace ipfs {
+
+/*! Incremental CARv1 parser, for a CAR arriving over the network in chunks
+ *  \details The header is skipped over (roots aren't needed - the caller
+ *    knows what it asked for). Each complete section is handed to the block
+ *    callback as soon as its last byte arrives, with the CID still in binary.
+ *    Nothing here verifies hashes; whoever consumes the block does that.
+ */
+class CarReader {
+ public:
+  /*! \param cid Binary CID (v0 multihash, or v1)
+   *  \param block The block's bytes
+   */
+  using OnBlock = std::function<void(ByteView cid, ByteView block)>;
+
+  /*! \param max_bytes Give up if the CAR is bigger than this */
+  CarReader(OnBlock, std::size_t max_bytes);
+  ~CarReader() noexcept;
+
+  /*! \brief Feed the next chunk
+   *  \return false if the CAR is malformed or too big; stop feeding
+   */
+  bool Feed(std::string_view chunk);
+
+  /*! \return Whether everything fed ended on a section boundary */
+  bool complete() const;
+
+  std::size_t blocks() const { return blocks_; }
+
+  /*! \brief Length of the binary CID at the start of bytes, if whole */
+  static std::optional<std::size_t> CidLength(ByteView bytes);
+
+  /*! \brief Decode an unsigned LEB128 varint at the start of bytes
+   *  \param bytes Advanced past the varint on success
+   */
+  static std::optional<std::uint64_t> ReadVarint(ByteView& bytes);
+
+ private:
+  OnBlock on_block_;
+  std::size_t max_bytes_;
+  std::size_t fed_ = 0UL;
+  std::size_t blocks_ = 0UL;
+  bool header_done_ = false;
+  bool failed_ = false;
+  std::string buffer_;
+
+  /*! \return Bytes consumed by the next section, 0 if it isn't all here
+   *    yet, nullopt if malformed
+   */
+  std::optional<std::size_t> Next(ByteView);
+};
+}  // namespace ipfs
+
+#endif  // IPFS_CAR_READER_H_
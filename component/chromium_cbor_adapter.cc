@@ -1,13 +1,21 @@
 #include "chromium_cbor_adapter.h"
 
 #include <base/logging.h>
+#include <base/memory/ptr_util.h>
 #include <components/cbor/reader.h>
 
 using Self = ipfs::ChromiumCborAdapter;
 
+namespace {
+/*! Reader's default of 16 is too shallow for real DAG-CBOR (ADLs, manifests)
+ */
+constexpr int kMaxNesting = 256;
+}  // namespace
+
 auto Self::Parse(ipfs::ByteView bytes) -> std::unique_ptr<DagCborValue> {
   cbor::Reader::Config cfg;
   cfg.parse_tags = true;
+  cfg.max_nesting_level = kMaxNesting;
   auto parsed = cbor::Reader::Read(as_octets(bytes), cfg);
   if (parsed.has_value()) {
     return std::make_unique<ChromiumCborAdapter>(std::move(parsed.value()));
@@ -17,14 +25,14 @@ auto Self::Parse(ipfs::ByteView bytes) -> std::unique_ptr<DagCborValue> {
 }
 
 bool Self::is_map() const {
-  return cbor_.is_map();
+  return cbor_->is_map();
 }
 bool Self::is_array() const {
-  return cbor_.is_array();
+  return cbor_->is_array();
 }
 auto Self::at(std::string_view key) const -> std::unique_ptr<DagCborValue> {
   if (is_map()) {
-    auto& m = cbor_.GetMap();
+    auto& m = cbor_->GetMap();
     auto it = m.find(cbor::Value{
 #ifdef BASE_STRINGS_STRING_PIECE_H_
         base::StringPiece{key}
@@ -33,20 +41,20 @@ auto Self::at(std::string_view key) const -> std::unique_ptr<DagCborValue> {
 #endif
     });
     if (m.end() != it) {
-      return std::make_unique<Self>(it->second.Clone());
+      return base::WrapUnique(new Self(root_, it->second));
     }
   }
   return {};
 }
 std::optional<std::uint64_t> Self::as_unsigned() const {
-  if (cbor_.is_unsigned()) {
-    return cbor_.GetUnsigned();
+  if (cbor_->is_unsigned()) {
+    return cbor_->GetUnsigned();
   }
   return std::nullopt;
 }
 std::optional<std::int64_t> Self::as_signed() const {
-  if (cbor_.is_integer()) {
-    return cbor_.GetInteger();
+  if (cbor_->is_integer()) {
+    return cbor_->GetInteger();
   }
   return {};
 }
@@ -55,25 +63,25 @@ std::optional<double> Self::as_float() const {
 }
 
 std::optional<std::string> Self::as_string() const {
-  if (cbor_.is_string()) {
-    return cbor_.GetString();
+  if (cbor_->is_string()) {
+    return cbor_->GetString();
   }
   return std::nullopt;
 }
 auto Self::as_bytes() const -> std::optional<std::vector<std::uint8_t>> {
-  if (cbor_.is_bytestring()) {
-    return cbor_.GetBytestring();
+  if (cbor_->is_bytestring()) {
+    return cbor_->GetBytestring();
   }
   return std::nullopt;
 }
 auto Self::as_link() const -> std::optional<Cid> {
-  VLOG(2) << "Trying to do an as_link(" << static_cast<int>(cbor_.type()) << ','
-          << std::boolalpha << cbor_.has_tag() << ")";
-  if (!cbor_.has_tag() || cbor_.GetTag() != 42UL || !cbor_.is_bytestring()) {
+  VLOG(2) << "Trying to do an as_link(" << static_cast<int>(cbor_->type()) << ','
+          << std::boolalpha << cbor_->has_tag() << ")";
+  if (!cbor_->has_tag() || cbor_->GetTag() != 42UL || !cbor_->is_bytestring()) {
     VLOG(2) << "This is not a link.";
     return std::nullopt;
   }
-  auto& bytes = cbor_.GetBytestring();
+  auto& bytes = cbor_->GetBytestring();
   auto no_mb = ipfs::as_bytes(bytes).subspan(1);//drop the multibase prefix, which is 1B for all supported multibases
   auto result = Cid(no_mb);
   if (result.valid()) {
@@ -84,28 +92,34 @@ auto Self::as_link() const -> std::optional<Cid> {
   }
 }
 std::optional<bool> Self::as_bool() const {
-  if (cbor_.is_bool()) {
-    return cbor_.GetBool();
+  if (cbor_->is_bool()) {
+    return cbor_->GetBool();
   }
   return std::nullopt;
 }
 void Self::iterate_map(MapElementCallback cb) const {
-  auto& m = cbor_.GetMap();
+  auto& m = cbor_->GetMap();
   for (auto& [k,v] : m) {
-    cb(k.GetString(), Self{v});
+    cb(k.GetString(), Self{root_, v});
   }
 }
 void Self::iterate_array(ArrayElementCallback cb) const {
-  auto& a = cbor_.GetArray();
+  auto& a = cbor_->GetArray();
   for (auto& e : a) {
-    cb(Self{e});
+    cb(Self{root_, e});
   }
 }
 
-Self::ChromiumCborAdapter() : cbor_{cbor::Value::SimpleValue::UNDEFINED} {}
-Self::ChromiumCborAdapter(cbor::Value const& v) : cbor_{v.Clone()} {}
-Self::ChromiumCborAdapter(cbor::Value&& v) : cbor_{std::move(v)} {}
-Self::ChromiumCborAdapter(ChromiumCborAdapter const& rhs)
-    : cbor_{rhs.cbor_.Clone()} {}
+Self::ChromiumCborAdapter()
+    : ChromiumCborAdapter(cbor::Value{cbor::Value::SimpleValue::UNDEFINED}) {}
+Self::ChromiumCborAdapter(cbor::Value const& v)
+    : ChromiumCborAdapter(v.Clone()) {}
+Self::ChromiumCborAdapter(cbor::Value&& v)
+    : root_{std::make_shared<cbor::Value const>(std::move(v))},
+      cbor_{root_.get()} {}
+Self::ChromiumCborAdapter(ChromiumCborAdapter const& rhs) = default;
+Self::ChromiumCborAdapter(std::shared_ptr<cbor::Value const> root,
+                          cbor::Value const& node)
+    : root_{std::move(root)}, cbor_{&node} {}
 
 Self::~ChromiumCborAdapter() noexcept {}
@@ -1,16 +1,28 @@
 #ifndef IPFS_CHROMIUM_CBOR_ADAPTER_H_
 #define IPFS_CHROMIUM_CBOR_ADAPTER_H_
 
+#include <base/memory/raw_ptr.h>
 #include <components/cbor/values.h>
 
 #include <ipfs_client/ctx/cbor_parser.h>
 #include <ipfs_client/dag_cbor_value.h>
 
+#include <memory>
+
 namespace ipfs {
 /*! Adapting Chromium's components/cbor to the API needed by ipfs_client
+ *  \details A cursor into a parsed document: the whole tree is shared by
+ *    every value handed out from it (at, iterate_map, iterate_array, copies),
+ *    each of which just points at its own node. Nothing is cloned on the way
+ *    down, and the tree lives as long as any of them.
  */
 class ChromiumCborAdapter final : public DagCborValue, public ctx::CborParser {
-  cbor::Value cbor_;
+  std::shared_ptr<cbor::Value const> root_;
+  raw_ptr<cbor::Value const> cbor_;
+
+  /*! A node within root */
+  ChromiumCborAdapter(std::shared_ptr<cbor::Value const> root,
+                      cbor::Value const& node);
 
   std::unique_ptr<DagCborValue> at(std::string_view) const override;
   std::optional<std::uint64_t> as_unsigned() const override;
@@ -34,10 +46,12 @@ class ChromiumCborAdapter final : public DagCborValue, public ctx::CborParser {
  public:
   explicit ChromiumCborAdapter();
 
-  /*! \brief Move ctor
+  /*! \brief Take ownership of a whole document
    */
   ChromiumCborAdapter(cbor::Value&&);
-  ChromiumCborAdapter(cbor::Value const&);
+  /*! \brief Copies v: prefer the move constructor */
+  ChromiumCborAdapter(cbor::Value const& v);
+  /*! \brief Another cursor at the same node of the same document */
   ChromiumCborAdapter(ChromiumCborAdapter const& rhs);
   ~ChromiumCborAdapter() noexcept override;
 
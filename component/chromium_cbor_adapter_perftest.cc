@@ -0,0 +1,152 @@
+#include "chromium_cbor_adapter.h"
+#include "lazy_cbor_adapter.h"
+
+#include <base/strings/stringprintf.h>
+#include <base/timer/elapsed_timer.h>
+#include <components/cbor/writer.h>
+#include <testing/gtest/include/gtest/gtest.h>
+#include <testing/perf/perf_result_reporter.h>
+
+#include <string_view>
+#include <type_traits>
+
+namespace {
+constexpr int kDepth = 200;
+constexpr std::size_t kWidth = 10000UL;
+constexpr std::size_t kPayload = 1024UL;
+constexpr int kPasses = 10;
+
+/*! A map nested kDepth deep, with some bytes at every level */
+cbor::Value Deep() {
+  cbor::Value v{cbor::Value::MapValue{}};
+  for (auto i = 0; i < kDepth; ++i) {
+    cbor::Value::MapValue m;
+    m.emplace(cbor::Value{"payload"},
+              cbor::Value{std::vector<std::uint8_t>(kPayload, 0x42)});
+    m.emplace(cbor::Value{"child"}, std::move(v));
+    v = cbor::Value{std::move(m)};
+  }
+  return v;
+}
+/*! Like a large HAMT shard or directory listing: many small maps */
+cbor::Value Wide() {
+  cbor::Value::ArrayValue a;
+  for (auto i = 0UL; i < kWidth; ++i) {
+    cbor::Value::MapValue m;
+    m.emplace(cbor::Value{"Name"},
+              cbor::Value{base::StringPrintf("entry-%zu", i)});
+    m.emplace(cbor::Value{"Tsize"}, cbor::Value{static_cast<int64_t>(i)});
+    m.emplace(cbor::Value{"Hash"},
+              cbor::Value{std::vector<std::uint8_t>(36, 0x12)});
+    a.emplace_back(std::move(m));
+  }
+  cbor::Value::MapValue root;
+  root.emplace(cbor::Value{"Links"}, cbor::Value{std::move(a)});
+  return cbor::Value{std::move(root)};
+}
+std::vector<std::uint8_t> Encode(cbor::Value const& v) {
+  return cbor::Writer::Write(v, kDepth + 1).value();
+}
+/*! Touch every node, the way a DAG-CBOR codec does. Returns the count.
+ *  Callbacks return true in case the callback type wants to know whether to
+ *  keep going.
+ */
+std::size_t Walk(ipfs::DagCborValue const& v) {
+  std::size_t n = 1UL;
+  if (v.is_map()) {
+    v.iterate_map([&n](std::string_view, ipfs::DagCborValue const& e) {
+      n += Walk(e);
+      return true;
+    });
+  } else if (v.is_array()) {
+    v.iterate_array([&n](ipfs::DagCborValue const& e) {
+      n += Walk(e);
+      return true;
+    });
+  }
+  return n;
+}
+/*! Follow "child" all the way down with at(), as path resolution does */
+int Descend(ipfs::DagCborValue const& root) {
+  auto depth = 0;
+  auto cur = root.at("child");
+  while (cur) {
+    ++depth;
+    cur = cur->at("child");
+  }
+  return depth;
+}
+
+template <class Parser>
+class CborAdapterPerfTest : public testing::Test {
+ protected:
+  void Report(std::string const& story,
+              std::string const& metric,
+              base::TimeDelta t) {
+    perf_test::PerfResultReporter reporter(Name(), story);
+    reporter.RegisterImportantMetric(metric, "us");
+    reporter.AddResult(metric, t.InMicrosecondsF());
+  }
+  static std::string Name() {
+    if constexpr (std::is_same_v<Parser, ipfs::LazyCborAdapter>) {
+      return "LazyCborAdapter";
+    } else {
+      return "ChromiumCborAdapter";
+    }
+  }
+  Parser parser_;
+};
+using Parsers =
+    testing::Types<ipfs::ChromiumCborAdapter, ipfs::LazyCborAdapter>;
+TYPED_TEST_SUITE(CborAdapterPerfTest, Parsers);
+}  // namespace
+
+TYPED_TEST(CborAdapterPerfTest, Deep) {
+  auto bytes = Encode(Deep());
+  auto doc = this->parser_.Parse(ipfs::as_bytes(bytes));
+  ASSERT_TRUE(doc);
+  base::ElapsedTimer timer;
+  std::size_t nodes = 0UL;
+  for (auto p = 0; p < kPasses; ++p) {
+    nodes += Walk(*doc);
+  }
+  this->Report("deep_200", "walk", timer.Elapsed() / kPasses);
+  EXPECT_EQ(nodes, kPasses * (2UL * kDepth + 1UL));
+
+  base::ElapsedTimer descend_timer;
+  auto depth = 0;
+  for (auto p = 0; p < kPasses; ++p) {
+    depth += Descend(*doc);
+  }
+  this->Report("deep_200", "descend", descend_timer.Elapsed() / kPasses);
+  EXPECT_EQ(depth, kPasses * kDepth);
+}
+
+TYPED_TEST(CborAdapterPerfTest, Wide) {
+  auto bytes = Encode(Wide());
+  base::ElapsedTimer parse_timer;
+  auto doc = this->parser_.Parse(ipfs::as_bytes(bytes));
+  this->Report("wide_10000", "parse", parse_timer.Elapsed());
+  ASSERT_TRUE(doc);
+  base::ElapsedTimer timer;
+  std::size_t nodes = 0UL;
+  for (auto p = 0; p < kPasses; ++p) {
+    auto links = doc->at("Links");
+    ASSERT_TRUE(links);
+    nodes += Walk(*links);
+  }
+  this->Report("wide_10000", "walk_links", timer.Elapsed() / kPasses);
+  EXPECT_EQ(nodes, kPasses * (1UL + kWidth * 4UL));
+}
+
+TYPED_TEST(CborAdapterPerfTest, OneField) {
+  // Resolving one path segment: parse, then a single lookup.
+  auto bytes = Encode(Wide());
+  base::ElapsedTimer timer;
+  for (auto p = 0; p < kPasses; ++p) {
+    auto doc = this->parser_.Parse(ipfs::as_bytes(bytes));
+    ASSERT_TRUE(doc);
+    ASSERT_TRUE(doc->at("Links"));
+  }
+  this->Report("wide_10000", "parse_and_at", timer.Elapsed() / kPasses);
+}
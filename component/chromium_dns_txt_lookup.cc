@@ -1,19 +1,205 @@
 #include "chromium_dns_txt_lookup.h"
 
+#include "dns_txt_cache.h"
 #include "inter_request_state.h"
 
+#include <base/functional/bind.h>
+#include <base/functional/callback_helpers.h>
+#include <base/logging.h>
+#include <base/task/sequenced_task_runner.h>
+
+#include <algorithm>
+
 using Self = ipfs::ChromiumDnsTxtLookup;
 
 void Self::SendDnsTextRequest(std::string host,
                               DnsTextResultsCallback res,
                               DnsTextCompleteCallback don) {
-  auto don_wrap = [don, this, host]() {
+  if (cache_ && !cache_->loaded()) {
+    // A disk read is cheaper than a DNS query, and may well answer it.
+    cache_->WhenLoaded(base::BindOnce(&Self::SendDnsTextRequest,
+                                      weak_factory_.GetWeakPtr(),
+                                      std::move(host), std::move(res),
+                                      std::move(don)));
+    return;
+  }
+  auto now = base::Time::Now();
+  if (auto* e = cache_ ? cache_->Use(host, now) : nullptr) {
+    auto records = e->records;
+    if (e->StateAt(now) != DnsTxtCache::State::Fresh) {
+      VLOG(2) << "Answering " << host << " from cache while re-resolving.";
+      Query(host);
+    }
+    ArmRefresh();
+    res(records);
     don();
-    dns_reqs_.erase(host);
-  };
-  auto* nc = state_->network_context();
-  dns_reqs_[host].push_back(
-      std::make_unique<DnsTxtRequest>(host, res, don_wrap, nc));
+    return;
+  }
+  if (in_flight_.contains(host)) {
+    VLOG(2) << "Joining the TXT lookup of " << host << " already in flight.";
+  }
+  auto& f = Query(host);
+  f.on_results.push_back(std::move(res));
+  f.on_complete.push_back(std::move(don));
+}
+auto Self::Query(std::string const& host) -> InFlight& {
+  if (auto it = in_flight_.find(host); it != in_flight_.end()) {
+    return it->second;
+  }
+  if (cache_) {
+    cache_->Refreshing(host);
+  }
+  auto& f = in_flight_[host];
+  auto id = f.id = ++next_query_;
+  // Weak: Finish hands the requests to a posted task, which may outlive this.
+  if (auto* network_context = network_context_.Run()) {
+    auto w = weak_factory_.GetWeakPtr();
+    auto on_res = [w, host, id](std::vector<std::string> const& r) {
+      if (w) {
+        w->OnTextResults(host, id, r);
+      }
+    };
+    auto on_don = [w, host, id]() {
+      if (w) {
+        w->OnComplete(host, id);
+      }
+    };
+    f.request = std::make_unique<DnsTxtRequest>(host, on_res, on_don,
+                                                network_context);
+    ++f.pending;
+  }
+  if (auto* loader = doh_loader_ ? doh_loader_.Run() : nullptr) {
+    for (auto& resolver : doh_resolvers_) {
+      f.doh.push_back(std::make_unique<DohTxtRequest>(
+          host, resolver, loader,
+          base::BindOnce(&Self::Settle, weak_factory_.GetWeakPtr(), host,
+                         id)));
+      ++f.pending;
+    }
+  }
+  if (!f.pending) {
+    LOG(ERROR) << "No way to resolve TXT records for " << host;
+    base::SequencedTaskRunner::GetCurrentDefault()->PostTask(
+        FROM_HERE, base::BindOnce(&Self::Finish, weak_factory_.GetWeakPtr(),
+                                  host, std::optional<Answer>{}));
+  }
+  return f;
+}
+auto Self::Find(std::string const& host, std::uint64_t id) -> InFlight* {
+  // A losing request may call back after its query is over, even after
+  //   another for the same host has begun.
+  auto it = in_flight_.find(host);
+  return it == in_flight_.end() || it->second.id != id ? nullptr : &it->second;
+}
+void Self::OnTextResults(std::string const& host,
+                         std::uint64_t id,
+                         std::vector<std::string> const& results) {
+  if (auto* f = Find(host, id)) {
+    f->system.insert(f->system.end(), results.begin(), results.end());
+  }
+}
+void Self::OnComplete(std::string const& host, std::uint64_t id) {
+  auto* f = Find(host, id);
+  if (!f) {
+    return;
+  }
+  // The system resolver doesn't say whether it failed or found nothing.
+  Answer a;
+  a.records = std::move(f->system);
+  Settle(host, id, std::move(a));
 }
-Self::ChromiumDnsTxtLookup(InterRequestState& st) : state_{&st} {}
+void Self::Settle(std::string const& host,
+                  std::uint64_t id,
+                  std::optional<Answer> a) {
+  auto* found = Find(host, id);
+  if (!found) {
+    return;
+  }
+  auto& f = *found;
+  --f.pending;
+  auto dnslink = a && std::ranges::any_of(a->records, [](auto& r) {
+                   return r.starts_with("dnslink=");
+                 });
+  if (dnslink) {
+    VLOG(2) << "Took " << (f.pending ? "first" : "last") << " answer for "
+            << host << " with " << f.pending << " resolvers outstanding.";
+    Finish(host, std::move(a));
+    return;
+  }
+  if (a && (!f.fallback || f.fallback->records.empty())) {
+    f.fallback = std::move(a);
+  }
+  if (f.pending <= 0) {
+    Finish(host, std::move(f.fallback));
+  }
+}
+void Self::Finish(std::string const& host, std::optional<Answer> a) {
+  auto node = in_flight_.extract(host);
+  if (node.empty()) {
+    return;
+  }
+  auto& f = node.mapped();
+  // This may be running inside a request's own callback; let it unwind first.
+  //   Destroying the others cancels them.
+  base::SequencedTaskRunner::GetCurrentDefault()->PostTask(
+      FROM_HERE, base::DoNothingWithBoundArgs(std::move(f.request),
+                                              std::move(f.doh)));
+  if (a && !a->records.empty()) {
+    for (auto& cb : f.on_results) {
+      cb(a->records);
+    }
+    if (cache_) {
+      // A failed refresh leaves the last good answer in place.
+      cache_->Store(host, std::move(a->records), a->ttl, base::Time::Now());
+      ArmRefresh();
+    }
+  }
+  // Already out of in_flight_, so a callback starting a new lookup of this
+  //   host gets a fresh query.
+  for (auto& cb : f.on_complete) {
+    cb();
+  }
+}
+void Self::ArmRefresh() {
+  auto next = cache_ ? cache_->NextRefresh() : std::nullopt;
+  if (!next) {
+    refresh_timer_.Stop();
+    return;
+  }
+  auto delay = std::max(next->second - base::Time::Now(), base::TimeDelta{});
+  refresh_timer_.Start(FROM_HERE, delay,
+                       base::BindOnce(&Self::Refresh, base::Unretained(this)));
+}
+void Self::Refresh() {
+  auto next = cache_->NextRefresh();
+  if (next && next->second <= base::Time::Now()) {
+    VLOG(1) << "Refreshing popular DNSLink host " << next->first;
+    cache_->Refreshing(next->first);
+    Query(next->first);
+  }
+  ArmRefresh();
+}
+Self::ChromiumDnsTxtLookup(InterRequestState& st,
+                           std::vector<std::string> doh_resolvers)
+    : ChromiumDnsTxtLookup(
+          base::BindRepeating(
+              [](InterRequestState* s) { return s->network_context(); },
+              base::Unretained(&st)),
+          &st.dns_txt_cache(),
+          base::BindRepeating(
+              [](InterRequestState* s) { return s->http_loader_factory(); },
+              base::Unretained(&st)),
+          std::move(doh_resolvers)) {}
+Self::ChromiumDnsTxtLookup(NetworkContextGetter network_context,
+                           DnsTxtCache* cache,
+                           LoaderFactoryGetter doh_loader,
+                           std::vector<std::string> doh_resolvers)
+    : network_context_{std::move(network_context)},
+      cache_{cache},
+      doh_loader_{std::move(doh_loader)},
+      doh_resolvers_{std::move(doh_resolvers)} {}
 Self::~ChromiumDnsTxtLookup() noexcept {}
+
+Self::InFlight::InFlight() = default;
+Self::InFlight::InFlight(InFlight&&) = default;
+Self::InFlight::~InFlight() noexcept = default;
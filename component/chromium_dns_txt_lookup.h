@@ -2,37 +2,133 @@
 #define IPFS_CHROMIUM_CHROMIUM_DNS_TXT_LOOKUP_H
 
 #include "dns_txt_request.h"
+#include "doh_txt_request.h"
 
 #include <ipfs_client/ctx/dns_txt_lookup.h>
 
+#include <base/functional/callback.h>
+#include <base/memory/raw_ptr.h>
+#include <base/memory/weak_ptr.h>
+#include <base/time/time.h>
+#include <base/timer/timer.h>
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace network::mojom {
+class NetworkContext;
+class URLLoaderFactory;
+}
+
 namespace ipfs {
+class DnsTxtCache;
 class InterRequestState;
 /*! Lookup TXT records from a DNS service using Chromium facilities
  *  @note This is currently fragile, as only DNSClient is capable of these requests
  *    yet DNSClient may not always be available, depending on Chromium's parsing of
  *    system config files.
  *  @todo Fix the note.
+ *  Concurrent lookups of the same host share a single query: every caller's
+ *    callbacks are fanned out from the one query's results & completion.
+ *  A query goes to the system resolver and any DNS-over-HTTPS resolvers at
+ *    once; the first answer containing a dnslink= record wins, and the rest
+ *    are cancelled. Failing that, the last to finish decides.
+ *  With a DnsTxtCache, a host that's been resolved before is answered from
+ *    it right away - stale-while-revalidate past its TTL - and names in
+ *    regular use are re-resolved in the background before they expire.
+ *    Until the cache has read back what it saved last session, lookups wait
+ *    on that rather than going straight to the network.
  */
 class ChromiumDnsTxtLookup : public ctx::DnsTxtLookup {
-  raw_ptr<InterRequestState> state_;
-  std::map<std::string, std::vector<std::unique_ptr<DnsTxtRequest>>> dns_reqs_;
+ public:
+  using NetworkContextGetter =
+      base::RepeatingCallback<network::mojom::NetworkContext*()>;
+  using LoaderFactoryGetter =
+      base::RepeatingCallback<network::mojom::URLLoaderFactory*()>;
+
+ private:
+  /*! One query in flight, and everyone waiting on it */
+  struct InFlight {
+    InFlight();
+    InFlight(InFlight&&);
+    ~InFlight() noexcept;
+    std::unique_ptr<DnsTxtRequest> request;
+    std::vector<std::unique_ptr<DohTxtRequest>> doh;
+    std::vector<DnsTextResultsCallback> on_results;
+    std::vector<DnsTextCompleteCallback> on_complete;
+    /*! Received from the system resolver so far */
+    std::vector<std::string> system;
+    /*! The best answer yet without a dnslink= record */
+    std::optional<DohTxtRequest::Answer> fallback;
+    /*! Resolvers yet to answer */
+    int pending = 0;
+    /*! Tells apart successive queries for the same host */
+    std::uint64_t id = 0UL;
+  };
+  using Answer = DohTxtRequest::Answer;
+  NetworkContextGetter network_context_;
+  raw_ptr<DnsTxtCache> cache_;
+  LoaderFactoryGetter doh_loader_;
+  std::vector<std::string> doh_resolvers_;
+  std::uint64_t next_query_ = 0UL;
+  std::map<std::string, InFlight, std::less<>> in_flight_;
+  base::OneShotTimer refresh_timer_;
 
   void SendDnsTextRequest(std::string host,
                           DnsTextResultsCallback,
                           DnsTextCompleteCallback) override;
+  /*! \return The query with this id, if it's still in flight */
+  InFlight* Find(std::string const& host, std::uint64_t id);
+  void OnTextResults(std::string const& host,
+                     std::uint64_t id,
+                     std::vector<std::string> const&);
+  void OnComplete(std::string const& host, std::uint64_t id);
+  /*! \brief One resolver has finished: maybe the query has too */
+  void Settle(std::string const& host,
+              std::uint64_t id,
+              std::optional<Answer>);
+  void Finish(std::string const& host, std::optional<Answer>);
+  /*! \return The query in flight for host, started if need be */
+  InFlight& Query(std::string const& host);
+  void ArmRefresh();
+  void Refresh();
 
  public:
 
   /*!
    * \brief construct
    * \param state Access to nigh-globals, in particular network context.
+   * \param doh_resolvers URLs of DNS-over-HTTPS JSON endpoints to also ask
    */
-  ChromiumDnsTxtLookup(InterRequestState& state);
+  ChromiumDnsTxtLookup(InterRequestState& state,
+                       std::vector<std::string> doh_resolvers);
+
+  /*!
+   * \brief construct
+   * \param network_context Called for the network context as each query is
+   *    sent
+   * \param cache Where answers are kept between queries. May be null.
+   * \param doh_loader Called for what to send DoH queries with, if any
+   * \param doh_resolvers URLs of DNS-over-HTTPS JSON endpoints to also ask
+   */
+  ChromiumDnsTxtLookup(NetworkContextGetter network_context,
+                       DnsTxtCache* cache,
+                       LoaderFactoryGetter doh_loader = {},
+                       std::vector<std::string> doh_resolvers = {});
+
+  /*! \return Number of distinct hosts currently being queried */
+  std::size_t queries_in_flight() const { return in_flight_.size(); }
 
   /*!
    * \brief dtor
    */
   ~ChromiumDnsTxtLookup() noexcept override;
+
+ private:
+  base::WeakPtrFactory<ChromiumDnsTxtLookup> weak_factory_{this};
 };
 }  // namespace ipfs
 
@@ -0,0 +1,260 @@
+#include "chromium_dns_txt_lookup.h"
+
+#include "dns_txt_cache.h"
+
+#include <base/functional/bind.h>
+#include <base/run_loop.h>
+#include <base/test/task_environment.h>
+#include <mojo/public/cpp/bindings/remote.h>
+#include <net/base/address_list.h>
+#include <net/base/network_anonymization_key.h>
+#include <services/network/public/mojom/host_resolver.mojom.h>
+#include <services/network/test/test_network_context.h>
+#include <services/network/test/test_url_loader_factory.h>
+
+#include <gtest/gtest.h>
+
+namespace {
+/*! Counts host resolutions instead of doing them, answers on demand */
+class CountingNetworkContext final : public network::TestNetworkContext {
+ public:
+  void ResolveHost(
+      network::mojom::HostResolverHostPtr host,
+      net::NetworkAnonymizationKey const&,
+      network::mojom::ResolveHostParametersPtr,
+      mojo::PendingRemote<network::mojom::ResolveHostClient> client) override {
+    hosts.push_back(host->get_host_port_pair().host());
+    clients.emplace_back(std::move(client));
+  }
+  void Answer(std::size_t i, std::vector<std::string> const& txt) {
+    clients.at(i)->OnTextResults(txt);
+    // Braces convert to either vintage of the endpoint parameters.
+    clients.at(i)->OnComplete(0, net::ResolveErrorInfo{}, net::AddressList{},
+                              {});
+  }
+  std::vector<std::string> hosts;
+  std::vector<mojo::Remote<network::mojom::ResolveHostClient>> clients;
+};
+
+class ChromiumDnsTxtLookupTest : public testing::Test {
+ protected:
+  ipfs::ctx::DnsTxtLookup& lookup() { return lookup_; }
+  ipfs::ChromiumDnsTxtLookup::NetworkContextGetter Getter() {
+    return base::BindRepeating(
+        [](CountingNetworkContext* n) -> network::mojom::NetworkContext* {
+          return n;
+        },
+        base::Unretained(&network_));
+  }
+
+  base::test::TaskEnvironment env_{
+      base::test::TaskEnvironment::TimeSource::MOCK_TIME};
+  CountingNetworkContext network_;
+  ipfs::ChromiumDnsTxtLookup lookup_{Getter(), nullptr};
+};
+
+class CachedDnsTxtLookupTest : public ChromiumDnsTxtLookupTest {
+ protected:
+  /*! \return Whether it was answered without waiting */
+  bool Visit(std::string const& host) {
+    auto answered = false;
+    ipfs::ctx::DnsTxtLookup& l = cached_;
+    l.SendDnsTextRequest(
+        host, [](std::vector<std::string> const&) {},
+        [&answered]() { answered = true; });
+    return answered;
+  }
+
+  ipfs::DnsTxtCache cache_;
+  ipfs::ChromiumDnsTxtLookup cached_{Getter(), &cache_};
+};
+class RacingDnsTxtLookupTest : public ChromiumDnsTxtLookupTest {
+ protected:
+  void Lookup() {
+    ipfs::ctx::DnsTxtLookup& l = racing_;
+    l.SendDnsTextRequest(
+        "_dnslink.example.com",
+        [this](std::vector<std::string> const& r) {
+          got_.insert(got_.end(), r.begin(), r.end());
+        },
+        [this]() { ++done_; });
+    base::RunLoop().RunUntilIdle();
+  }
+  void DohAnswers(std::string const& json,
+                  net::HttpStatusCode status = net::HTTP_OK) {
+    auto url = ipfs::DohTxtRequest::QueryUrl(kResolver, "_dnslink.example.com");
+    ASSERT_TRUE(doh_.SimulateResponseForPendingRequest(url, json, status));
+    base::RunLoop().RunUntilIdle();
+  }
+
+  static constexpr char kResolver[] = "https://doh.example/dns-query";
+  network::TestURLLoaderFactory doh_;
+  ipfs::ChromiumDnsTxtLookup racing_{
+      Getter(), nullptr,
+      base::BindRepeating(
+          [](network::TestURLLoaderFactory* f)
+              -> network::mojom::URLLoaderFactory* { return f; },
+          base::Unretained(&doh_)),
+      {kResolver}};
+  std::vector<std::string> got_;
+  int done_ = 0;
+};
+constexpr char kHost[] = "_dnslink.example.com";
+}  // namespace
+
+TEST_F(ChromiumDnsTxtLookupTest, ConcurrentLookupsShareOneQuery) {
+  constexpr auto kCallers = 50;
+  std::vector<std::vector<std::string>> got(kCallers);
+  auto done = 0;
+  for (auto i = 0; i < kCallers; ++i) {
+    lookup().SendDnsTextRequest(
+        "_dnslink.example.com",
+        [&got, i](std::vector<std::string> const& r) {
+          got[i].insert(got[i].end(), r.begin(), r.end());
+        },
+        [&done]() { ++done; });
+  }
+  base::RunLoop().RunUntilIdle();
+  ASSERT_EQ(network_.hosts.size(), 1UL);
+  EXPECT_EQ(network_.hosts.front(), "_dnslink.example.com");
+  EXPECT_EQ(lookup_.queries_in_flight(), 1UL);
+
+  network_.Answer(0UL, {"dnslink=/ipfs/bafyexample"});
+  base::RunLoop().RunUntilIdle();
+  EXPECT_EQ(done, kCallers);
+  for (auto& g : got) {
+    ASSERT_EQ(g.size(), 1UL);
+    EXPECT_EQ(g.front(), "dnslink=/ipfs/bafyexample");
+  }
+  EXPECT_EQ(lookup_.queries_in_flight(), 0UL);
+}
+
+TEST_F(ChromiumDnsTxtLookupTest, DistinctHostsAndLaterLookupsQueryAgain) {
+  auto done = 0;
+  auto ignore = [](std::vector<std::string> const&) {};
+  auto count = [&done]() { ++done; };
+  lookup().SendDnsTextRequest("_dnslink.a.example", ignore, count);
+  lookup().SendDnsTextRequest("_dnslink.b.example", ignore, count);
+  lookup().SendDnsTextRequest("_dnslink.a.example", ignore, count);
+  base::RunLoop().RunUntilIdle();
+  EXPECT_EQ(network_.hosts.size(), 2UL);
+
+  network_.Answer(0UL, {});
+  base::RunLoop().RunUntilIdle();
+  EXPECT_EQ(done, 2);
+
+  // The first lookup of a.example is over, so this is a new one.
+  lookup().SendDnsTextRequest("_dnslink.a.example", ignore, count);
+  base::RunLoop().RunUntilIdle();
+  EXPECT_EQ(network_.hosts.size(), 3UL);
+}
+
+TEST_F(CachedDnsTxtLookupTest, RepeatVisitsDontWait) {
+  EXPECT_FALSE(Visit(kHost));
+  base::RunLoop().RunUntilIdle();
+  network_.Answer(0UL, {"dnslink=/ipfs/bafyexample"});
+  base::RunLoop().RunUntilIdle();
+  EXPECT_EQ(cache_.size(), 1UL);
+
+  // Fresh: answered from cache, no query.
+  EXPECT_TRUE(Visit(kHost));
+  EXPECT_EQ(network_.hosts.size(), 1UL);
+
+  // Long expired, but served stale while revalidating.
+  env_.AdvanceClock(ipfs::DnsTxtCache::kDefaultTtl * 3);
+  EXPECT_TRUE(Visit(kHost));
+  base::RunLoop().RunUntilIdle();
+  EXPECT_EQ(network_.hosts.size(), 2UL);
+  EXPECT_TRUE(Visit(kHost));
+  EXPECT_EQ(network_.hosts.size(), 2UL) << "Revalidation is single-flight";
+}
+
+TEST_F(CachedDnsTxtLookupTest, PopularNamesAreRefreshedAhead) {
+  Visit(kHost);
+  base::RunLoop().RunUntilIdle();
+  network_.Answer(0UL, {"dnslink=/ipfs/bafyexample"});
+  base::RunLoop().RunUntilIdle();
+  Visit(kHost);
+  Visit(kHost);
+  // Nobody visits at 80% of the TTL, but it's refreshed anyway.
+  env_.FastForwardBy(ipfs::DnsTxtCache::kDefaultTtl *
+                     (ipfs::DnsTxtCache::kRefreshAt + 0.01));
+  EXPECT_EQ(network_.hosts.size(), 2UL);
+  network_.Answer(1UL, {"dnslink=/ipfs/bafynewer"});
+  base::RunLoop().RunUntilIdle();
+  // Not visited since, so no longer popular: no further refreshes.
+  env_.FastForwardBy(ipfs::DnsTxtCache::kDefaultTtl * 2);
+  EXPECT_EQ(network_.hosts.size(), 2UL);
+}
+
+TEST_F(RacingDnsTxtLookupTest, FirstDnslinkAnswerWins) {
+  Lookup();
+  EXPECT_EQ(network_.hosts.size(), 1UL);
+  EXPECT_EQ(doh_.NumPending(), 1);
+  DohAnswers(R"({"Status":0,"Answer":[
+      {"name":"_dnslink.example.com","type":16,"TTL":60,
+       "data":"\"dnslink=/ipfs/bafydoh\""}]})");
+  EXPECT_EQ(done_, 1);
+  ASSERT_EQ(got_.size(), 1UL);
+  EXPECT_EQ(got_.front(), "dnslink=/ipfs/bafydoh");
+  EXPECT_EQ(racing_.queries_in_flight(), 0UL);
+  // The system resolver was cancelled; were it to answer, nobody's listening.
+  network_.Answer(0UL, {"dnslink=/ipfs/bafysystem"});
+  base::RunLoop().RunUntilIdle();
+  EXPECT_EQ(done_, 1);
+  EXPECT_EQ(got_.size(), 1UL);
+}
+
+TEST_F(RacingDnsTxtLookupTest, FailedDohLeavesItToTheSystem) {
+  Lookup();
+  DohAnswers("", net::HTTP_SERVICE_UNAVAILABLE);
+  EXPECT_EQ(done_, 0);
+  network_.Answer(0UL, {"dnslink=/ipfs/bafysystem"});
+  base::RunLoop().RunUntilIdle();
+  EXPECT_EQ(done_, 1);
+  ASSERT_EQ(got_.size(), 1UL);
+  EXPECT_EQ(got_.front(), "dnslink=/ipfs/bafysystem");
+}
+
+TEST_F(RacingDnsTxtLookupTest, AnswerWithoutDnslinkWaitsForTheOther) {
+  Lookup();
+  network_.Answer(0UL, {"v=spf1 -all"});
+  EXPECT_EQ(done_, 0);
+  DohAnswers(R"({"Status":0,"Answer":[
+      {"type":16,"TTL":300,"data":"dnslink=/ipns/example.net"}]})");
+  EXPECT_EQ(done_, 1);
+  ASSERT_EQ(got_.size(), 1UL);
+  EXPECT_EQ(got_.front(), "dnslink=/ipns/example.net");
+}
+
+TEST_F(RacingDnsTxtLookupTest, NeitherHasDnslink) {
+  Lookup();
+  DohAnswers(R"({"Status":3})");
+  EXPECT_EQ(done_, 0);
+  network_.Answer(0UL, {"v=spf1 -all"});
+  base::RunLoop().RunUntilIdle();
+  EXPECT_EQ(done_, 1);
+  ASSERT_EQ(got_.size(), 1UL);
+  EXPECT_EQ(got_.front(), "v=spf1 -all");
+}
+
+TEST(DohTxtRequestTest, Parse) {
+  using R = ipfs::DohTxtRequest;
+  auto a = R::Parse(R"({"Status":0,"Answer":[
+      {"type":5,"TTL":10,"data":"elsewhere.example."},
+      {"type":16,"TTL":300,"data":"\"dnslink=/ipfs/\" \"bafysplit\""},
+      {"type":16,"TTL":120,"data":"plain text"}]})");
+  ASSERT_TRUE(a);
+  ASSERT_EQ(a->records.size(), 2UL);
+  EXPECT_EQ(a->records[0], "dnslink=/ipfs/bafysplit");
+  EXPECT_EQ(a->records[1], "plain text");
+  EXPECT_EQ(a->ttl, base::Seconds(120));
+
+  auto nx = R::Parse(R"({"Status":3})");
+  ASSERT_TRUE(nx);
+  EXPECT_TRUE(nx->records.empty());
+  EXPECT_FALSE(R::Parse(R"({"Status":2})"));
+  EXPECT_FALSE(R::Parse("<html>"));
+  EXPECT_EQ(R::QueryUrl("https://dns.example/resolve?ct=json", "a.example"),
+            "https://dns.example/resolve?ct=json&name=a.example&type=TXT");
+}
@@ -1,22 +1,204 @@
 #include "chromium_http.h"
 
+#include "affinity_bandit.h"
 #include "block_http_request.h"
+#include "car_batcher.h"
+#include "circuit_breaker.h"
+#include "gateway_latencies.h"
+#include "gateway_throttle.h"
+#include "hedger.h"
+#include "inter_request_state.h"
 
+#include <base/functional/bind.h>
 #include <base/logging.h>
+#include <base/task/sequenced_task_runner.h>
+#include <services/network/public/mojom/url_response_head.mojom.h>
 
 using Self = ipfs::ChromiumHttp;
 
-Self::ChromiumHttp(network::mojom::URLLoaderFactory& delegate)
-    : loader_factory_{&delegate} {}
+namespace {
+/*! Times a rate-limited request goes back in the queue before the scheduler
+ *  hears about it as a failure.
+ */
+constexpr int kRateLimitRetries = 2;
+}  // namespace
+
+Self::ChromiumHttp(network::mojom::URLLoaderFactory& delegate,
+                   InterRequestState& state)
+    : loader_factory_{&delegate}, state_{&state} {}
 
 auto Self::SendHttpRequest(ReqDesc desc, OnComplete cb) const -> Canceller {
-  auto ptr = std::make_shared<BlockHttpRequest>(desc, cb);
-  ptr->Send(loader_factory_);
+  auto pri = state_->http_priority();
+  auto st = state_;
+  // Whatever the response leads to is sent at the same priority, e.g. the
+  //   blocks a prefetched DNSLink points to.
+  cb = [st, pri, cb](auto status, auto body, auto const& hdrs) {
+    auto same = st->SendingAt(pri);
+    cb(status, body, hdrs);
+  };
+  auto& batcher = state_->car_batcher();
+  if (auto cid = batcher.Batchable(desc)) {
+    // Requests may be sent after this object has been replaced.
+    auto fac = loader_factory_;
+    auto single = [fac, st, pri](ReqDesc d, OnComplete c) {
+      return Send(fac, *st, d, c, pri);
+    };
+    auto stream = [fac, st, pri](ReqDesc d, OnComplete c,
+                                 BlockHttpRequest::ChunkObserver o) {
+      return Dispatch(fac, *st, d, c, pri, o);
+    };
+    return batcher.Add(*cid, desc, cb, single, stream);
+  }
+  return Send(loader_factory_, *state_, desc, cb, pri);
+}
+auto Self::Send(raw_ptr<network::mojom::URLLoaderFactory> fac,
+                InterRequestState& state,
+                ReqDesc desc,
+                OnComplete cb,
+                net::RequestPriority pri) -> Canceller {
+  if (desc.accept.find("application/vnd.ipld.raw") != std::string::npos) {
+    // Learn DAG structure from every block, so siblings can be batched.
+    auto* batcher = &(state.car_batcher());
+    auto cid = CarBatcher::Normalize(CarBatcher::CidOf(desc.url));
+    cb = [batcher, cid, cb](auto status, auto body, auto const& hdrs) {
+      if (status / 100 == 2) {
+        batcher->Learn(cid, body);
+      }
+      cb(status, body, hdrs);
+    };
+  }
+  auto* hedger = state.hedger();
+  auto typ = GatewayLatencies::TypeOf(desc);
+  // Only idempotent content requests are worth hedging. Routing & DNSLink
+  //   requests are cheap to race and their answers differ by gateway.
+  if (!hedger || !typ || (*typ != gw::GatewayRequestType::Block &&
+                          *typ != gw::GatewayRequestType::Car &&
+                          *typ != gw::GatewayRequestType::Ipns)) {
+    return Dispatch(fac, state, desc, cb, pri);
+  }
+  auto st = &state;
+  auto launch = [fac, st, desc, pri](OnComplete done) {
+    return Dispatch(fac, *st, desc, std::move(done), pri);
+  };
+  return hedger->Add(Hedger::Target(desc), GatewayThrottle::GatewayKey(desc.url),
+                     *typ, std::move(launch), std::move(cb));
+}
+auto Self::Dispatch(raw_ptr<network::mojom::URLLoaderFactory> fac,
+                    InterRequestState& state,
+                    ReqDesc desc,
+                    OnComplete cb,
+                    net::RequestPriority pri,
+                    BlockHttpRequest::ChunkObserver chunks) -> Canceller {
+  auto current = std::make_shared<Canceller>();
+  *current = Attempt(fac, state, desc, std::move(cb), pri, std::move(chunks),
+                     current, 0);
+  return [current]() {
+    if (auto c = std::exchange(*current, nullptr)) {
+      c();
+    }
+  };
+}
+auto Self::Attempt(raw_ptr<network::mojom::URLLoaderFactory> fac,
+                   InterRequestState& state,
+                   ReqDesc desc,
+                   OnComplete cb,
+                   net::RequestPriority pri,
+                   BlockHttpRequest::ChunkObserver chunks,
+                   std::shared_ptr<Canceller> current,
+                   int tries) -> Canceller {
+  auto gw = GatewayThrottle::GatewayKey(desc.url);
+  auto* brk = &(state.circuit_breaker());
+  auto admit = brk->Allow(gw);
+  if (admit == CircuitBreaker::Admit::No) {
+    // Fail now rather than wait out another timeout.
+    auto live = std::make_shared<bool>(true);
+    auto refuse = [](std::shared_ptr<bool> live, OnComplete cb) {
+      if (*live) {
+        cb(503, "", [](auto) { return std::string{}; });
+      }
+    };
+    base::SequencedTaskRunner::GetCurrentDefault()->PostTask(
+        FROM_HERE, base::BindOnce(refuse, live, std::move(cb)));
+    return [live]() { *live = false; };
+  }
+  auto answered = std::make_shared<bool>(false);
+  auto probe = admit == CircuitBreaker::Admit::Probe;
+  auto* thr = &(state.gateway_throttle());
+  auto st = &state;
+  auto report = [fac, st, desc, pri, chunks, current, tries, brk, probe, thr,
+                 gw, answered, cb](auto status, auto body, auto const& hdrs) {
+    *answered = true;
+    thr->RecordResponse(
+        gw, status,
+        GatewayThrottle::ParseRetryAfter(hdrs("Retry-After"), base::Time::Now()));
+    if (status == 429 && tries < kRateLimitRetries && *current) {
+      // Busy isn't down. Let the next attempt be the probe, if need be.
+      if (probe) {
+        brk->Abandon(gw);
+      }
+      // The throttle is now paused for this gateway, so this waits its turn.
+      *current =
+          Attempt(fac, *st, desc, cb, pri, chunks, current, tries + 1);
+      return;
+    }
+    if (status != BlockHttpRequest::kAbandoned) {
+      brk->Record(gw, status);
+    } else if (probe) {
+      brk->Abandon(gw);
+    }
+    cb(status, body, hdrs);
+  };
+  auto ptr = std::make_shared<BlockHttpRequest>(desc, report);
+  ptr->SetPriority(pri);
+  if (chunks) {
+    ptr->StreamTo(chunks);
+  }
+  Observe(*ptr, gw, desc, *thr, state.gateway_latencies(),
+          state.affinity_bandit());
   std::weak_ptr<BlockHttpRequest> w = ptr;
-  return [w](){
+  auto send = [](std::shared_ptr<BlockHttpRequest> p,
+                 raw_ptr<network::mojom::URLLoaderFactory> f,
+                 base::ScopedClosureRunner slot) {
+    p->HoldUntilDone(std::move(slot));
+    p->Send(f);
+  };
+  auto ticket =
+      thr->Submit(gw, base::BindOnce(send, std::move(ptr), fac), pri);
+  return [w, thr, brk, gw, ticket, probe, answered]() {
+    if (probe && !*answered) {
+      brk->Abandon(gw);
+    }
+    thr->Withdraw(gw, ticket);
     auto p = w.lock();
     if (p) {
       p->Cancel();
     }
   };
 }
+void Self::Observe(BlockHttpRequest& req,
+                   std::string const& gw,
+                   ReqDesc const& desc,
+                   GatewayThrottle& throttle,
+                   GatewayLatencies& latencies,
+                   AffinityBandit& bandit) {
+  auto* thr = &throttle;
+  req.ObserveHead([thr, gw](network::mojom::URLResponseHead const& head) {
+    thr->RecordProtocol(gw, head.alpn_negotiated_protocol);
+  });
+  auto typ = GatewayLatencies::TypeOf(desc);
+  if (!typ) {
+    return;
+  }
+  auto* lat = &latencies;
+  auto* bdt = &bandit;
+  req.ObserveTiming([lat, bdt, gw, typ](int status, base::TimeDelta ttfb,
+                                        base::TimeDelta total,
+                                        std::size_t bytes) {
+    if (status / 100 == 2) {
+      lat->Record(gw, *typ, ttfb, total);
+    }
+    if (status != BlockHttpRequest::kAbandoned) {
+      bdt->Record(gw, *typ, status, total, bytes);
+    }
+  });
+}
@@ -1,35 +1,88 @@
 #ifndef IPFS_CHROMIUM_CHROMIUM_HTTP_H
 #define IPFS_CHROMIUM_CHROMIUM_HTTP_H
 
+#include "block_http_request.h"
+
 #include <ipfs_client/ctx/http_api.h>
 
 #include <vocab/raw_ptr.h>
 
+#include <net/base/request_priority.h>
+
+#include <memory>
+
 namespace network::mojom {
 class URLLoaderFactory;
 }  // namespace network::mojom
 
 namespace ipfs {
+class AffinityBandit;
+class GatewayLatencies;
+class GatewayThrottle;
+class InterRequestState;
+
 /*! Using Chromium's URLLoader mechanisms to issue HTTP requests
  */
 class ChromiumHttp : public ctx::HttpApi {
   raw_ptr<network::mojom::URLLoaderFactory> loader_factory_ = nullptr;
+  raw_ptr<InterRequestState> state_ = nullptr;
+
+  /*! Send with hedging (if enabled), without batching */
+  static Canceller Send(raw_ptr<network::mojom::URLLoaderFactory>,
+                        InterRequestState&,
+                        ReqDesc desc,
+                        OnComplete cb,
+                        net::RequestPriority);
+
+  /*! Send through the breaker & admission control, without hedging */
+  static Canceller Dispatch(raw_ptr<network::mojom::URLLoaderFactory>,
+                            InterRequestState&,
+                            ReqDesc desc,
+                            OnComplete cb,
+                            net::RequestPriority,
+                            BlockHttpRequest::ChunkObserver chunks = {});
+
+  /*! One try at Dispatch. On 429 it re-queues itself, up to a point, and
+   *    swaps the canceller in current for the new attempt's.
+   */
+  static Canceller Attempt(raw_ptr<network::mojom::URLLoaderFactory>,
+                           InterRequestState&,
+                           ReqDesc desc,
+                           OnComplete cb,
+                           net::RequestPriority,
+                           BlockHttpRequest::ChunkObserver chunks,
+                           std::shared_ptr<Canceller> current,
+                           int tries);
 
  public:
 
   /*!
-   * \brief Send an HTTP request
+   * \brief Send an HTTP request, at InterRequestState::http_priority()
    * \param desc Describe the request to be sent
    * \param cb Called with results when the request has completed
    * \return An object which can be used to cancel a pending request
    */
   Canceller SendHttpRequest(ReqDesc desc, OnComplete cb) const override;
 
+  /*!
+   * \brief Feed a request's response head & timing to the gateway's
+   *   bookkeeping: its protocol, latencies, and type affinity
+   * \param gw \see GatewayThrottle::GatewayKey
+   */
+  static void Observe(BlockHttpRequest&,
+                      std::string const& gw,
+                      ReqDesc const& desc,
+                      GatewayThrottle&,
+                      GatewayLatencies&,
+                      AffinityBandit&);
+
   /*!
    * \brief construct
    * \param delegate Loader factor to use for access to HTTP
+   * \param state Per-profile gateway bookkeeping (admission, latencies)
    */
-  ChromiumHttp(network::mojom::URLLoaderFactory& delegate);
+  ChromiumHttp(network::mojom::URLLoaderFactory& delegate,
+               InterRequestState& state);
 };
 }  // namespace ipfs
 
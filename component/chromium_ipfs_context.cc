@@ -5,8 +5,12 @@
 #include "chromium_dns_txt_lookup.h"
 #include "chromium_http.h"
 #include "chromium_json_adapter.h"
+#include "chromium_signature_verifier.h"
 #include "inter_request_state.h"
+#include "ipfs_features.h"
 #include "json_parser_adapter.h"
+#include "lazy_cbor_adapter.h"
+#include "structural_json_parser.h"
 
 #include <services/network/public/cpp/simple_url_loader.h>
 #include <services/network/public/mojom/url_response_head.mojom.h>
@@ -16,32 +20,114 @@
 
 #include <url/gurl.h>
 
+#include <base/containers/lru_cache.h>
+#include <base/feature_list.h>
+#include <base/no_destructor.h>
 #include <base/strings/escape.h>
+#include <base/strings/strcat.h>
+#include <base/synchronization/lock.h>
 
 #include <base/logging.h>
 
-#include <ipfs_client/crypto/openssl_signature_verifier.h>
 #include <ipfs_client/ipfs_request.h>
 
+#include <algorithm>
+#include <optional>
+
 namespace {
-std::string DeduceMimeType(std::string extension,
-                           std::string_view content,
-                           std::string const& url) {
+/*! Deduced types of immutable (ipfs://) content, by what was asked */
+class DeducedMimeTypes {
+ public:
+  static constexpr std::size_t kMaxEntries = 1024UL;
+
+  std::optional<std::string> Get(std::string const& key) {
+    base::AutoLock lock{lock_};
+    auto it = memo_.Get(key);
+    if (it == memo_.end()) {
+      return std::nullopt;
+    }
+    return it->second;
+  }
+  void Put(std::string key, std::string mime_type) {
+    base::AutoLock lock{lock_};
+    memo_.Put(std::move(key), std::move(mime_type));
+  }
+
+ private:
+  base::Lock lock_;
+  base::HashingLRUCache<std::string, std::string> memo_{kMaxEntries};
+};
+/*! \brief Types SniffMimeType leaves alone when given as the hint
+ *  \details It only second-guesses a missing, unknown, text/plain, XML or
+ *    Office type (and only SniffMimeTypeFromLocalData is left after that,
+ *    for an empty or octet-stream result), so for these the extension has
+ *    the final word and the content needn't be looked at.
+ */
+bool TrustExtension(std::string_view mime_type) {
+  constexpr std::string_view kPrefixes[] = {"image/", "audio/", "video/",
+                                            "font/"};
+  constexpr std::string_view kExact[] = {
+      "text/html",        "text/css",         "text/javascript",
+      "application/json", "application/wasm", "application/javascript",
+      "application/pdf"};
+  if (mime_type.ends_with("+xml")) {
+    return false;
+  }
+  for (auto prefix : kPrefixes) {
+    if (mime_type.starts_with(prefix)) {
+      return true;
+    }
+  }
+  return std::find(std::begin(kExact), std::end(kExact), mime_type) !=
+         std::end(kExact);
+}
+std::string SniffedMimeType(std::string const& extension,
+                            std::string_view content,
+                            GURL const& url) {
   std::string result;
   auto fp_ext = base::FilePath::FromUTF8Unsafe(extension).value();
   if (extension.empty()) {
     result.clear();
   } else if (!net::GetWellKnownMimeTypeFromExtension(fp_ext, &result)) {
     result.clear();
+  } else if (TrustExtension(result)) {
+    return result;
   }
-  auto head_size = std::min(content.size(), static_cast<std::size_t>(999'999));
-  net::SniffMimeType({content.data(), head_size}, GURL{url}, result,
+  // Neither sniffer reads further than this.
+  auto head_size = std::min(content.size(), net::kMaxBytesToSniff);
+  net::SniffMimeType({content.data(), head_size}, url, result,
                      net::ForceSniffFileUrlsForHtml::kDisabled, &result);
   if (result.empty() || result == "application/octet-stream") {
     net::SniffMimeTypeFromLocalData({content.data(), head_size}, &result);
   }
   return result;
 }
+/*! \brief SniffedMimeType, remembered where the content can't change
+ *  \details An ipfs:// URL's host is a CID and what's under it is fixed, so
+ *    the answer for a given URL & extension is kept. The client doesn't pass
+ *    along the file's own CID; root CID and path name the same bytes.
+ *    ipns:// & others are sniffed every time.
+ */
+std::string DeduceMimeType(std::string extension,
+                           std::string_view content,
+                           std::string const& url) {
+  static base::NoDestructor<DeducedMimeTypes> memo;
+  GURL gurl{url};
+  if (!gurl.SchemeIs("ipfs")) {
+    return SniffedMimeType(extension, content, gurl);
+  }
+  auto key = base::StrCat({gurl.host_piece(), gurl.path_piece(), "\n",
+                           extension});
+  if (auto hit = memo->Get(key)) {
+    return *hit;
+  }
+  auto rv = SniffedMimeType(extension, content, gurl);
+  // Empty content may just be a body that hasn't arrived yet.
+  if (!content.empty()) {
+    memo->Put(std::move(key), rv);
+  }
+  return rv;
+}
 std::string Unescape(std::string_view comp) {
   using Rule = base::UnescapeRule;
   auto rules = Rule::PATH_SEPARATORS |
@@ -49,6 +135,18 @@ std::string Unescape(std::string_view comp) {
   auto result = base::UnescapeURLComponent({comp.data(), comp.size()}, rules);
   return result;
 }
+std::unique_ptr<ipfs::ctx::CborParser> MakeCborParser() {
+  if (base::FeatureList::IsEnabled(ipfs::kLazyDagCbor)) {
+    return std::make_unique<ipfs::LazyCborAdapter>();
+  }
+  return std::make_unique<ipfs::ChromiumCborAdapter>();
+}
+std::unique_ptr<ipfs::ctx::JsonParser> MakeJsonParser() {
+  if (base::FeatureList::IsEnabled(ipfs::kStructuralJson)) {
+    return std::make_unique<ipfs::StructuralJsonParser>();
+  }
+  return std::make_unique<ipfs::JsonParserAdapter>();
+}
 }  // namespace
 
 auto ipfs::CreateContext(InterRequestState& stat, PrefService* pref)
@@ -56,16 +154,20 @@ auto ipfs::CreateContext(InterRequestState& stat, PrefService* pref)
   LOG(WARNING) << __PRETTY_FUNCTION__;
   using K = crypto::SigningKeyType;
   auto result = std::make_shared<Client>();
-  result->with(std::make_unique<ChromiumIpfsGatewayConfig>(pref))
-      .with(std::make_unique<ChromiumDnsTxtLookup>(stat))
+  result
+      ->with(std::make_unique<ChromiumIpfsGatewayConfig>(
+          pref, stat.gateway_latencies(), stat.circuit_breaker(),
+          &stat.affinity_bandit(), &stat.gateway_throttle(),
+          stat.disk_path()))
+      .with(std::make_unique<ChromiumDnsTxtLookup>(stat,
+                                                    DohResolversPref(pref)))
       .with(&DeduceMimeType)
       .with(&Unescape)
-      .with(std::make_unique<ChromiumCborAdapter>())
-      .with(std::make_unique<JsonParserAdapter>())
-      .with(K::RSA,
-            std::make_unique<crypto::OpensslSignatureVerifier>(EVP_PKEY_RSA))
-      .with(K::Ed25519, std::make_unique<crypto::OpensslSignatureVerifier>(
-                            EVP_PKEY_ED25519))
+      .with(MakeCborParser())
+      .with(MakeJsonParser())
+      .with(K::RSA, std::make_unique<ChromiumSignatureVerifier>(EVP_PKEY_RSA))
+      .with(K::Ed25519,
+            std::make_unique<ChromiumSignatureVerifier>(EVP_PKEY_ED25519))
       .with([pref](){return DnsFallbackPref(pref);})
       ;
   return result;
@@ -1,14 +1,22 @@
 #include "chromium_json_adapter.h"
 
+#include <base/memory/ptr_util.h>
+
 using Self = ipfs::ChromiumJsonAdapter;
 
-Self::ChromiumJsonAdapter(base::Value d) : data_(std::move(d)) {}
+Self::ChromiumJsonAdapter(base::Value d)
+    : root_{std::make_shared<base::Value const>(std::move(d))},
+      data_{root_.get()} {}
+Self::ChromiumJsonAdapter(std::shared_ptr<base::Value const> root,
+                          base::Value const& node)
+    : root_{std::move(root)}, data_{&node} {}
+Self::ChromiumJsonAdapter(ChromiumJsonAdapter const&) = default;
 Self::~ChromiumJsonAdapter() noexcept {}
 std::string Self::pretty_print() const {
-  return data_.DebugString();
+  return data_->DebugString();
 }
 std::optional<std::string> Self::get_if_string() const {
-  auto* s = data_.GetIfString();
+  auto* s = data_->GetIfString();
   if (s) {
     return *s;
   } else {
@@ -17,32 +25,42 @@ std::optional<std::string> Self::get_if_string() const {
 }
 auto Self::operator[](std::string_view k) const
     -> std::unique_ptr<DagJsonValue> {
-  if (auto* m = data_.GetIfDict()) {
+  if (auto* m = data_->GetIfDict()) {
     if (auto* v = m->Find(k)) {
-      return std::make_unique<Self>(v->Clone());
+      return base::WrapUnique(new Self(root_, *v));
     }
   }
   return {};
 }
 bool Self::iterate_list(std::function<void(DagJsonValue const&)> cb) const {
-  auto* l = data_.GetIfList();
+  auto* l = data_->GetIfList();
   if (!l) {
     return false;
   }
   for (auto& v : *l) {
-    Self wrap(v.Clone());
-    cb(wrap);
+    cb(Self{root_, v});
   }
   return true;
 }
 std::optional<std::vector<std::string>> Self::object_keys() const {
-  auto* m = data_.GetIfDict();
+  auto* m = data_->GetIfDict();
   if (!m) {
     return std::nullopt;
   }
   std::vector<std::string> rv;
+  rv.reserve(m->size());
   for (auto [k, v] : *m) {
     rv.push_back(k);
   }
   return rv;
-}
\ No newline at end of file
+}
+bool Self::iterate_keys(std::function<void(std::string_view)> cb) const {
+  auto* m = data_->GetIfDict();
+  if (!m) {
+    return false;
+  }
+  for (auto [k, v] : *m) {
+    cb(k);
+  }
+  return true;
+}
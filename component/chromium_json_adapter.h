@@ -1,16 +1,30 @@
 #ifndef IPFS_CHROMIUM_JSON_ADAPTER_H_
 #define IPFS_CHROMIUM_JSON_ADAPTER_H_
 
+#include <base/memory/raw_ptr.h>
 #include <base/values.h>
 #include <ipfs_client/dag_json_value.h>
 
+#include <functional>
+#include <memory>
+#include <string_view>
+
 namespace ipfs {
 
 /*!
  * \brief A DAG Json value, using Chromium's JSON parsing
+ * \details Like ChromiumCborAdapter, a cursor into a parsed document: values
+ *    handed out by operator[] and iterate_list point into the same shared
+ *    base::Value rather than each cloning its subtree.
  */
 class ChromiumJsonAdapter final : public ipfs::DagJsonValue {
-  base::Value data_;
+  std::shared_ptr<base::Value const> root_;
+  raw_ptr<base::Value const> data_;
+
+  /*! A node within root */
+  ChromiumJsonAdapter(std::shared_ptr<base::Value const> root,
+                      base::Value const& node);
+
   std::string pretty_print() const override;
   std::unique_ptr<DagJsonValue> operator[](std::string_view) const override;
   std::optional<std::string> get_if_string() const override;
@@ -23,7 +37,15 @@ class ChromiumJsonAdapter final : public ipfs::DagJsonValue {
    *  \details d The data (JSON value) being represented.
    */
   ChromiumJsonAdapter(base::Value d);
+  ChromiumJsonAdapter(ChromiumJsonAdapter const&);
   ~ChromiumJsonAdapter() noexcept override;
+
+  /*! \brief Visit an object's keys without copying them
+   *  \details Prefer to object_keys, which the DagJsonValue interface
+   *    requires to return copies.
+   *  \return false if this isn't an object
+   */
+  bool iterate_keys(std::function<void(std::string_view)>) const;
 };
 }  // namespace ipfs
 
@@ -0,0 +1,86 @@
+#include "chromium_json_adapter.h"
+#include "json_parser_adapter.h"
+
+#include <base/strings/stringprintf.h>
+#include <base/timer/elapsed_timer.h>
+#include <testing/gtest/include/gtest/gtest.h>
+#include <testing/perf/perf_result_reporter.h>
+
+#include <string>
+
+namespace {
+constexpr std::size_t kProviders = 10000UL;
+constexpr int kPasses = 10;
+
+/*! Shaped like a delegated routing (/routing/v1/providers) response */
+std::string RoutingResponse() {
+  std::string rv = R"({"Providers":[)";
+  for (auto i = 0UL; i < kProviders; ++i) {
+    if (i) {
+      rv.push_back(',');
+    }
+    base::StringAppendF(
+        &rv,
+        R"({"Schema":"peer","ID":"12D3KooWProvider%zu",)"
+        R"("Addrs":["/ip4/10.0.%zu.%zu/tcp/4001","/ip6/::1/udp/4001/quic-v1"],)"
+        R"("Protocols":["transport-bitswap","transport-ipfs-gateway-http"]})",
+        i, i / 256UL, i % 256UL);
+  }
+  return rv + "]}";
+}
+
+void Report(std::string const& metric, base::TimeDelta t) {
+  perf_test::PerfResultReporter reporter("ChromiumJsonAdapter",
+                                         "providers_10000");
+  reporter.RegisterImportantMetric(metric, "us");
+  reporter.AddResult(metric, t.InMicrosecondsF());
+}
+}  // namespace
+
+TEST(ChromiumJsonAdapterPerfTest, RoutingResponse) {
+  auto json = RoutingResponse();
+  ipfs::JsonParserAdapter parser;
+  base::ElapsedTimer parse_timer;
+  auto doc = parser.Parse(json);
+  Report("parse", parse_timer.Elapsed());
+  ASSERT_TRUE(doc);
+
+  // What a routing consumer does: each provider's ID, schema and protocols.
+  base::ElapsedTimer timer;
+  std::size_t ids = 0UL;
+  std::size_t protocols = 0UL;
+  for (auto p = 0; p < kPasses; ++p) {
+    auto providers = (*doc)["Providers"];
+    ASSERT_TRUE(providers);
+    providers->iterate_list([&](ipfs::DagJsonValue const& provider) {
+      auto schema = provider["Schema"];
+      auto id = provider["ID"];
+      if (schema && id && schema->get_if_string() == "peer" &&
+          id->get_if_string()) {
+        ++ids;
+      }
+      if (auto protos = provider["Protocols"]) {
+        protos->iterate_list([&protocols](ipfs::DagJsonValue const& proto) {
+          protocols += proto.get_if_string().has_value();
+        });
+      }
+    });
+  }
+  Report("visit_providers", timer.Elapsed() / kPasses);
+  EXPECT_EQ(ids, kPasses * kProviders);
+  EXPECT_EQ(protocols, kPasses * kProviders * 2UL);
+
+  base::ElapsedTimer keys_timer;
+  std::size_t keys = 0UL;
+  for (auto p = 0; p < kPasses; ++p) {
+    // JsonParserAdapter's values are all ChromiumJsonAdapters.
+    using A = ipfs::ChromiumJsonAdapter;
+    (*doc)["Providers"]->iterate_list([&keys](ipfs::DagJsonValue const& v) {
+      static_cast<A const&>(v).iterate_keys([&keys](std::string_view) {
+        ++keys;
+      });
+    });
+  }
+  Report("iterate_keys", keys_timer.Elapsed() / kPasses);
+  EXPECT_EQ(keys, kPasses * kProviders * 4UL);
+}
@@ -0,0 +1,135 @@
+#include "chromium_signature_verifier.h"
+
+#include <base/functional/bind.h>
+#include <base/logging.h>
+#include <base/task/thread_pool.h>
+#include <third_party/boringssl/src/include/openssl/bytestring.h>
+#include <third_party/boringssl/src/include/openssl/curve25519.h>
+#include <third_party/boringssl/src/include/openssl/sha.h>
+
+using Self = ipfs::ChromiumSignatureVerifier;
+
+namespace {
+std::uint8_t const* Ptr(ipfs::ByteView b) {
+  return reinterpret_cast<std::uint8_t const*>(b.data());
+}
+void Hash(SHA256_CTX& ctx, ipfs::ByteView b) {
+  // Length-prefixed, so moving bytes between fields changes the digest.
+  std::uint64_t n = b.size();
+  SHA256_Update(&ctx, &n, sizeof n);
+  SHA256_Update(&ctx, b.data(), b.size());
+}
+}  // namespace
+
+Self::ChromiumSignatureVerifier(int key_type)
+    : core_{base::MakeRefCounted<Core>(key_type)} {}
+Self::~ChromiumSignatureVerifier() noexcept = default;
+
+bool Self::VerifySignature(ByteView signature, ByteView data, ByteView key) {
+  return core_->Verify(signature, data, key);
+}
+void Self::VerifyOnThreadPool(std::string signature,
+                              std::string data,
+                              std::string key,
+                              Verdict cb) {
+  base::ThreadPool::PostTaskAndReplyWithResult(
+      FROM_HERE, {base::TaskPriority::USER_VISIBLE},
+      base::BindOnce(&Core::VerifyCopies, core_, std::move(signature),
+                     std::move(data), std::move(key)),
+      std::move(cb));
+}
+std::size_t Self::hits() const {
+  return core_->hits();
+}
+
+Self::Core::Core(int key_type)
+    : type_{key_type},
+      fallback_{key_type},
+      verdicts_{kMaxVerdicts},
+      keys_{kMaxKeys} {}
+Self::Core::~Core() noexcept = default;
+
+bool Self::Core::VerifyCopies(std::string const& signature,
+                              std::string const& data,
+                              std::string const& key) {
+  return Verify(as_bytes(std::string_view{signature}),
+                as_bytes(std::string_view{data}), as_bytes(std::string_view{key}));
+}
+bool Self::Core::Verify(ByteView signature, ByteView data, ByteView key) {
+  Digest digest;
+  SHA256_CTX ctx;
+  SHA256_Init(&ctx);
+  Hash(ctx, key);
+  Hash(ctx, signature);
+  Hash(ctx, data);
+  SHA256_Final(digest.data(), &ctx);
+  {
+    base::AutoLock lock{lock_};
+    if (auto it = verdicts_.Get(digest); it != verdicts_.end()) {
+      ++hits_;
+      return it->second;
+    }
+  }
+  // Not holding the lock for the expensive part: a race costs a duplicate
+  //   verification, not a wrong answer.
+  bool valid;
+  if (auto pkey = Key(key)) {
+    valid = Check(pkey.get(), signature, data);
+  } else {
+    valid = fallback_.VerifySignature(signature, data, key);
+  }
+  if (!valid) {
+    VLOG(1) << "Signature verification failed (key type " << type_ << ").";
+  }
+  base::AutoLock lock{lock_};
+  verdicts_.Put(digest, valid);
+  return valid;
+}
+std::size_t Self::Core::hits() const {
+  base::AutoLock lock{lock_};
+  return hits_;
+}
+auto Self::Core::Key(ByteView key) -> bssl::UniquePtr<EVP_PKEY> {
+  std::string k{reinterpret_cast<char const*>(key.data()), key.size()};
+  {
+    base::AutoLock lock{lock_};
+    if (auto it = keys_.Get(k); it != keys_.end()) {
+      return bssl::UpRef(it->second);
+    }
+  }
+  auto parsed = Parse(key);
+  if (parsed) {
+    base::AutoLock lock{lock_};
+    keys_.Put(std::move(k), bssl::UpRef(parsed));
+  }
+  return parsed;
+}
+auto Self::Core::Parse(ByteView key) const -> bssl::UniquePtr<EVP_PKEY> {
+  if (type_ == EVP_PKEY_ED25519) {
+    if (key.size() != ED25519_PUBLIC_KEY_LEN) {
+      return {};
+    }
+    return bssl::UniquePtr<EVP_PKEY>(EVP_PKEY_new_raw_public_key(
+        EVP_PKEY_ED25519, nullptr, Ptr(key), key.size()));
+  }
+  // libp2p RSA keys are DER SubjectPublicKeyInfo.
+  CBS cbs;
+  CBS_init(&cbs, Ptr(key), key.size());
+  bssl::UniquePtr<EVP_PKEY> rv{EVP_parse_public_key(&cbs)};
+  if (!rv || CBS_len(&cbs) || EVP_PKEY_id(rv.get()) != type_) {
+    return {};
+  }
+  return rv;
+}
+bool Self::Core::Check(EVP_PKEY* key,
+                       ByteView signature,
+                       ByteView data) const {
+  bssl::ScopedEVP_MD_CTX ctx;
+  // Ed25519 hashes internally; IPNS RSA signatures are PKCS#1 v1.5/SHA-256.
+  auto const* md = type_ == EVP_PKEY_ED25519 ? nullptr : EVP_sha256();
+  if (!EVP_DigestVerifyInit(ctx.get(), nullptr, md, nullptr, key)) {
+    return false;
+  }
+  return EVP_DigestVerify(ctx.get(), Ptr(signature), signature.size(),
+                          Ptr(data), data.size()) == 1;
+}
@@ -0,0 +1,89 @@
+#ifndef IPFS_CHROMIUM_SIGNATURE_VERIFIER_H_
+#define IPFS_CHROMIUM_SIGNATURE_VERIFIER_H_
+
+#include <ipfs_client/crypto/openssl_signature_verifier.h>
+#include <ipfs_client/crypto/signature_verifier.h>
+
+#include <base/containers/lru_cache.h>
+#include <base/functional/callback.h>
+#include <base/memory/ref_counted.h>
+#include <base/synchronization/lock.h>
+#include <base/thread_annotations.h>
+#include <third_party/boringssl/src/include/openssl/evp.h>
+
+#include <array>
+#include <cstdint>
+#include <string>
+
+namespace ipfs {
+/*! Verifies IPNS record signatures, remembering the answers
+ *  \details The same record gets verified every time it's fetched or read
+ *    back from cache, and an RSA verification isn't cheap. Here a verdict is
+ *    remembered by a hash of (key, signature, data), so repeats are a lookup.
+ *    Public keys are also kept parsed. Verification is done with BoringSSL
+ *    directly; a key in a form not recognized here is handed to
+ *    crypto::OpensslSignatureVerifier instead.
+ *    Safe to use from any sequence: see VerifyOnThreadPool.
+ */
+class ChromiumSignatureVerifier final : public crypto::SignatureVerifier {
+ public:
+  /*! Remembered verdicts */
+  static constexpr std::size_t kMaxVerdicts = 1024UL;
+  /*! Remembered parsed public keys */
+  static constexpr std::size_t kMaxKeys = 64UL;
+
+  using Verdict = base::OnceCallback<void(bool)>;
+
+  /*! \param key_type EVP_PKEY_RSA or EVP_PKEY_ED25519 */
+  explicit ChromiumSignatureVerifier(int key_type);
+  ~ChromiumSignatureVerifier() noexcept override;
+
+  bool VerifySignature(ByteView signature,
+                       ByteView data,
+                       ByteView key) override;
+
+  /*! \brief Verify on a thread pool sequence, replying on this one
+   *  \note Shares the caches with VerifySignature
+   */
+  void VerifyOnThreadPool(std::string signature,
+                          std::string data,
+                          std::string key,
+                          Verdict);
+
+  /*! \return How many verifications were answered from cache */
+  std::size_t hits() const;
+
+ private:
+  using Digest = std::array<std::uint8_t, 32>;
+  /*! What's shared with thread pool tasks */
+  class Core : public base::RefCountedThreadSafe<Core> {
+   public:
+    explicit Core(int key_type);
+    bool Verify(ByteView signature, ByteView data, ByteView key);
+    bool VerifyCopies(std::string const& signature,
+                      std::string const& data,
+                      std::string const& key);
+    std::size_t hits() const;
+
+   private:
+    friend class base::RefCountedThreadSafe<Core>;
+    ~Core() noexcept;
+
+    int const type_;
+    crypto::OpensslSignatureVerifier fallback_;
+    mutable base::Lock lock_;
+    base::LRUCache<Digest, bool> verdicts_ GUARDED_BY(lock_);
+    base::HashingLRUCache<std::string, bssl::UniquePtr<EVP_PKEY>> keys_
+        GUARDED_BY(lock_);
+    std::size_t hits_ GUARDED_BY(lock_) = 0UL;
+
+    /*! \return null if not in a form handled here */
+    bssl::UniquePtr<EVP_PKEY> Key(ByteView);
+    bssl::UniquePtr<EVP_PKEY> Parse(ByteView) const;
+    bool Check(EVP_PKEY*, ByteView signature, ByteView data) const;
+  };
+  scoped_refptr<Core> core_;
+};
+}  // namespace ipfs
+
+#endif  // IPFS_CHROMIUM_SIGNATURE_VERIFIER_H_
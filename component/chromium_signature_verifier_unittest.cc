@@ -0,0 +1,110 @@
+#include "chromium_signature_verifier.h"
+
+#include <base/functional/bind.h>
+#include <base/run_loop.h>
+#include <base/test/task_environment.h>
+#include <third_party/boringssl/src/include/openssl/bytestring.h>
+#include <third_party/boringssl/src/include/openssl/curve25519.h>
+#include <third_party/boringssl/src/include/openssl/rsa.h>
+
+#include <gtest/gtest.h>
+
+#include <optional>
+
+namespace {
+std::string Str(std::uint8_t const* p, std::size_t n) {
+  return {reinterpret_cast<char const*>(p), n};
+}
+ipfs::ByteView View(std::string const& s) {
+  return ipfs::as_bytes(std::string_view{s});
+}
+constexpr char kData[] = "ipns-signature:pretend this is a record";
+
+struct Signed {
+  std::string key;
+  std::string signature;
+};
+Signed SignEd25519(std::string const& data) {
+  std::uint8_t pub[ED25519_PUBLIC_KEY_LEN];
+  std::uint8_t priv[ED25519_PRIVATE_KEY_LEN];
+  ED25519_keypair(pub, priv);
+  std::uint8_t sig[ED25519_SIGNATURE_LEN];
+  EXPECT_TRUE(ED25519_sign(sig, reinterpret_cast<std::uint8_t const*>(data.data()),
+                           data.size(), priv));
+  return {Str(pub, sizeof pub), Str(sig, sizeof sig)};
+}
+Signed SignRsa(std::string const& data) {
+  bssl::UniquePtr<RSA> rsa{RSA_new()};
+  bssl::UniquePtr<BIGNUM> e{BN_new()};
+  BN_set_word(e.get(), RSA_F4);
+  EXPECT_TRUE(RSA_generate_key_ex(rsa.get(), 2048, e.get(), nullptr));
+  bssl::UniquePtr<EVP_PKEY> pkey{EVP_PKEY_new()};
+  EVP_PKEY_set1_RSA(pkey.get(), rsa.get());
+  bssl::ScopedEVP_MD_CTX ctx;
+  EXPECT_TRUE(EVP_DigestSignInit(ctx.get(), nullptr, EVP_sha256(), nullptr,
+                                 pkey.get()));
+  std::string sig(EVP_PKEY_size(pkey.get()), '\0');
+  auto sig_len = sig.size();
+  EXPECT_TRUE(EVP_DigestSign(
+      ctx.get(), reinterpret_cast<std::uint8_t*>(sig.data()), &sig_len,
+      reinterpret_cast<std::uint8_t const*>(data.data()), data.size()));
+  sig.resize(sig_len);
+  bssl::ScopedCBB cbb;
+  std::uint8_t* der;
+  std::size_t der_len;
+  EXPECT_TRUE(CBB_init(cbb.get(), 0) &&
+              EVP_marshal_public_key(cbb.get(), pkey.get()) &&
+              CBB_finish(cbb.get(), &der, &der_len));
+  bssl::UniquePtr<std::uint8_t> owned{der};
+  return {Str(der, der_len), sig};
+}
+}  // namespace
+
+TEST(ChromiumSignatureVerifierTest, Ed25519RepeatsAreLookups) {
+  ipfs::ChromiumSignatureVerifier v{EVP_PKEY_ED25519};
+  auto s = SignEd25519(kData);
+  EXPECT_TRUE(v.VerifySignature(View(s.signature), View(kData), View(s.key)));
+  EXPECT_EQ(v.hits(), 0UL);
+  EXPECT_TRUE(v.VerifySignature(View(s.signature), View(kData), View(s.key)));
+  EXPECT_EQ(v.hits(), 1UL);
+
+  std::string tampered{kData};
+  tampered.back() ^= 1;
+  EXPECT_FALSE(
+      v.VerifySignature(View(s.signature), View(tampered), View(s.key)));
+  EXPECT_FALSE(
+      v.VerifySignature(View(s.signature), View(tampered), View(s.key)));
+  EXPECT_EQ(v.hits(), 2UL) << "Failures are remembered too";
+}
+
+TEST(ChromiumSignatureVerifierTest, Rsa) {
+  ipfs::ChromiumSignatureVerifier v{EVP_PKEY_RSA};
+  auto s = SignRsa(kData);
+  EXPECT_TRUE(v.VerifySignature(View(s.signature), View(kData), View(s.key)));
+  auto other = s.signature;
+  other[7] ^= 0x10;
+  EXPECT_FALSE(v.VerifySignature(View(other), View(kData), View(s.key)));
+  EXPECT_TRUE(v.VerifySignature(View(s.signature), View(kData), View(s.key)));
+  EXPECT_EQ(v.hits(), 1UL);
+}
+
+TEST(ChromiumSignatureVerifierTest, OnThreadPool) {
+  base::test::TaskEnvironment env;
+  ipfs::ChromiumSignatureVerifier v{EVP_PKEY_ED25519};
+  auto s = SignEd25519(kData);
+  base::RunLoop loop;
+  std::optional<bool> verdict;
+  v.VerifyOnThreadPool(s.signature, kData, s.key,
+                       base::BindOnce(
+                           [](std::optional<bool>* out, base::OnceClosure quit,
+                              bool valid) {
+                             *out = valid;
+                             std::move(quit).Run();
+                           },
+                           &verdict, loop.QuitClosure()));
+  loop.Run();
+  EXPECT_EQ(verdict, true);
+  // The pool and the caller share what's been learned.
+  EXPECT_TRUE(v.VerifySignature(View(s.signature), View(kData), View(s.key)));
+  EXPECT_EQ(v.hits(), 1UL);
+}
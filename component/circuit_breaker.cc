@@ -0,0 +1,145 @@
+#include "circuit_breaker.h"
+
+#include <base/logging.h>
+#include <base/rand_util.h>
+
+#include <algorithm>
+
+using Self = ipfs::CircuitBreaker;
+
+namespace {
+using namespace std::literals;
+auto constexpr kState = "state"sv;
+auto constexpr kFailures = "failures"sv;
+auto constexpr kTrips = "trips"sv;
+auto constexpr kRetryAt = "retry_at"sv;
+}  // namespace
+
+Self::CircuitBreaker() = default;
+Self::~CircuitBreaker() noexcept = default;
+
+auto Self::Allow(std::string_view gateway) -> Admit {
+  auto it = gateways_.find(gateway);
+  if (it == gateways_.end()) {
+    return Admit::Yes;
+  }
+  auto& g = it->second;
+  switch (g.state) {
+    case State::Closed:
+      return Admit::Yes;
+    case State::Open:
+      if (base::Time::Now() < g.retry_at) {
+        return Admit::No;
+      }
+      VLOG(1) << "Probing " << gateway << " after " << g.trips << " trip(s).";
+      g.state = State::HalfOpen;
+      generation_++;
+      [[fallthrough]];
+    case State::HalfOpen:
+      if (g.probing) {
+        return Admit::No;
+      }
+      g.probing = true;
+      return Admit::Probe;
+  }
+  return Admit::Yes;
+}
+void Self::Record(std::string_view gateway, int status) {
+  auto it = gateways_.find(gateway);
+  if (!IsHealthFailure(status)) {
+    if (it != gateways_.end()) {
+      if (it->second.state != State::Closed) {
+        LOG(INFO) << "Gateway " << gateway << " is answering again.";
+        generation_++;
+      }
+      gateways_.erase(it);
+    }
+    return;
+  }
+  if (it == gateways_.end()) {
+    it = gateways_.emplace(std::string{gateway}, Gateway{}).first;
+  }
+  auto& g = it->second;
+  switch (g.state) {
+    case State::Closed:
+      if (++g.failures >= kTripAfter) {
+        Trip(gateway, g);
+      }
+      break;
+    case State::HalfOpen:
+      Trip(gateway, g);
+      break;
+    case State::Open:
+      // A straggler sent before it opened. Already accounted for.
+      break;
+  }
+}
+void Self::Abandon(std::string_view gateway) {
+  auto it = gateways_.find(gateway);
+  if (it != gateways_.end()) {
+    it->second.probing = false;
+  }
+}
+void Self::Trip(std::string_view gateway, Gateway& g) {
+  // Exponential backoff with "equal jitter": somewhere in [b/2, b]
+  auto b = kInitialBackoff * (1 << std::min(g.trips, 16));
+  b = std::min(b, kMaxBackoff);
+  b = b / 2 + b / 2 * base::RandDouble();
+  g.state = State::Open;
+  g.trips++;
+  g.probing = false;
+  g.retry_at = base::Time::Now() + b;
+  generation_++;
+  LOG(WARNING) << "Gateway " << gateway << " failed " << g.failures
+               << " time(s) in a row; not sending there for " << b;
+}
+auto Self::state(std::string_view gateway) const -> State {
+  auto it = gateways_.find(gateway);
+  return it == gateways_.end() ? State::Closed : it->second.state;
+}
+bool Self::IsOpen(std::string_view gateway) const {
+  return state(gateway) != State::Closed;
+}
+base::Value::Dict Self::ToDict(std::string_view gateway) const {
+  base::Value::Dict d;
+  auto it = gateways_.find(gateway);
+  if (it == gateways_.end()) {
+    return d;
+  }
+  auto& g = it->second;
+  // A half-open breaker's probe won't survive a restart; reload as open.
+  d.Set(kState, g.state == State::Closed ? "closed" : "open");
+  d.Set(kFailures, g.failures);
+  d.Set(kTrips, g.trips);
+  d.Set(kRetryAt, g.retry_at.InSecondsFSinceUnixEpoch());
+  return d;
+}
+void Self::Load(std::string_view gateway, base::Value::Dict const& d) {
+  Gateway g;
+  if (auto* s = d.FindString(kState); s && *s == "open") {
+    g.state = State::Open;
+  }
+  g.failures = std::max(0, d.FindInt(kFailures).value_or(0));
+  g.trips = std::max(0, d.FindInt(kTrips).value_or(0));
+  if (auto t = d.FindDouble(kRetryAt)) {
+    g.retry_at = base::Time::FromSecondsSinceUnixEpoch(*t);
+  }
+  if (g.state == State::Closed && !g.failures) {
+    return;
+  }
+  gateways_[std::string{gateway}] = g;
+  generation_++;
+}
+bool Self::IsHealthFailure(int status) {
+  switch (status) {
+    case 0:
+    case 408:  // Timeout, from BlockHttpRequest or the server
+    case 500:  // Also the stand-in for network errors
+    case 502:
+    case 503:
+    case 504:
+      return true;
+    default:
+      return false;
+  }
+}
@@ -0,0 +1,85 @@
+#ifndef IPFS_CIRCUIT_BREAKER_H_
+#define IPFS_CIRCUIT_BREAKER_H_
+
+#include <base/time/time.h>
+#include <base/values.h>
+
+#include <map>
+#include <string>
+#include <string_view>
+
+namespace ipfs {
+
+/*! Stops sending requests to gateways that have stopped answering
+ *  \details One breaker per gateway (\see GatewayThrottle::GatewayKey).
+ *    - Closed: requests flow. kTripAfter consecutive failures open it.
+ *    - Open: requests are refused on the spot, until a backoff has elapsed.
+ *      The backoff doubles every time it re-opens, with jitter.
+ *    - HalfOpen: a single probe request is let through. Success closes it,
+ *      failure re-opens it.
+ *    Only failures that say something about the gateway's health count,
+ *    i.e. timeouts, connection errors & 5xx - not 404 or the like.
+ *    State is keyed by wall-clock time so it can be persisted in prefs.
+ */
+class CircuitBreaker {
+ public:
+  enum class State { Closed, Open, HalfOpen };
+  enum class Admit {
+    Yes,    ///< Send as normal
+    Probe,  ///< Send; it's the one probe. Report back or Abandon.
+    No      ///< Don't send, fail immediately
+  };
+
+  static constexpr int kTripAfter = 3;
+  static constexpr base::TimeDelta kInitialBackoff = base::Seconds(2);
+  static constexpr base::TimeDelta kMaxBackoff = base::Minutes(10);
+
+  CircuitBreaker();
+  ~CircuitBreaker() noexcept;
+
+  /*! \brief May a request be sent to this gateway now? */
+  Admit Allow(std::string_view gateway);
+
+  /*! \brief Report how a sent request ended
+   *  \param status HTTP status, or the pseudo-status BlockHttpRequest gives
+   *    to network errors (408 for timeout, 500 otherwise). Requests it
+   *    abandoned itself aren't reported; use Abandon for a probe.
+   */
+  void Record(std::string_view gateway, int status);
+
+  /*! \brief The probe was cancelled without an answer; allow another */
+  void Abandon(std::string_view gateway);
+
+  State state(std::string_view gateway) const;
+
+  /*! \return Whether requests to the gateway are being refused */
+  bool IsOpen(std::string_view gateway) const;
+
+  /*! \brief Incremented on every state change */
+  std::size_t generation() const { return generation_; }
+
+  /*! \brief Serialize for preferences; empty if healthy */
+  base::Value::Dict ToDict(std::string_view gateway) const;
+
+  /*! \brief Restore what ToDict produced */
+  void Load(std::string_view gateway, base::Value::Dict const&);
+
+  /*! \return Whether this status indicates the gateway itself is unwell */
+  static bool IsHealthFailure(int status);
+
+ private:
+  struct Gateway {
+    State state = State::Closed;
+    int failures = 0;
+    int trips = 0;
+    base::Time retry_at;
+    bool probing = false;
+  };
+  std::map<std::string, Gateway, std::less<>> gateways_;
+  std::size_t generation_ = 0UL;
+
+  void Trip(std::string_view gateway, Gateway&);
+};
+}  // namespace ipfs
+
+#endif  // IPFS_CIRCUIT_BREAKER_H_
@@ -0,0 +1,82 @@
+#include "circuit_breaker.h"
+
+#include "block_http_request.h"
+
+#include <base/test/task_environment.h>
+
+#include <gtest/gtest.h>
+
+using B = ipfs::CircuitBreaker;
+
+namespace {
+constexpr char kGw[] = "https://gw.example/";
+
+class CircuitBreakerTest : public testing::Test {
+ protected:
+  void Fail(int times = B::kTripAfter) {
+    for (auto i = 0; i < times; ++i) {
+      brk_.Record(kGw, 504);
+    }
+  }
+
+  base::test::TaskEnvironment env_{
+      base::test::TaskEnvironment::TimeSource::MOCK_TIME};
+  B brk_;
+};
+}  // namespace
+
+TEST_F(CircuitBreakerTest, OnlyHealthFailuresCount) {
+  for (auto status : {200, 404, 410, 429, ipfs::BlockHttpRequest::kAbandoned}) {
+    EXPECT_FALSE(B::IsHealthFailure(status)) << status;
+  }
+  for (auto status : {408, 500, 502, 503, 504}) {
+    EXPECT_TRUE(B::IsHealthFailure(status)) << status;
+  }
+  Fail(B::kTripAfter - 1);
+  brk_.Record(kGw, 404);
+  EXPECT_EQ(brk_.state(kGw), B::State::Closed);
+  Fail(1);
+  EXPECT_EQ(brk_.state(kGw), B::State::Open);
+}
+
+TEST_F(CircuitBreakerTest, SuccessResetsTheCount) {
+  Fail(B::kTripAfter - 1);
+  brk_.Record(kGw, 200);
+  Fail(B::kTripAfter - 1);
+  EXPECT_EQ(brk_.state(kGw), B::State::Closed);
+  EXPECT_EQ(brk_.Allow(kGw), B::Admit::Yes);
+}
+
+TEST_F(CircuitBreakerTest, OneProbeAfterBackoff) {
+  Fail();
+  EXPECT_EQ(brk_.Allow(kGw), B::Admit::No);
+  env_.FastForwardBy(B::kInitialBackoff);
+  EXPECT_EQ(brk_.Allow(kGw), B::Admit::Probe);
+  EXPECT_EQ(brk_.state(kGw), B::State::HalfOpen);
+  EXPECT_EQ(brk_.Allow(kGw), B::Admit::No);
+  brk_.Abandon(kGw);
+  EXPECT_EQ(brk_.Allow(kGw), B::Admit::Probe);
+  brk_.Record(kGw, 200);
+  EXPECT_EQ(brk_.state(kGw), B::State::Closed);
+}
+
+TEST_F(CircuitBreakerTest, FailedProbeBacksOffLonger) {
+  Fail();
+  env_.FastForwardBy(B::kInitialBackoff);
+  ASSERT_EQ(brk_.Allow(kGw), B::Admit::Probe);
+  brk_.Record(kGw, 504);
+  EXPECT_EQ(brk_.state(kGw), B::State::Open);
+  // The second backoff is at least the whole of the first.
+  env_.FastForwardBy(B::kInitialBackoff - base::Milliseconds(1));
+  EXPECT_EQ(brk_.Allow(kGw), B::Admit::No);
+}
+
+TEST_F(CircuitBreakerTest, RoundTripsThroughDict) {
+  EXPECT_TRUE(brk_.ToDict(kGw).empty());
+  Fail();
+  auto d = brk_.ToDict(kGw);
+  B loaded;
+  loaded.Load(kGw, d);
+  EXPECT_TRUE(loaded.IsOpen(kGw));
+  EXPECT_EQ(loaded.Allow(kGw), B::Admit::No);
+}
@@ -0,0 +1,208 @@
+#include "dns_txt_cache.h"
+
+#include <base/files/file_util.h>
+#include <base/json/json_reader.h>
+#include <base/json/json_writer.h>
+#include <base/logging.h>
+#include <base/task/sequenced_task_runner.h>
+#include <base/task/task_traits.h>
+#include <base/task/thread_pool.h>
+
+#include <algorithm>
+
+using Self = ipfs::DnsTxtCache;
+
+namespace {
+using namespace std::literals;
+auto constexpr kRecordsKey = "r"sv;
+auto constexpr kResolvedKey = "at"sv;
+auto constexpr kTtlKey = "ttl"sv;
+}  // namespace
+
+Self::DnsTxtCache() = default;
+Self::DnsTxtCache(base::FilePath dir) : loaded_{dir.empty()} {
+  if (dir.empty()) {
+    return;
+  }
+  io_ = base::ThreadPool::CreateSequencedTaskRunner(
+      {base::MayBlock(), base::TaskPriority::BEST_EFFORT,
+       base::TaskShutdownBehavior::BLOCK_SHUTDOWN});
+  writer_ = std::make_unique<base::ImportantFileWriter>(
+      dir.AppendASCII(kFileName), io_, kSaveDelay);
+}
+Self::~DnsTxtCache() noexcept {
+  if (writer_ && writer_->HasPendingWrite()) {
+    writer_->DoScheduledWrite();
+  }
+}
+
+auto Self::Entry::StateAt(base::Time now) const -> State {
+  if (now >= expires()) {
+    return State::Stale;
+  }
+  if (now >= refresh_at()) {
+    return State::RefreshDue;
+  }
+  return State::Fresh;
+}
+void Self::WhenLoaded(base::OnceClosure cb) {
+  if (loaded_) {
+    std::move(cb).Run();
+    return;
+  }
+  on_loaded_.push_back(std::move(cb));
+  Load();
+}
+void Self::Load() {
+  if (loading_ || loaded_) {
+    return;
+  }
+  loading_ = true;
+  auto read = [](base::FilePath p) -> std::optional<std::string> {
+    std::string contents;
+    if (!base::ReadFileToString(p, &contents)) {
+      return std::nullopt;
+    }
+    return contents;
+  };
+  io_->PostTaskAndReplyWithResult(
+      FROM_HERE, base::BindOnce(read, writer_->path()),
+      base::BindOnce(&Self::OnRead, weak_factory_.GetWeakPtr()));
+}
+void Self::OnRead(std::optional<std::string> contents) {
+  loading_ = false;
+  loaded_ = true;
+  auto changed = !entries_.empty();
+  if (contents) {
+    // Anything resolved since startup is newer than what was saved.
+    entries_.merge(Parse(*contents, base::Time::Now()));
+    VLOG(1) << "Loaded " << entries_.size() << " DNS TXT cache entries.";
+  }
+  while (entries_.size() > kMaxEntries) {
+    Evict();
+  }
+  if (changed) {
+    Save();
+  }
+  for (auto& cb : std::exchange(on_loaded_, {})) {
+    std::move(cb).Run();
+  }
+}
+auto Self::Use(std::string_view host, base::Time now) -> Entry const* {
+  Load();
+  auto it = entries_.find(host);
+  if (it == entries_.end()) {
+    return nullptr;
+  }
+  auto& e = it->second;
+  if (now - e.expires() > kMaxStale) {
+    entries_.erase(it);
+    return nullptr;
+  }
+  ++e.hits;
+  return &e;
+}
+void Self::Store(std::string_view host,
+                 std::vector<std::string> records,
+                 std::optional<base::TimeDelta> ttl,
+                 base::Time now) {
+  auto [it, fresh] = entries_.emplace(std::string{host}, Entry{});
+  auto& e = it->second;
+  e.records = std::move(records);
+  e.resolved = now;
+  e.ttl = std::clamp(ttl.value_or(kDefaultTtl), kMinTtl, kMaxTtl);
+  e.hits = 0;
+  VLOG(2) << "TXT records for " << host << " good for " << e.ttl;
+  if (fresh && entries_.size() > kMaxEntries) {
+    Evict();
+  }
+  Save();
+}
+void Self::Save() {
+  // Writing before what's on disk has been read would lose it.
+  if (writer_ && loaded_) {
+    writer_->ScheduleWrite(this);
+  }
+}
+void Self::Refreshing(std::string_view host) {
+  if (auto it = entries_.find(host); it != entries_.end()) {
+    it->second.hits = 0;
+  }
+}
+auto Self::NextRefresh() const
+    -> std::optional<std::pair<std::string, base::Time>> {
+  std::optional<std::pair<std::string, base::Time>> rv;
+  for (auto& [host, e] : entries_) {
+    if (e.hits < kPopular) {
+      continue;
+    }
+    if (!rv || e.refresh_at() < rv->second) {
+      rv.emplace(host, e.refresh_at());
+    }
+  }
+  return rv;
+}
+void Self::Evict() {
+  // Whichever was resolved longest ago is closest to useless.
+  auto oldest = std::min_element(
+      entries_.begin(), entries_.end(), [](auto& a, auto& b) {
+        return a.second.resolved < b.second.resolved;
+      });
+  if (oldest != entries_.end()) {
+    entries_.erase(oldest);
+  }
+}
+std::optional<std::string> Self::SerializeData() {
+  auto now = base::Time::Now();
+  base::Value::Dict all;
+  for (auto& [host, e] : entries_) {
+    if (now - e.expires() > kMaxStale) {
+      continue;
+    }
+    base::Value::List records;
+    for (auto& r : e.records) {
+      records.Append(r);
+    }
+    base::Value::Dict d;
+    d.Set(kRecordsKey, std::move(records));
+    d.Set(kResolvedKey, e.resolved.InSecondsFSinceUnixEpoch());
+    d.Set(kTtlKey, e.ttl.InSecondsF());
+    all.Set(host, std::move(d));
+  }
+  std::string out;
+  if (!base::JSONWriter::Write(all, &out)) {
+    return std::nullopt;
+  }
+  return out;
+}
+auto Self::Parse(std::string_view contents, base::Time now)
+    -> std::map<std::string, Entry, std::less<>> {
+  std::map<std::string, Entry, std::less<>> rv;
+  auto all = base::JSONReader::ReadDict(contents);
+  if (!all) {
+    LOG(WARNING) << "Discarding unreadable DNS TXT cache.";
+    return rv;
+  }
+  for (auto [host, v] : *all) {
+    auto* d = v.GetIfDict();
+    auto* records = d ? d->FindList(kRecordsKey) : nullptr;
+    auto at = d ? d->FindDouble(kResolvedKey) : std::nullopt;
+    auto ttl = d ? d->FindDouble(kTtlKey) : std::nullopt;
+    if (!records || !at || !ttl) {
+      continue;
+    }
+    Entry e;
+    e.resolved = base::Time::FromSecondsSinceUnixEpoch(*at);
+    e.ttl = std::clamp(base::Seconds(*ttl), kMinTtl, kMaxTtl);
+    if (now - e.expires() > kMaxStale) {
+      continue;
+    }
+    for (auto& r : *records) {
+      if (auto* s = r.GetIfString()) {
+        e.records.push_back(*s);
+      }
+    }
+    rv.emplace(host, std::move(e));
+  }
+  return rv;
+}
@@ -0,0 +1,129 @@
+#ifndef IPFS_DNS_TXT_CACHE_H_
+#define IPFS_DNS_TXT_CACHE_H_
+
+#include <base/files/file_path.h>
+#include <base/files/important_file_writer.h>
+#include <base/functional/callback.h>
+#include <base/memory/scoped_refptr.h>
+#include <base/memory/weak_ptr.h>
+#include <base/time/time.h>
+#include <base/values.h>
+
+#include <map>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace base {
+class SequencedTaskRunner;
+}
+
+namespace ipfs {
+
+/*! TXT records by host, kept for their TTL and then some
+ *  \details Owned by InterRequestState, used by ChromiumDnsTxtLookup, which
+ *    serves answers from here immediately - even stale ones, while a fresh
+ *    query is in flight - and re-resolves popular names ahead of expiry.
+ *    Keyed by wall-clock time so entries outlive the process: given a
+ *    directory, they're saved to a small JSON file there (debounced, off
+ *    this sequence) and read back the first time the cache is needed.
+ */
+class DnsTxtCache final : public base::ImportantFileWriter::DataSerializer {
+ public:
+  static constexpr char kFileName[] = "IpfsDnsTxt.json";
+  /*! Used when the resolver doesn't say */
+  static constexpr base::TimeDelta kDefaultTtl = base::Minutes(5);
+  static constexpr base::TimeDelta kMinTtl = base::Seconds(30);
+  static constexpr base::TimeDelta kMaxTtl = base::Days(1);
+  /*! Past expiry, still answer with this (while revalidating) for so long */
+  static constexpr base::TimeDelta kMaxStale = base::Days(7);
+  /*! Fraction of the TTL after which a refresh is started */
+  static constexpr double kRefreshAt = 0.8;
+  /*! Uses within a TTL that make a name worth refreshing unasked */
+  static constexpr int kPopular = 2;
+  static constexpr std::size_t kMaxEntries = 1024UL;
+  /*! Batch up changes for this long before writing */
+  static constexpr base::TimeDelta kSaveDelay = base::Seconds(10);
+
+  enum class State {
+    Fresh,       ///< Just answer
+    RefreshDue,  ///< Answer, and refresh in the background
+    Stale        ///< Past TTL: answer, and revalidate
+  };
+  struct Entry {
+    std::vector<std::string> records;
+    base::Time resolved;
+    base::TimeDelta ttl;
+    int hits = 0;  ///< Since last refreshed
+
+    base::Time refresh_at() const { return resolved + ttl * kRefreshAt; }
+    base::Time expires() const { return resolved + ttl; }
+    State StateAt(base::Time) const;
+  };
+
+  /*! In memory only */
+  DnsTxtCache();
+  /*! \param dir Directory (the profile's) to persist to */
+  explicit DnsTxtCache(base::FilePath dir);
+  ~DnsTxtCache() noexcept override;
+
+  DnsTxtCache(DnsTxtCache const&) = delete;
+  DnsTxtCache& operator=(DnsTxtCache const&) = delete;
+
+  /*! \brief Run once what was saved last time has been read
+   *  \details Starts reading it, if that hasn't happened yet.
+   *    Runs synchronously if already loaded (or nothing to load).
+   */
+  void WhenLoaded(base::OnceClosure);
+  bool loaded() const { return loaded_; }
+
+  /*! \brief Look up a host, counting it as a use
+   *  \return nullptr if absent, or stale beyond kMaxStale
+   */
+  Entry const* Use(std::string_view host, base::Time now);
+
+  /*! \brief Remember the answer to a query
+   *  \param ttl As given by the resolver, if it gave one
+   */
+  void Store(std::string_view host,
+             std::vector<std::string> records,
+             std::optional<base::TimeDelta> ttl,
+             base::Time now);
+
+  /*! \brief A refresh for this host has started: it's no longer due */
+  void Refreshing(std::string_view host);
+
+  /*! \return The popular host due a refresh soonest, and when */
+  std::optional<std::pair<std::string, base::Time>> NextRefresh() const;
+
+  std::size_t size() const { return entries_.size(); }
+
+  // base::ImportantFileWriter::DataSerializer
+  std::optional<std::string> SerializeData() override;
+
+  /*! \brief Read back what SerializeData wrote, skipping anything expired
+   *    beyond kMaxStale or malformed
+   */
+  static std::map<std::string, Entry, std::less<>> Parse(std::string_view,
+                                                         base::Time now);
+
+ private:
+  std::map<std::string, Entry, std::less<>> entries_;
+  scoped_refptr<base::SequencedTaskRunner> io_;
+  std::unique_ptr<base::ImportantFileWriter> writer_;
+  bool loaded_ = true;
+  bool loading_ = false;
+  std::vector<base::OnceClosure> on_loaded_;
+  base::WeakPtrFactory<DnsTxtCache> weak_factory_{this};
+
+  void Evict();
+  void Load();
+  void OnRead(std::optional<std::string>);
+  void Save();
+};
+}  // namespace ipfs
+
+#endif  // IPFS_DNS_TXT_CACHE_H_
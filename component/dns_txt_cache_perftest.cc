@@ -0,0 +1,103 @@
+#include "dns_txt_cache.h"
+
+#include "chromium_dns_txt_lookup.h"
+
+#include <base/files/file_util.h>
+#include <base/files/scoped_temp_dir.h>
+#include <base/functional/bind.h>
+#include <base/run_loop.h>
+#include <base/task/sequenced_task_runner.h>
+#include <base/test/task_environment.h>
+#include <base/timer/elapsed_timer.h>
+#include <mojo/public/cpp/bindings/remote.h>
+#include <net/base/address_list.h>
+#include <net/base/network_anonymization_key.h>
+#include <services/network/public/mojom/host_resolver.mojom.h>
+#include <services/network/test/test_network_context.h>
+#include <testing/gtest/include/gtest/gtest.h>
+#include <testing/perf/perf_result_reporter.h>
+
+namespace {
+/*! A typical uncached DNSLink TXT query, as seen from a laptop */
+constexpr base::TimeDelta kDnsDelay = base::Milliseconds(40);
+constexpr int kPasses = 20;
+constexpr char kHost[] = "_dnslink.example.com";
+
+/*! Answers every TXT query, after kDnsDelay */
+class SlowNetworkContext final : public network::TestNetworkContext {
+ public:
+  void ResolveHost(
+      network::mojom::HostResolverHostPtr,
+      net::NetworkAnonymizationKey const&,
+      network::mojom::ResolveHostParametersPtr,
+      mojo::PendingRemote<network::mojom::ResolveHostClient> client) override {
+    ++queries;
+    auto answer =
+        [](mojo::Remote<network::mojom::ResolveHostClient> c) {
+          c->OnTextResults({"dnslink=/ipfs/bafyexample"});
+          c->OnComplete(0, net::ResolveErrorInfo{}, net::AddressList{}, {});
+        };
+    base::SequencedTaskRunner::GetCurrentDefault()->PostDelayedTask(
+        FROM_HERE,
+        base::BindOnce(answer, mojo::Remote<network::mojom::ResolveHostClient>(
+                                   std::move(client))),
+        kDnsDelay);
+  }
+  int queries = 0;
+};
+
+/*! The first DNSLink navigation after startup, with & without last
+ *  session's answers on disk.
+ */
+class DnsTxtCachePerfTest : public testing::Test {
+ protected:
+  void SetUp() override { ASSERT_TRUE(dir_.CreateUniqueTempDir()); }
+  /*! \return How long a fresh cache+lookup took to answer the first query */
+  base::TimeDelta FirstLookup() {
+    auto cache = std::make_unique<ipfs::DnsTxtCache>(dir_.GetPath());
+    ipfs::ChromiumDnsTxtLookup lookup{
+        base::BindRepeating(
+            [](SlowNetworkContext* n) -> network::mojom::NetworkContext* {
+              return n;
+            },
+            base::Unretained(&network_)),
+        cache.get()};
+    ipfs::ctx::DnsTxtLookup& l = lookup;
+    base::RunLoop loop;
+    base::ElapsedTimer timer;
+    l.SendDnsTextRequest(
+        kHost, [](std::vector<std::string> const&) {}, loop.QuitClosure());
+    loop.Run();
+    auto took = timer.Elapsed();
+    // Destroying the cache writes it out; let that land before the next.
+    cache.reset();
+    env_.RunUntilIdle();
+    return took;
+  }
+  void Report(std::string const& metric, base::TimeDelta t) {
+    perf_test::PerfResultReporter reporter("DnsTxtCache", "first_navigation");
+    reporter.RegisterImportantMetric(metric, "us");
+    reporter.AddResult(metric, t.InMicrosecondsF());
+  }
+
+  base::test::TaskEnvironment env_;
+  base::ScopedTempDir dir_;
+  SlowNetworkContext network_;
+};
+}  // namespace
+
+TEST_F(DnsTxtCachePerfTest, ColdVersusWarm) {
+  base::TimeDelta cold;
+  base::TimeDelta warm;
+  for (auto p = 0; p < kPasses; ++p) {
+    ASSERT_TRUE(base::DeleteFile(
+        dir_.GetPath().AppendASCII(ipfs::DnsTxtCache::kFileName)));
+    cold += FirstLookup();
+    warm += FirstLookup();
+  }
+  Report("cold_start", cold / kPasses);
+  Report("warm_start", warm / kPasses);
+  // Warm starts were answered from disk, with nothing to revalidate.
+  EXPECT_EQ(network_.queries, kPasses);
+  EXPECT_LT(warm, cold);
+}
@@ -0,0 +1,141 @@
+#include "doh_txt_request.h"
+
+#include <base/functional/bind.h>
+#include <base/json/json_reader.h>
+#include <base/logging.h>
+#include <base/strings/escape.h>
+#include <base/values.h>
+#include <services/network/public/cpp/resource_request.h>
+#include <services/network/public/cpp/simple_url_loader.h>
+#include <services/network/public/mojom/url_loader_factory.mojom.h>
+
+#include <algorithm>
+
+using Self = ipfs::DohTxtRequest;
+
+namespace {
+constexpr net::NetworkTrafficAnnotationTag kTrafficAnnotation =
+    net::DefineNetworkTrafficAnnotation("ipfs_dnslink_doh", R"(
+      semantics {
+        sender: "IPFS component"
+        description:
+          "Looks up DNSLink TXT records with a DNS-over-HTTPS resolver."
+        trigger:
+          "Processing of an ipns:// URL whose name is a domain."
+        data: "The domain name being resolved."
+        destination: OTHER
+      }
+      policy {
+        cookies_allowed: NO
+        setting: "EnableIpfs"
+      }
+    )");
+/*! DNS answers are small. Anything bigger isn't one. */
+constexpr std::size_t kMaxBody = 64UL * 1024UL;
+constexpr base::TimeDelta kTimeout = base::Seconds(10);
+constexpr int kTxtType = 16;
+constexpr int kNoError = 0;
+constexpr int kNxDomain = 3;
+
+/*! Resolvers differ: some give the presentation format - one or more quoted
+ *  character-strings - and some give the text itself.
+ */
+std::string Unquote(std::string_view data) {
+  if (data.empty() || data.front() != '"') {
+    return std::string{data};
+  }
+  std::string rv;
+  auto quoted = false;
+  for (auto i = 0UL; i < data.size(); ++i) {
+    auto c = data[i];
+    if (c == '"') {
+      quoted = !quoted;
+    } else if (quoted && c == '\\' && i + 1 < data.size()) {
+      rv.push_back(data[++i]);
+    } else if (quoted) {
+      rv.push_back(c);
+    }
+  }
+  return rv;
+}
+}  // namespace
+
+Self::Answer::Answer() = default;
+Self::Answer::Answer(Answer&&) = default;
+auto Self::Answer::operator=(Answer&&) -> Answer& = default;
+Self::Answer::~Answer() noexcept = default;
+
+Self::DohTxtRequest(std::string_view host,
+                    std::string_view resolver,
+                    network::mojom::URLLoaderFactory* loader_factory,
+                    Done done)
+    : done_{std::move(done)} {
+  auto req = std::make_unique<network::ResourceRequest>();
+  req->url = GURL{QueryUrl(resolver, host)};
+  req->priority = net::HIGHEST;
+  req->credentials_mode = network::mojom::CredentialsMode::kOmit;
+  req->headers.SetHeader("Accept", "application/dns-json");
+  loader_ = network::SimpleURLLoader::Create(std::move(req), kTrafficAnnotation,
+                                             FROM_HERE);
+  loader_->SetTimeoutDuration(kTimeout);
+  DCHECK(loader_factory);
+  // Unretained: the loader won't call back once destroyed along with this.
+  loader_->DownloadToString(
+      loader_factory,
+      base::BindOnce(&Self::OnResponse, base::Unretained(this)), kMaxBody);
+}
+Self::~DohTxtRequest() noexcept = default;
+
+std::string Self::QueryUrl(std::string_view resolver, std::string_view host) {
+  std::string rv{resolver};
+  rv.push_back(rv.find('?') == std::string::npos ? '?' : '&');
+  rv.append("name=")
+      .append(base::EscapeQueryParamValue(host, true))
+      .append("&type=TXT");
+  return rv;
+}
+void Self::OnResponse(std::unique_ptr<std::string> body) {
+  std::optional<Answer> answer;
+  if (body) {
+    answer = Parse(*body);
+  } else {
+    VLOG(1) << "DoH query " << loader_->GetFinalURL()
+            << " failed: " << loader_->NetError();
+  }
+  std::move(done_).Run(std::move(answer));
+}
+auto Self::Parse(std::string_view json) -> std::optional<Answer> {
+  auto d = base::JSONReader::ReadDict(json);
+  if (!d) {
+    return std::nullopt;
+  }
+  auto status = d->FindInt("Status");
+  if (status == kNxDomain) {
+    return Answer{};
+  }
+  if (status != kNoError) {
+    return std::nullopt;
+  }
+  Answer rv;
+  auto* records = d->FindList("Answer");
+  if (!records) {
+    return rv;
+  }
+  for (auto& v : *records) {
+    auto* r = v.GetIfDict();
+    if (!r || r->FindInt("type") != kTxtType) {
+      // e.g. the CNAMEs followed to get there
+      continue;
+    }
+    auto* data = r->FindString("data");
+    if (!data) {
+      continue;
+    }
+    rv.records.push_back(Unquote(*data));
+    if (auto ttl = r->FindInt("TTL"); ttl && *ttl >= 0) {
+      auto t = base::Seconds(*ttl);
+      rv.ttl = rv.ttl ? std::min(*rv.ttl, t) : t;
+    }
+  }
+  return rv;
+}
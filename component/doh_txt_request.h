@@ -0,0 +1,74 @@
+#ifndef IPFS_DOH_TXT_REQUEST_H_
+#define IPFS_DOH_TXT_REQUEST_H_
+
+#include <base/functional/callback.h>
+#include <base/time/time.h>
+
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace network {
+class SimpleURLLoader;
+namespace mojom {
+class URLLoaderFactory;
+}
+}  // namespace network
+
+namespace ipfs {
+
+/*!
+ * \brief A TXT query sent to a DNS-over-HTTPS resolver's JSON API
+ * \details The format understood by e.g. Cloudflare's and Google's public
+ *    resolvers: GET resolver?name=host&type=TXT, Accept: application/dns-json
+ *    Unlike the system resolver, this doesn't depend on Chromium's built-in
+ *    DNS client being enabled, and it reports a TTL.
+ */
+class DohTxtRequest final {
+ public:
+  struct Answer {
+    Answer();
+    Answer(Answer&&);
+    Answer& operator=(Answer&&);
+    ~Answer() noexcept;
+    std::vector<std::string> records;
+    /*! Smallest among the TXT records, if any */
+    std::optional<base::TimeDelta> ttl;
+  };
+  /*! nullopt if the resolver couldn't be reached or didn't make sense */
+  using Done = base::OnceCallback<void(std::optional<Answer>)>;
+
+  /*!
+   * \param host The name to look up
+   * \param resolver URL of the resolver's JSON endpoint
+   * \param loader_factory Sends the request
+   * \param done Called once, unless this is destroyed first
+   */
+  DohTxtRequest(std::string_view host,
+                std::string_view resolver,
+                network::mojom::URLLoaderFactory* loader_factory,
+                Done done);
+  ~DohTxtRequest() noexcept;
+
+  DohTxtRequest(DohTxtRequest const&) = delete;
+  DohTxtRequest& operator=(DohTxtRequest const&) = delete;
+
+  /*! \return The URL to send to resolver for host */
+  static std::string QueryUrl(std::string_view resolver, std::string_view host);
+
+  /*! \brief Interpret a response body
+   *  \return Empty records for NXDOMAIN, nullopt for other failures
+   */
+  static std::optional<Answer> Parse(std::string_view json);
+
+ private:
+  std::unique_ptr<network::SimpleURLLoader> loader_;
+  Done done_;
+
+  void OnResponse(std::unique_ptr<std::string> body);
+};
+}  // namespace ipfs
+
+#endif  // IPFS_DOH_TXT_REQUEST_H_
@@ -0,0 +1,94 @@
+#include "preferences.h"
+
+#include "circuit_breaker.h"
+#include "gateway_latencies.h"
+
+#include <base/strings/stringprintf.h>
+#include <base/timer/elapsed_timer.h>
+#include <components/prefs/testing_pref_service.h>
+#include <content/public/test/browser_task_environment.h>
+#include <testing/gtest/include/gtest/gtest.h>
+#include <testing/perf/perf_result_reporter.h>
+
+#include <random>
+
+namespace {
+constexpr std::size_t kGateways = 1000UL;
+constexpr int kPasses = 100;
+
+/*! What the scheduler does: walk every gateway, while scores move about. */
+class GatewayConfigPerfTest : public testing::Test {
+ protected:
+  void SetUp() override {
+    ipfs::RegisterPreferences(prefs_.registry());
+    cfg_.emplace(&prefs_, latencies_, breaker_, nullptr, nullptr,
+                 base::FilePath{});
+    base::ElapsedTimer timer;
+    for (auto i = 0UL; i < kGateways; ++i) {
+      cfg_->AddGateway(Prefix(i), rng_() % 1000U);
+    }
+    Report("discover_1000", timer.Elapsed());
+  }
+  static std::string Prefix(std::size_t i) {
+    return base::StringPrintf("https://gw%zu.example/", i);
+  }
+  void Report(std::string const& metric, base::TimeDelta t) {
+    perf_test::PerfResultReporter reporter("ChromiumIpfsGatewayConfig",
+                                           "1000_gateways");
+    reporter.RegisterImportantMetric(metric, "us");
+    reporter.AddResult(metric, t.InMicrosecondsF());
+  }
+  std::size_t IterateAll() {
+    std::size_t n = 0UL;
+    for (auto i = 0UL; cfg_->GetGateway(i); ++i) {
+      ++n;
+    }
+    return n;
+  }
+
+  content::BrowserTaskEnvironment env_;
+  TestingPrefServiceSimple prefs_;
+  ipfs::GatewayLatencies latencies_;
+  ipfs::CircuitBreaker breaker_;
+  std::optional<ipfs::ChromiumIpfsGatewayConfig> cfg_;
+  std::mt19937 rng_{42U};
+};
+}  // namespace
+
+TEST_F(GatewayConfigPerfTest, IterateAll) {
+  base::ElapsedTimer timer;
+  std::size_t seen = 0UL;
+  for (auto p = 0; p < kPasses; ++p) {
+    seen += IterateAll();
+  }
+  Report("iterate_all", timer.Elapsed() / kPasses);
+  EXPECT_GE(seen, kGateways * kPasses);
+}
+
+TEST_F(GatewayConfigPerfTest, ScoreChurn) {
+  // Each pass: every gateway's score moves by one, then a full iteration.
+  base::ElapsedTimer timer;
+  for (auto p = 0; p < kPasses; ++p) {
+    for (auto i = 0UL; i < kGateways; ++i) {
+      auto k = Prefix(i);
+      auto r = cfg_->GetGatewayRate(k);
+      cfg_->SetGatewayRate(k, rng_() % 2U ? r + 1U : (r ? r - 1U : 0U));
+    }
+    IterateAll();
+  }
+  Report("churn_then_iterate", timer.Elapsed() / kPasses);
+}
+
+TEST_F(GatewayConfigPerfTest, OrderIsKept) {
+  for (auto i = 0UL; i < kGateways; i += 7UL) {
+    cfg_->SetGatewayRate(Prefix(i), rng_() % 5000U);
+  }
+  std::optional<unsigned> prev;
+  for (auto i = 0UL; auto gw = cfg_->GetGateway(i); ++i) {
+    // No latencies known, so order is purely by rate.
+    if (prev) {
+      EXPECT_LE(gw->rate, *prev) << i;
+    }
+    prev = gw->rate;
+  }
+}
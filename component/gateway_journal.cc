@@ -0,0 +1,105 @@
+#include "gateway_journal.h"
+
+#include <base/files/file_util.h>
+#include <base/json/json_reader.h>
+#include <base/json/json_writer.h>
+#include <base/logging.h>
+#include <base/strings/string_split.h>
+#include <base/task/sequenced_task_runner.h>
+#include <base/task/task_traits.h>
+#include <base/task/thread_pool.h>
+
+using Self = ipfs::GatewayJournal;
+
+Self::GatewayJournal(base::FilePath dir)
+    : path_{dir.AppendASCII(kFileName)},
+      rotated_{path_.AddExtensionASCII("old")},
+      io_{base::ThreadPool::CreateSequencedTaskRunner(
+          {base::MayBlock(), base::TaskPriority::BEST_EFFORT,
+           base::TaskShutdownBehavior::BLOCK_SHUTDOWN})} {}
+Self::~GatewayJournal() noexcept = default;
+
+void Self::Replay(base::OnceCallback<void(base::Value::Dict)> cb) {
+  auto read = [](base::FilePath old, base::FilePath p) {
+    std::string contents;
+    if (!base::ReadFileToString(old, &contents)) {
+      contents.clear();
+    }
+    std::string current;
+    if (base::ReadFileToString(p, &current)) {
+      contents.append(1, '\n').append(current);
+    }
+    return contents;
+  };
+  auto parse = [](base::WeakPtr<Self> me,
+                  base::OnceCallback<void(base::Value::Dict)> cb,
+                  std::string contents) {
+    if (!me) {
+      return;
+    }
+    std::size_t n = 0UL;
+    auto result = Parse(contents, &n);
+    me->records_ += n;
+    VLOG(1) << "Replayed " << n << " gateway journal records.";
+    std::move(cb).Run(std::move(result));
+  };
+  io_->PostTaskAndReplyWithResult(
+      FROM_HERE, base::BindOnce(read, rotated_, path_),
+      base::BindOnce(parse, weak_factory_.GetWeakPtr(), std::move(cb)));
+}
+void Self::Append(base::Value::Dict changes) {
+  if (changes.empty()) {
+    return;
+  }
+  std::string line;
+  if (!base::JSONWriter::Write(changes, &line)) {
+    LOG(ERROR) << "Could not serialize gateway changes for the journal.";
+    return;
+  }
+  line.push_back('\n');
+  records_++;
+  auto append = [](base::FilePath p, std::string data) {
+    if (!base::AppendToFile(p, data) && !base::WriteFile(p, data)) {
+      LOG(ERROR) << "Failed to write gateway journal " << p;
+    }
+  };
+  io_->PostTask(FROM_HERE, base::BindOnce(append, path_, std::move(line)));
+}
+void Self::Rotate() {
+  records_ = 0UL;
+  auto rotate = [](base::FilePath p, base::FilePath old) {
+    std::string contents;
+    if (!base::ReadFileToString(p, &contents) || contents.empty()) {
+      return;
+    }
+    if (!base::AppendToFile(old, contents) && !base::WriteFile(old, contents)) {
+      LOG(ERROR) << "Failed to set aside gateway journal " << p;
+      return;
+    }
+    base::WriteFile(p, "");
+  };
+  io_->PostTask(FROM_HERE, base::BindOnce(rotate, path_, rotated_));
+}
+void Self::DropRotated() {
+  auto drop = [](base::FilePath old) { base::DeleteFile(old); };
+  io_->PostTask(FROM_HERE, base::BindOnce(drop, rotated_));
+}
+base::Value::Dict Self::Parse(std::string_view contents, std::size_t* records) {
+  base::Value::Dict result;
+  for (auto line : base::SplitStringPiece(contents, "\n", base::TRIM_WHITESPACE,
+                                          base::SPLIT_WANT_NONEMPTY)) {
+    auto parsed = base::JSONReader::ReadDict(line);
+    if (!parsed) {
+      // Most likely the browser died mid-write. Later lines are still good.
+      LOG(WARNING) << "Skipping unreadable gateway journal record.";
+      continue;
+    }
+    for (auto [k, v] : *parsed) {
+      result.Set(k, std::move(v));
+    }
+    if (records) {
+      ++*records;
+    }
+  }
+  return result;
+}
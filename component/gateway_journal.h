@@ -0,0 +1,68 @@
+#ifndef IPFS_GATEWAY_JOURNAL_H_
+#define IPFS_GATEWAY_JOURNAL_H_
+
+#include <base/files/file_path.h>
+#include <base/functional/callback.h>
+#include <base/memory/scoped_refptr.h>
+#include <base/memory/weak_ptr.h>
+#include <base/values.h>
+
+namespace base {
+class SequencedTaskRunner;
+}
+
+namespace ipfs {
+
+/*! Append-only record of changes to gateway preferences
+ *  \details A file of newline-separated JSON objects, each mapping gateway
+ *    prefixes to their complete, current entry. Replaying it in order over
+ *    the ipfs.gateway preference gives the latest state. All file access
+ *    happens on a background sequence, in the order requested.
+ */
+class GatewayJournal {
+ public:
+  static constexpr char kFileName[] = "IpfsGateways.journal";
+
+  /*! \param dir Directory (the profile's) to keep the journal in */
+  explicit GatewayJournal(base::FilePath dir);
+  ~GatewayJournal() noexcept;
+
+  GatewayJournal(GatewayJournal const&) = delete;
+  GatewayJournal& operator=(GatewayJournal const&) = delete;
+
+  /*! \brief Read the journal back, later records winning
+   *  \details Includes records set aside by Rotate and not yet dropped.
+   *  \param cb Called on this sequence with prefix -> entry,
+   *    unless this journal has been destroyed first
+   */
+  void Replay(base::OnceCallback<void(base::Value::Dict)> cb);
+
+  /*! \brief Write one record: prefix -> complete entry */
+  void Append(base::Value::Dict changes);
+
+  /*! \brief Set the records so far aside, and start the journal afresh
+   *  \details They're still replayed until DropRotated. So call this
+   *    before saving them elsewhere, and DropRotated once that's done.
+   */
+  void Rotate();
+
+  /*! \brief Forget the records set aside by Rotate, now they're saved */
+  void DropRotated();
+
+  /*! \return Records in the journal, including any found by Replay */
+  std::size_t records() const { return records_; }
+
+  /*! \brief Parse journal contents; tolerates a torn final line */
+  static base::Value::Dict Parse(std::string_view contents,
+                                 std::size_t* records);
+
+ private:
+  base::FilePath path_;
+  base::FilePath rotated_;
+  scoped_refptr<base::SequencedTaskRunner> io_;
+  std::size_t records_ = 0UL;
+  base::WeakPtrFactory<GatewayJournal> weak_factory_{this};
+};
+}  // namespace ipfs
+
+#endif  // IPFS_GATEWAY_JOURNAL_H_
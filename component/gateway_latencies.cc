@@ -0,0 +1,120 @@
+#include "gateway_latencies.h"
+
+#include <ipfs_client/gw/gateway_request_type.h>
+
+using Self = ipfs::GatewayLatencies;
+using RT = ipfs::gw::GatewayRequestType;
+
+namespace {
+using namespace std::literals;
+auto constexpr kTtfb = "ttfb"sv;
+auto constexpr kTotal = "total"sv;
+auto constexpr kTtfbQ = "ttfb_q"sv;
+auto constexpr kTotalQ = "total_q"sv;
+}  // namespace
+
+void Self::Record(std::string const& gateway,
+                  gw::GatewayRequestType typ,
+                  base::TimeDelta ttfb,
+                  base::TimeDelta total) {
+  auto& s = stats_[gateway][typ];
+  auto t = ttfb.InMillisecondsF();
+  auto T = total.InMillisecondsF();
+  s.ttfb.Add(t);
+  s.ttfb_q.Add(t);
+  s.total.Add(T);
+  s.total_q.Add(T);
+  changed_[gateway] = ++generation_;
+}
+std::size_t Self::generation(std::string_view gateway) const {
+  auto it = changed_.find(gateway);
+  return it == changed_.end() ? 0UL : it->second;
+}
+auto Self::Find(std::string_view gateway, gw::GatewayRequestType typ) const
+    -> Stats const* {
+  auto g = stats_.find(gateway);
+  if (g == stats_.end()) {
+    return nullptr;
+  }
+  auto t = g->second.find(typ);
+  return t == g->second.end() ? nullptr : &(t->second);
+}
+std::optional<double> Self::ExpectedMillis(std::string_view gateway,
+                                           gw::GatewayRequestType typ) const {
+  auto* s = Find(gateway, typ);
+  if (!s || !s->total.value()) {
+    return std::nullopt;
+  }
+  // The average alone hides a fat tail, which is what actually hurts.
+  auto mean = s->total.value().value();
+  auto p90 = s->total_q.Quantile(0.9).value_or(mean);
+  return (mean + p90) / 2.0;
+}
+std::optional<double> Self::Percentile(std::string_view gateway,
+                                       gw::GatewayRequestType typ,
+                                       double q) const {
+  if (auto* s = Find(gateway, typ)) {
+    return s->total_q.Quantile(q);
+  }
+  return std::nullopt;
+}
+base::Value::Dict Self::ToDict(std::string_view gateway) const {
+  base::Value::Dict result;
+  auto g = stats_.find(gateway);
+  if (g == stats_.end()) {
+    return result;
+  }
+  for (auto& [typ, s] : g->second) {
+    base::Value::Dict d;
+    if (auto v = s.ttfb.value()) {
+      d.Set(kTtfb, *v);
+    }
+    if (auto v = s.total.value()) {
+      d.Set(kTotal, *v);
+    }
+    d.Set(kTtfbQ, s.ttfb_q.ToList());
+    d.Set(kTotalQ, s.total_q.ToList());
+    result.Set(name(typ), std::move(d));
+  }
+  return result;
+}
+void Self::Load(std::string_view gateway, base::Value::Dict const& dict) {
+  for (auto [k, v] : dict) {
+    auto typ = gw::from_name(k);
+    auto* d = v.GetIfDict();
+    if (!typ || !d) {
+      continue;
+    }
+    auto& s = stats_[std::string{gateway}][*typ];
+    if (auto t = d->FindDouble(kTtfb)) {
+      s.ttfb.value(*t);
+    }
+    if (auto t = d->FindDouble(kTotal)) {
+      s.total.value(*t);
+    }
+    s.ttfb_q = LatencySketch::FromList(d->FindList(kTtfbQ));
+    s.total_q = LatencySketch::FromList(d->FindList(kTotalQ));
+  }
+  changed_[std::string{gateway}] = ++generation_;
+}
+auto Self::TypeOf(HttpRequestDescription const& desc)
+    -> std::optional<gw::GatewayRequestType> {
+  std::string_view url{desc.url};
+  std::string_view accept{desc.accept};
+  if (url.find("/routing/v1/providers/") != std::string_view::npos) {
+    return RT::Providers;
+  }
+  if (accept.find("application/vnd.ipld.car") != std::string_view::npos) {
+    return RT::Car;
+  }
+  if (accept.find("application/vnd.ipfs.ipns-record") != std::string_view::npos) {
+    return RT::Ipns;
+  }
+  if (url.find("/ipns/") != std::string_view::npos) {
+    return RT::DnsLink;
+  }
+  if (url.find("/ipfs/") != std::string_view::npos) {
+    return RT::Block;
+  }
+  return std::nullopt;
+}
@@ -0,0 +1,87 @@
+#ifndef IPFS_GATEWAY_LATENCIES_H_
+#define IPFS_GATEWAY_LATENCIES_H_
+
+#include "latency_sketch.h"
+
+#include <ipfs_client/gw/gateway_request_type.h>
+#include <ipfs_client/http_request_description.h>
+
+#include <base/time/time.h>
+#include <base/values.h>
+
+#include <map>
+#include <optional>
+#include <string>
+#include <string_view>
+
+namespace ipfs {
+
+/*! How quickly each gateway has been answering, per type of request
+ *  \details Owned by InterRequestState, fed by ChromiumHttp, read (and
+ *    persisted) by ChromiumIpfsGatewayConfig.
+ */
+class GatewayLatencies {
+ public:
+  /*! Latency observations for one (gateway, request type) */
+  struct Stats {
+    Ewma ttfb;
+    Ewma total;
+    LatencySketch ttfb_q;
+    LatencySketch total_q;
+  };
+
+  /*! \brief Note a successful response
+   *  \param gateway \see GatewayThrottle::GatewayKey
+   *  \param ttfb Time from sending to the response head
+   *  \param total Time from sending to the end of the body
+   */
+  void Record(std::string const& gateway,
+              gw::GatewayRequestType,
+              base::TimeDelta ttfb,
+              base::TimeDelta total);
+
+  Stats const* Find(std::string_view gateway, gw::GatewayRequestType) const;
+
+  /*! \return The expected time to complete a request of this type, in ms,
+   *    or nullopt if nothing is known about the gateway.
+   */
+  std::optional<double> ExpectedMillis(std::string_view gateway,
+                                       gw::GatewayRequestType) const;
+
+  /*! \return Latency-at-quantile for this gateway & type, in ms */
+  std::optional<double> Percentile(std::string_view gateway,
+                                   gw::GatewayRequestType,
+                                   double q) const;
+
+  /*! \brief Serialize everything known about a gateway, for preferences
+   *  \return A dict keyed by request type name, or empty if nothing known
+   */
+  base::Value::Dict ToDict(std::string_view gateway) const;
+
+  /*! \brief Restore what ToDict produced */
+  void Load(std::string_view gateway, base::Value::Dict const&);
+
+  /*! \brief Incremented on every change, so readers know to re-rank */
+  std::size_t generation() const { return generation_; }
+
+  /*! \return generation() as of this gateway's last change, or 0 if there
+   *    never was one, so readers know whether it needs saving again
+   */
+  std::size_t generation(std::string_view gateway) const;
+
+  /*! \brief Guess the type of request from its description
+   *  \details HttpApi doesn't carry the request type, but the Accept header
+   *    and path identify it unambiguously.
+   */
+  static std::optional<gw::GatewayRequestType> TypeOf(
+      HttpRequestDescription const&);
+
+ private:
+  using ByType = std::map<gw::GatewayRequestType, Stats>;
+  std::map<std::string, ByType, std::less<>> stats_;
+  std::map<std::string, std::size_t, std::less<>> changed_;
+  std::size_t generation_ = 0UL;
+};
+}  // namespace ipfs
+
+#endif  // IPFS_GATEWAY_LATENCIES_H_
@@ -0,0 +1,238 @@
+#include "gateway_throttle.h"
+
+#include <base/logging.h>
+#include <base/strings/string_number_conversions.h>
+#include <base/strings/string_util.h>
+#include <base/task/sequenced_task_runner.h>
+#include <url/gurl.h>
+
+#include <algorithm>
+
+using Self = ipfs::GatewayThrottle;
+
+Self::GatewayThrottle() = default;
+Self::~GatewayThrottle() noexcept = default;
+
+auto Self::Submit(std::string const& gateway,
+                  Send send,
+                  net::RequestPriority priority) -> Ticket {
+  auto& gw = gateways_[gateway];
+  auto ticket = next_ticket_++;
+  auto idle = priority <= net::IDLE;
+  // Ahead of any idle requests, or behind everything.
+  auto at = idle ? gw.queue.end()
+                 : std::ranges::find_if(gw.queue, &Pending::idle);
+  gw.queue.insert(at, {ticket, std::move(send), idle});
+  Drain(gateway);
+  if (auto it = gateways_.find(gateway); it != gateways_.end() &&
+      std::ranges::find(it->second.queue, ticket, &Pending::ticket) !=
+          it->second.queue.end()) {
+    VLOG(2) << "Queued request to " << gateway << " behind "
+            << it->second.in_flight << " in flight.";
+  }
+  return ticket;
+}
+void Self::Withdraw(std::string const& gateway, Ticket ticket) {
+  auto it = gateways_.find(gateway);
+  if (it == gateways_.end()) {
+    return;
+  }
+  auto& q = it->second.queue;
+  std::erase_if(q, [ticket](auto& p) { return p.ticket == ticket; });
+}
+void Self::Admit(std::string const& gateway, Gateway& gw, Pending p) {
+  gw.in_flight++;
+  if (p.idle) {
+    gw.idle_in_flight++;
+  }
+  if (gw.per_minute > 0.0) {
+    gw.tokens -= 1.0;
+  }
+  auto release = base::BindOnce(&Self::Release, weak_factory_.GetWeakPtr(),
+                                gateway, p.idle);
+  std::move(p.send).Run(base::ScopedClosureRunner{std::move(release)});
+}
+void Self::Release(std::string gateway, bool idle) {
+  auto it = gateways_.find(gateway);
+  if (it == gateways_.end()) {
+    return;
+  }
+  auto& gw = it->second;
+  DCHECK_GT(gw.in_flight, 0UL);
+  if (gw.in_flight) {
+    gw.in_flight--;
+  }
+  if (idle && gw.idle_in_flight) {
+    gw.idle_in_flight--;
+  }
+  Drain(gateway);
+}
+void Self::Drain(std::string const& gateway) {
+  auto it = gateways_.find(gateway);
+  if (it == gateways_.end()) {
+    return;
+  }
+  auto& gw = it->second;
+  auto limit = Limit(gateway);
+  auto now = base::TimeTicks::Now();
+  while (!gw.queue.empty() && gw.in_flight < limit) {
+    if (gw.queue.front().idle && gw.idle_in_flight >= IdleLimit(gateway)) {
+      // Only idle requests are left, and they have their share of slots.
+      return;
+    }
+    if (auto wait = Wait(gw, now)) {
+      // Held by rate rather than concurrency: nothing will Release to wake us.
+      if (!gw.wake_pending) {
+        gw.wake_pending = true;
+        base::SequencedTaskRunner::GetCurrentDefault()->PostDelayedTask(
+            FROM_HERE,
+            base::BindOnce(&Self::Wake, weak_factory_.GetWeakPtr(), gateway),
+            *wait);
+      }
+      return;
+    }
+    auto p = std::move(gw.queue.front());
+    gw.queue.pop_front();
+    Admit(gateway, gw, std::move(p));
+  }
+}
+void Self::RecordProtocol(std::string const& gateway, std::string_view alpn) {
+  auto p = Protocol::Http1;
+  if (alpn == "h2") {
+    p = Protocol::Http2;
+  } else if (alpn == "h3" || alpn.starts_with("h3-") || alpn == "quic") {
+    p = Protocol::Http3;
+  } else if (alpn.empty() || alpn == "unknown") {
+    // Cached responses and the like don't tell us anything.
+    return;
+  }
+  auto& gw = gateways_[gateway];
+  if (gw.protocol != p) {
+    VLOG(1) << "Gateway " << gateway << " speaks '" << alpn << "'.";
+    gw.protocol = p;
+    Drain(gateway);
+  }
+}
+void Self::Wake(std::string gateway) {
+  auto it = gateways_.find(gateway);
+  if (it == gateways_.end()) {
+    return;
+  }
+  it->second.wake_pending = false;
+  Drain(gateway);
+}
+void Self::Refill(Gateway& gw, base::TimeTicks now) const {
+  auto cap = std::max(kMinBurst, gw.per_minute * kBurstMinutes);
+  auto earned = (now - gw.refilled).InMinutesF() * gw.per_minute;
+  gw.tokens = std::min(cap, gw.tokens + earned);
+  gw.refilled = now;
+}
+auto Self::Wait(Gateway& gw, base::TimeTicks now) const
+    -> std::optional<base::TimeDelta> {
+  if (now < gw.resume_at) {
+    return gw.resume_at - now;
+  }
+  if (gw.per_minute <= 0.0) {
+    return std::nullopt;
+  }
+  Refill(gw, now);
+  if (gw.tokens >= 1.0) {
+    return std::nullopt;
+  }
+  return base::Minutes(1) * ((1.0 - gw.tokens) / gw.per_minute);
+}
+void Self::SetRate(std::string const& gateway, unsigned per_minute) {
+  auto& gw = gateways_[gateway];
+  auto r = static_cast<double>(per_minute);
+  if (r == gw.per_minute) {
+    return;
+  }
+  auto now = base::TimeTicks::Now();
+  if (gw.per_minute > 0.0) {
+    Refill(gw, now);
+  } else {
+    // Newly limited: start with a full bucket.
+    gw.tokens = std::max(kMinBurst, r * kBurstMinutes);
+    gw.refilled = now;
+  }
+  gw.per_minute = r;
+  Drain(gateway);
+}
+void Self::RecordResponse(std::string const& gateway,
+                          int status,
+                          std::optional<base::TimeDelta> retry_after) {
+  auto& gw = gateways_[gateway];
+  if (status == 429 || (status == 503 && retry_after)) {
+    auto pause = retry_after.value_or(kDefaultRetryAfter *
+                                      (1 << std::min(gw.strikes, 7)));
+    pause = std::clamp(pause, base::TimeDelta{}, kMaxRetryAfter);
+    ++gw.strikes;
+    gw.resume_at = std::max(gw.resume_at, base::TimeTicks::Now() + pause);
+    gw.tokens = std::min(gw.tokens, 0.0);
+    VLOG(1) << "Gateway " << gateway << " is rate-limiting us (" << status
+            << "), pausing " << pause;
+  } else if (status / 100 == 2) {
+    gw.strikes = 0;
+  }
+}
+std::optional<base::TimeDelta> Self::ParseRetryAfter(std::string_view value,
+                                                     base::Time now) {
+  auto v = base::TrimWhitespaceASCII(value, base::TRIM_ALL);
+  if (v.empty()) {
+    return std::nullopt;
+  }
+  int secs = 0;
+  if (base::StringToInt(v, &secs)) {
+    if (secs < 0) {
+      return std::nullopt;
+    }
+    return base::Seconds(secs);
+  }
+  base::Time when;
+  if (base::Time::FromUTCString(std::string{v}.c_str(), &when)) {
+    return std::max(when - now, base::TimeDelta{});
+  }
+  return std::nullopt;
+}
+auto Self::protocol(std::string const& gateway) const -> Protocol {
+  auto it = gateways_.find(gateway);
+  return it == gateways_.end() ? Protocol::Unknown : it->second.protocol;
+}
+std::size_t Self::Limit(std::string const& gateway) const {
+  switch (protocol(gateway)) {
+    case Protocol::Http2:
+    case Protocol::Http3:
+      return kMultiplexedLimit;
+    case Protocol::Http1:
+    case Protocol::Unknown:
+      return kHttp1Limit;
+  }
+  return kHttp1Limit;
+}
+std::size_t Self::IdleLimit(std::string const& gateway) const {
+  return std::max(Limit(gateway) / 2UL, 1UL);
+}
+std::size_t Self::in_flight(std::string const& gateway) const {
+  auto it = gateways_.find(gateway);
+  return it == gateways_.end() ? 0UL : it->second.in_flight;
+}
+std::size_t Self::queued(std::string const& gateway) const {
+  auto it = gateways_.find(gateway);
+  return it == gateways_.end() ? 0UL : it->second.queue.size();
+}
+bool Self::paused(std::string const& gateway) const {
+  auto it = gateways_.find(gateway);
+  return it != gateways_.end() &&
+         base::TimeTicks::Now() < it->second.resume_at;
+}
+std::string Self::GatewayKey(std::string_view url) {
+  GURL u{url};
+  if (!u.is_valid()) {
+    return std::string{url};
+  }
+  return u.GetWithEmptyPath().spec();
+}
+
+Self::Gateway::Gateway() = default;
+Self::Gateway::Gateway(Gateway&&) = default;
+Self::Gateway::~Gateway() noexcept = default;
@@ -0,0 +1,159 @@
+#ifndef IPFS_GATEWAY_THROTTLE_H_
+#define IPFS_GATEWAY_THROTTLE_H_
+
+#include <base/functional/callback.h>
+#include <base/functional/callback_helpers.h>
+#include <base/memory/weak_ptr.h>
+#include <base/time/time.h>
+#include <net/base/request_priority.h>
+
+#include <cstddef>
+#include <deque>
+#include <map>
+#include <optional>
+#include <string>
+#include <string_view>
+
+namespace ipfs {
+
+/*! Admission control for HTTP requests headed to gateways.
+ *  \details Shared by all requests in a profile, so it's owned by
+ *    InterRequestState. The scheduler decides *which* gateways get a request;
+ *    this decides how many of those may actually be on the wire at once,
+ *    based on the HTTP version the gateway negotiated.
+ *    HTTP/1.1 gateways are held to Chromium's per-host socket limit, as
+ *    anything beyond it would just wait in the socket pool behind
+ *    head-of-line blocking and burn its timeout there.
+ *    Multiplexed (h2/h3) gateways get a deep window.
+ *    Independently, each gateway has a token bucket refilled at its
+ *    max_requests_per_minute, and a 429 (or a 503 with Retry-After) pauses
+ *    it for as long as it asked.
+ *    Requests over any limit are queued, not failed. Idle ones (e.g.
+ *    prefetches) queue behind all the others and never hold more than
+ *    half a gateway's slots, so they can't keep a navigation waiting.
+ */
+class GatewayThrottle {
+ public:
+  enum class Protocol { Unknown, Http1, Http2, Http3 };
+
+  /*! Starts the request once admitted */
+  using Send = base::OnceCallback<void(base::ScopedClosureRunner slot)>;
+
+  /*! Returned by Submit, used to withdraw a request still in the queue */
+  using Ticket = std::size_t;
+
+  /*! Until a gateway has told us what it speaks, assume the worst. */
+  static constexpr std::size_t kHttp1Limit = 6UL;
+  /*! Typical SETTINGS_MAX_CONCURRENT_STREAMS is 100; leave some headroom. */
+  static constexpr std::size_t kMultiplexedLimit = 64UL;
+  /*! A full bucket holds this many minutes' worth of requests... */
+  static constexpr double kBurstMinutes = 0.25;
+  /*! ...but never fewer than this */
+  static constexpr double kMinBurst = 6.0;
+  /*! Pause after a 429 without Retry-After, doubling each time in a row */
+  static constexpr base::TimeDelta kDefaultRetryAfter = base::Seconds(1);
+  /*! Don't take a gateway's word for anything longer than this */
+  static constexpr base::TimeDelta kMaxRetryAfter = base::Minutes(2);
+
+  GatewayThrottle();
+  ~GatewayThrottle() noexcept;
+
+  GatewayThrottle(GatewayThrottle const&) = delete;
+  GatewayThrottle& operator=(GatewayThrottle const&) = delete;
+
+  /*! \brief Send now if the gateway has room, otherwise queue.
+   *  \param gateway Key for the gateway, \see GatewayKey
+   *  \param send Called (possibly synchronously) when admitted. The slot it
+   *     receives must be kept alive until the request is done or cancelled.
+   *  \param priority net::IDLE or below goes in the idle lane
+   *  \return A ticket usable with Withdraw
+   */
+  Ticket Submit(std::string const& gateway,
+                Send send,
+                net::RequestPriority priority = net::HIGHEST);
+
+  /*! \brief Remove a not-yet-sent request from the queue.
+   *  \details No-op if it has already been admitted.
+   */
+  void Withdraw(std::string const& gateway, Ticket);
+
+  /*! \brief Note which protocol was negotiated with a gateway.
+   *  \param alpn The ALPN string from the response head, e.g. "h2"
+   */
+  void RecordProtocol(std::string const& gateway, std::string_view alpn);
+
+  /*! \brief Set the gateway's token bucket refill rate
+   *  \param per_minute Its max_requests_per_minute. 0 for no limit.
+   */
+  void SetRate(std::string const& gateway, unsigned per_minute);
+
+  /*! \brief Note a response, to notice being rate limited
+   *  \param retry_after Parsed from the Retry-After header, if present
+   *  \details On 429, or 503 with Retry-After, nothing more is sent to the
+   *    gateway until the pause is over; queued requests stay queued.
+   */
+  void RecordResponse(std::string const& gateway,
+                      int status,
+                      std::optional<base::TimeDelta> retry_after);
+
+  /*! \brief Parse a Retry-After value: delay-seconds or an HTTP-date
+   *  \return nullopt if empty or unparseable
+   */
+  static std::optional<base::TimeDelta> ParseRetryAfter(std::string_view value,
+                                                        base::Time now);
+
+  Protocol protocol(std::string const& gateway) const;
+  std::size_t Limit(std::string const& gateway) const;
+  /*! \return How many of Limit() idle requests may hold */
+  std::size_t IdleLimit(std::string const& gateway) const;
+  std::size_t in_flight(std::string const& gateway) const;
+  std::size_t queued(std::string const& gateway) const;
+  /*! \return Whether the gateway asked us to back off, and hasn't yet said
+   *    it's OK to continue.
+   */
+  bool paused(std::string const& gateway) const;
+
+  /*! \brief The key used for per-gateway state
+   *  \param url A full URL of a request to the gateway
+   *  \return The scheme://host:port/ of the URL, which matches the
+   *    gateway prefix for all but path-routed gateways.
+   */
+  static std::string GatewayKey(std::string_view url);
+
+ private:
+  struct Pending {
+    Ticket ticket;
+    Send send;
+    bool idle = false;
+  };
+  struct Gateway {
+    Gateway();
+    Gateway(Gateway&&);
+    ~Gateway() noexcept;
+    Protocol protocol = Protocol::Unknown;
+    std::size_t in_flight = 0UL;
+    std::size_t idle_in_flight = 0UL;
+    /*! Idle requests are all behind the others */
+    std::deque<Pending> queue;
+    double per_minute = 0.0;  ///< 0: not rate limited
+    double tokens = 0.0;
+    base::TimeTicks refilled;
+    base::TimeTicks resume_at;  ///< Paused until, after a 429
+    int strikes = 0;            ///< 429s in a row
+    bool wake_pending = false;
+  };
+  std::map<std::string, Gateway, std::less<>> gateways_;
+  Ticket next_ticket_ = 1UL;
+  base::WeakPtrFactory<GatewayThrottle> weak_factory_{this};
+
+  void Admit(std::string const& gateway, Gateway&, Pending);
+  void Release(std::string gateway, bool idle);
+  void Drain(std::string const& gateway);
+  void Refill(Gateway&, base::TimeTicks now) const;
+  /*! \return How long until the next request may go, if held by rate */
+  std::optional<base::TimeDelta> Wait(Gateway&, base::TimeTicks now) const;
+  void Wake(std::string gateway);
+};
+}  // namespace ipfs
+
+#endif  // IPFS_GATEWAY_THROTTLE_H_
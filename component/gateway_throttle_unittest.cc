@@ -0,0 +1,126 @@
+#include "gateway_throttle.h"
+
+#include <base/functional/bind.h>
+#include <base/test/task_environment.h>
+#include <net/base/request_priority.h>
+
+#include <gtest/gtest.h>
+
+#include <vector>
+
+using G = ipfs::GatewayThrottle;
+
+namespace {
+constexpr char kGw[] = "http://localhost:8080/";
+
+class GatewayThrottleTest : public testing::Test {
+ protected:
+  /*! \return Its ticket. Once admitted, its slot is held in slots_. */
+  G::Ticket Submit(net::RequestPriority priority = net::HIGHEST) {
+    auto hold = [](GatewayThrottleTest* t, bool idle,
+                   base::ScopedClosureRunner slot) {
+      t->slots_.push_back(std::move(slot));
+      ++t->admitted_;
+      if (idle) {
+        ++t->idle_admitted_;
+      }
+    };
+    return throttle_.Submit(kGw,
+                            base::BindOnce(hold, base::Unretained(this),
+                                           priority <= net::IDLE),
+                            priority);
+  }
+  /*! The oldest admitted request is done */
+  void Release() {
+    auto slot = std::move(slots_.front());
+    slots_.erase(slots_.begin());
+    slot.RunAndReset();
+  }
+
+  base::test::TaskEnvironment env_{
+      base::test::TaskEnvironment::TimeSource::MOCK_TIME};
+  G throttle_;
+  std::vector<base::ScopedClosureRunner> slots_;
+  int admitted_ = 0;
+  int idle_admitted_ = 0;
+};
+}  // namespace
+
+TEST_F(GatewayThrottleTest, Http1GetsChromiumsSocketLimit) {
+  for (auto i = 0UL; i < G::kHttp1Limit + 2UL; ++i) {
+    Submit();
+  }
+  EXPECT_EQ(admitted_, static_cast<int>(G::kHttp1Limit));
+  EXPECT_EQ(throttle_.queued(kGw), 2UL);
+  Release();
+  EXPECT_EQ(admitted_, static_cast<int>(G::kHttp1Limit) + 1);
+  throttle_.RecordProtocol(kGw, "h2");
+  EXPECT_EQ(admitted_, static_cast<int>(G::kHttp1Limit) + 2);
+  EXPECT_EQ(throttle_.Limit(kGw), G::kMultiplexedLimit);
+}
+
+TEST_F(GatewayThrottleTest, WithdrawnRequestsAreNeverSent) {
+  for (auto i = 0UL; i < G::kHttp1Limit; ++i) {
+    Submit();
+  }
+  auto t = Submit();
+  throttle_.Withdraw(kGw, t);
+  EXPECT_EQ(throttle_.queued(kGw), 0UL);
+  slots_.clear();
+  EXPECT_EQ(admitted_, static_cast<int>(G::kHttp1Limit));
+}
+
+TEST_F(GatewayThrottleTest, IdleRequestsGetHalfTheSlotsAndGoLast) {
+  for (auto i = 0; i < 5; ++i) {
+    Submit(net::IDLE);
+  }
+  EXPECT_EQ(idle_admitted_, static_cast<int>(throttle_.IdleLimit(kGw)));
+  for (auto i = 0; i < 4; ++i) {
+    Submit();
+  }
+  ASSERT_EQ(admitted_, static_cast<int>(G::kHttp1Limit));
+  EXPECT_EQ(throttle_.queued(kGw), 3UL);
+  // An idle request's slot goes to the one waiting ahead of the idle ones.
+  Release();
+  EXPECT_EQ(admitted_, static_cast<int>(G::kHttp1Limit) + 1);
+  EXPECT_EQ(idle_admitted_, static_cast<int>(throttle_.IdleLimit(kGw)));
+  Release();
+  EXPECT_EQ(idle_admitted_, static_cast<int>(throttle_.IdleLimit(kGw)) + 1);
+  EXPECT_EQ(throttle_.queued(kGw), 1UL);
+}
+
+TEST_F(GatewayThrottleTest, TokenBucketRefillsAtTheRate) {
+  throttle_.RecordProtocol(kGw, "h2");
+  // A bucket of kMinBurst, refilled every 5s
+  throttle_.SetRate(kGw, 12U);
+  for (auto i = 0; i < 20; ++i) {
+    Submit();
+  }
+  EXPECT_EQ(admitted_, static_cast<int>(G::kMinBurst)) << "A full bucket";
+  env_.FastForwardBy(base::Seconds(6));
+  EXPECT_EQ(admitted_, static_cast<int>(G::kMinBurst) + 1);
+}
+
+TEST_F(GatewayThrottleTest, TooManyRequestsPausesForRetryAfter) {
+  throttle_.RecordResponse(kGw, 429, base::Seconds(7));
+  EXPECT_TRUE(throttle_.paused(kGw));
+  Submit();
+  EXPECT_EQ(admitted_, 0);
+  env_.FastForwardBy(base::Seconds(7));
+  EXPECT_FALSE(throttle_.paused(kGw));
+  EXPECT_EQ(admitted_, 1);
+}
+
+TEST_F(GatewayThrottleTest, ParseRetryAfter) {
+  auto now = base::Time::Now();
+  EXPECT_EQ(G::ParseRetryAfter(" 7 ", now), base::Seconds(7));
+  EXPECT_EQ(G::ParseRetryAfter("", now), std::nullopt);
+  EXPECT_EQ(G::ParseRetryAfter("-1", now), std::nullopt);
+  EXPECT_EQ(G::ParseRetryAfter("soon", now), std::nullopt);
+  base::Time later;
+  ASSERT_TRUE(base::Time::FromUTCString("Wed, 21 Oct 2015 07:28:00 GMT",
+                                        &later));
+  EXPECT_EQ(G::ParseRetryAfter("Wed, 21 Oct 2015 07:28:00 GMT",
+                               later - base::Seconds(30)),
+            base::Seconds(30));
+}
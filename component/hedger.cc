@@ -0,0 +1,228 @@
+#include "hedger.h"
+
+#include "gateway_latencies.h"
+#include "gateway_throttle.h"
+
+#include <base/functional/bind.h>
+#include <base/logging.h>
+#include <base/task/sequenced_task_runner.h>
+
+#include <algorithm>
+
+using Self = ipfs::Hedger;
+
+Self::Hedger(GatewayLatencies const& latencies, double budget)
+    : latencies_{latencies}, budget_fraction_{std::max(budget, 0.0)} {}
+Self::~Hedger() noexcept = default;
+
+auto Self::Add(std::string const& target,
+               std::string const& gateway,
+               gw::GatewayRequestType type,
+               Launch launch,
+               OnComplete answer) -> Canceller {
+  auto& g = groups_[target];
+  auto id = next_id_++;
+  Member m;
+  m.id = id;
+  m.gateway = gateway;
+  m.type = type;
+  m.launch = std::move(launch);
+  m.answer = std::move(answer);
+  g.members.push_back(std::move(m));
+  if (!g.decided) {
+    if (g.members.size() == 1UL) {
+      // The scheduler fans out in a single pass; let it finish before
+      // picking, so every candidate gateway gets considered.
+      base::SequencedTaskRunner::GetCurrentDefault()->PostTask(
+          FROM_HERE, base::BindOnce(&Self::Decide, weak_factory_.GetWeakPtr(),
+                                    target));
+    }
+  } else if (!InFlight(g)) {
+    LaunchBest(target, g);
+  }
+  auto w = weak_factory_.GetWeakPtr();
+  return [w, target, id]() {
+    if (w) {
+      w->Cancel(target, id);
+    }
+  };
+}
+void Self::Decide(std::string target) {
+  auto it = groups_.find(target);
+  if (it == groups_.end() || it->second.decided) {
+    return;
+  }
+  it->second.decided = true;
+  if (LaunchBest(target, it->second)) {
+    primaries_++;
+    budget_ = std::min(budget_ + budget_fraction_, kMaxBudget);
+  }
+}
+bool Self::LaunchBest(std::string const& target, Group& g) {
+  auto best = g.members.end();
+  for (auto it = g.members.begin(); it != g.members.end(); ++it) {
+    if (it->state != State::Held) {
+      continue;
+    }
+    if (best == g.members.end() || Expected(*it) < Expected(*best)) {
+      best = it;
+    }
+  }
+  if (best == g.members.end()) {
+    return false;
+  }
+  best->state = State::Sent;
+  auto id = best->id;
+  auto w = weak_factory_.GetWeakPtr();
+  auto answer = std::move(best->answer);
+  auto done = [w, target, id, answer](auto status, auto body,
+                                      auto const& hdrs) {
+    if (w) {
+      w->Finished(target, id, status / 100 == 2);
+    }
+    answer(status, body, hdrs);
+  };
+  auto launch = std::move(best->launch);
+  // Launching may synchronously complete & mutate the group - copy out first.
+  auto gateway = best->gateway;
+  auto type = best->type;
+  auto cancel = launch(done);
+  auto git = groups_.find(target);
+  if (git == groups_.end()) {
+    return true;
+  }
+  for (auto& m : git->second.members) {
+    if (m.id == id) {
+      m.cancel = std::move(cancel);
+      Arm(target, git->second, gateway, type);
+      break;
+    }
+  }
+  return true;
+}
+void Self::Arm(std::string const& target,
+               Group& g,
+               std::string_view gateway,
+               gw::GatewayRequestType type) {
+  if (std::none_of(g.members.begin(), g.members.end(),
+                   [](auto& m) { return m.state == State::Held; })) {
+    return;
+  }
+  auto delay = kDefaultDelay;
+  if (auto p90 = latencies_->Percentile(gateway, type, 0.9)) {
+    delay = std::max(base::Milliseconds(*p90), kMinDelay);
+  }
+  if (!g.timer) {
+    g.timer = std::make_unique<base::OneShotTimer>();
+  }
+  g.timer->Start(FROM_HERE, delay,
+                 base::BindOnce(&Self::OnTimer, weak_factory_.GetWeakPtr(),
+                                target));
+}
+void Self::OnTimer(std::string target) {
+  auto it = groups_.find(target);
+  if (it == groups_.end()) {
+    return;
+  }
+  auto& g = it->second;
+  if (!InFlight(g)) {
+    LaunchBest(target, g);
+  } else if (budget_ >= 1.0) {
+    budget_ -= 1.0;
+    hedges_++;
+    VLOG(2) << "Hedging request for " << target;
+    LaunchBest(target, g);
+  } else {
+    VLOG(2) << "Hedge budget exhausted; still waiting on " << target;
+    for (auto& m : g.members) {
+      if (m.state == State::Sent) {
+        Arm(target, g, m.gateway, m.type);
+        break;
+      }
+    }
+  }
+}
+void Self::Finished(std::string const& target, std::size_t id, bool success) {
+  auto it = groups_.find(target);
+  if (it == groups_.end()) {
+    return;
+  }
+  auto& g = it->second;
+  std::erase_if(g.members, [id](auto& m) { return m.id == id; });
+  if (success) {
+    // The others were never sent, so they can't be answered with this: the
+    //   scheduler would credit gateways that were never asked. Copies of
+    //   the same request it cancels, now it has the content. Give it the
+    //   chance; whatever's left belongs to some other request.
+    if (!g.members.empty()) {
+      base::SequencedTaskRunner::GetCurrentDefault()->PostTask(
+          FROM_HERE, base::BindOnce(&Self::Resume, weak_factory_.GetWeakPtr(),
+                                    target));
+    }
+  } else if (!InFlight(g)) {
+    LaunchBest(target, g);
+  }
+  Tidy(target);
+}
+void Self::Resume(std::string target) {
+  auto it = groups_.find(target);
+  if (it != groups_.end() && !InFlight(it->second)) {
+    LaunchBest(target, it->second);
+  }
+}
+void Self::Cancel(std::string const& target, std::size_t id) {
+  auto it = groups_.find(target);
+  if (it == groups_.end()) {
+    return;
+  }
+  auto& ms = it->second.members;
+  auto m = std::find_if(ms.begin(), ms.end(),
+                        [id](auto& x) { return x.id == id; });
+  if (m == ms.end()) {
+    return;
+  }
+  auto cancel = std::move(m->cancel);
+  ms.erase(m);
+  if (cancel) {
+    cancel();
+  }
+  // Those still held mustn't be left waiting on a request that's gone.
+  if (auto again = groups_.find(target);
+      again != groups_.end() && again->second.decided &&
+      !InFlight(again->second)) {
+    LaunchBest(target, again->second);
+  }
+  Tidy(target);
+}
+void Self::Tidy(std::string const& target) {
+  auto it = groups_.find(target);
+  if (it != groups_.end() && it->second.members.empty()) {
+    groups_.erase(it);
+  }
+}
+std::size_t Self::InFlight(Group const& g) const {
+  return static_cast<std::size_t>(
+      std::count_if(g.members.begin(), g.members.end(),
+                    [](auto& m) { return m.state == State::Sent; }));
+}
+double Self::Expected(Member const& m) const {
+  return latencies_->ExpectedMillis(m.gateway, m.type)
+      .value_or(kDefaultDelay.InMillisecondsF());
+}
+std::string Self::Target(HttpRequestDescription const& desc) {
+  auto gw = GatewayThrottle::GatewayKey(desc.url);
+  std::string_view u{desc.url};
+  if (u.starts_with(gw)) {
+    u.remove_prefix(gw.size());
+  }
+  std::string result{u};
+  result.append(1, ' ').append(desc.accept);
+  return result;
+}
+
+Self::Member::Member() = default;
+Self::Member::Member(Member&&) = default;
+auto Self::Member::operator=(Member&&) -> Member& = default;
+Self::Member::~Member() noexcept = default;
+Self::Group::Group() = default;
+Self::Group::~Group() noexcept = default;
@@ -0,0 +1,130 @@
+#ifndef IPFS_HEDGER_H_
+#define IPFS_HEDGER_H_
+
+#include <ipfs_client/ctx/http_api.h>
+#include <ipfs_client/gw/gateway_request_type.h>
+
+#include <base/memory/raw_ref.h>
+#include <base/memory/weak_ptr.h>
+#include <base/time/time.h>
+#include <base/timer/timer.h>
+
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace ipfs {
+class GatewayLatencies;
+
+/*! Turns the scheduler's up-front fan-out into hedged requests.
+ *  \details The scheduler in ipfs_client races: it sends the same request to
+ *    several gateways at once and cancels the losers when one wins. Here,
+ *    identical requests (same path & Accept, different gateway) arriving
+ *    together form a group. Only the gateway expected to be fastest is
+ *    actually contacted. If it hasn't answered by its own p90 latency, the
+ *    next-best one is sent as a backup - as long as the global hedge budget
+ *    allows. A failure releases the next one immediately, free of charge.
+ *    When one succeeds, the ones never sent aren't answered with its
+ *    response: the scheduler would credit their gateways with it. They're
+ *    left for the scheduler to cancel, now it has the content. Any it
+ *    doesn't (they're some other request's) are then sent like the rest.
+ *    Every caller gets called back exactly once unless it cancels.
+ */
+class Hedger {
+ public:
+  using Canceller = ctx::HttpApi::Canceller;
+  using OnComplete = ctx::HttpApi::OnComplete;
+  /*! Actually sends the request, calling back with its result, and returns
+   *    how to cancel it
+   */
+  using Launch = std::function<Canceller(OnComplete)>;
+
+  /*! Wait this long for a gateway whose latency is unknown */
+  static constexpr base::TimeDelta kDefaultDelay = base::Seconds(1);
+  /*! Don't hedge sooner than this, whatever the stats say */
+  static constexpr base::TimeDelta kMinDelay = base::Milliseconds(20);
+  /*! How many hedges may be saved up for a burst */
+  static constexpr double kMaxBudget = 10.0;
+
+  /*! \param latencies Used to order gateways & decide when to hedge
+   *  \param budget Fraction of extra requests allowed, e.g. 0.1 for 10%
+   */
+  Hedger(GatewayLatencies const& latencies, double budget);
+  ~Hedger() noexcept;
+
+  Hedger(Hedger const&) = delete;
+  Hedger& operator=(Hedger const&) = delete;
+
+  /*! \brief Add a request to the group for its target
+   *  \param target Identifies the content, i.e. the URL less the gateway
+   *  \param gateway \see GatewayThrottle::GatewayKey
+   *  \param answer Called with this request's response, once it's sent
+   *  \return Cancels the request, whether sent or held
+   */
+  Canceller Add(std::string const& target,
+                std::string const& gateway,
+                gw::GatewayRequestType,
+                Launch,
+                OnComplete answer);
+
+  /*! \return The portion of a request URL identifying what is requested */
+  static std::string Target(HttpRequestDescription const&);
+
+  std::size_t primaries() const { return primaries_; }
+  std::size_t hedges() const { return hedges_; }
+
+ private:
+  enum class State { Held, Sent };
+  struct Member {
+    Member();
+    Member(Member&&);
+    Member& operator=(Member&&);
+    ~Member() noexcept;
+    std::size_t id;
+    std::string gateway;
+    gw::GatewayRequestType type;
+    State state = State::Held;
+    Launch launch;
+    OnComplete answer;
+    Canceller cancel;
+  };
+  struct Group {
+    Group();
+    ~Group() noexcept;
+    std::vector<Member> members;
+    bool decided = false;
+    std::unique_ptr<base::OneShotTimer> timer;
+  };
+  raw_ref<GatewayLatencies const> latencies_;
+  double budget_fraction_;
+  double budget_ = kMaxBudget / 2.0;
+  std::size_t next_id_ = 1UL;
+  std::size_t primaries_ = 0UL;
+  std::size_t hedges_ = 0UL;
+  std::map<std::string, Group> groups_;
+  base::WeakPtrFactory<Hedger> weak_factory_{this};
+
+  void Decide(std::string target);
+  void OnTimer(std::string target);
+  void Finished(std::string const& target, std::size_t id, bool success);
+  /*! After a success, send whatever the scheduler didn't cancel */
+  void Resume(std::string target);
+  void Cancel(std::string const& target, std::size_t id);
+
+  /*! \return Whether something was sent */
+  bool LaunchBest(std::string const& target, Group&);
+  /*! Wait for the p90 of the most recently sent, then consider a hedge */
+  void Arm(std::string const& target,
+           Group&,
+           std::string_view gateway,
+           gw::GatewayRequestType);
+  std::size_t InFlight(Group const&) const;
+  double Expected(Member const&) const;
+  void Tidy(std::string const& target);
+};
+}  // namespace ipfs
+
+#endif  // IPFS_HEDGER_H_
@@ -0,0 +1,97 @@
+#include "hedger.h"
+
+#include "gateway_latencies.h"
+
+#include <base/run_loop.h>
+#include <base/test/task_environment.h>
+
+#include <gtest/gtest.h>
+
+#include <map>
+#include <string>
+#include <vector>
+
+using H = ipfs::Hedger;
+
+namespace {
+constexpr char kTarget[] =
+    "/ipfs/bafkreigh2akiscaildcqabsyg3dfr6chu3fgpregiymsck7e7aqa4s52zy "
+    "application/vnd.ipld.raw";
+
+class HedgerTest : public testing::Test {
+ protected:
+  /*! One of the scheduler's copies, bound for gateway */
+  H::Canceller Add(std::string const& gateway) {
+    auto launch = [this, gateway](H::OnComplete done) -> H::Canceller {
+      sent_.push_back(gateway);
+      pending_[gateway] = std::move(done);
+      return [this, gateway]() { pending_.erase(gateway); };
+    };
+    auto answer = [this, gateway](auto status, auto, auto const&) {
+      answered_[gateway] = status;
+    };
+    return hedger_.Add(kTarget, gateway, ipfs::gw::GatewayRequestType::Block,
+                       launch, answer);
+  }
+  /*! The gateway responds */
+  void Respond(std::string const& gateway, int status) {
+    auto done = std::move(pending_.at(gateway));
+    pending_.erase(gateway);
+    done(status, "", [](auto) { return std::string{}; });
+  }
+  void Settle() { base::RunLoop().RunUntilIdle(); }
+
+  base::test::TaskEnvironment env_{
+      base::test::TaskEnvironment::TimeSource::MOCK_TIME};
+  ipfs::GatewayLatencies latencies_;
+  H hedger_{latencies_, 0.1};
+  std::vector<std::string> sent_;
+  std::map<std::string, H::OnComplete> pending_;
+  std::map<std::string, int> answered_;
+};
+}  // namespace
+
+TEST_F(HedgerTest, SendsOneThenHedges) {
+  for (auto gw : {"https://a.example/", "https://b.example/",
+                  "https://c.example/"}) {
+    Add(gw);
+  }
+  Settle();
+  ASSERT_EQ(sent_.size(), 1UL);
+  env_.FastForwardBy(H::kDefaultDelay);
+  EXPECT_EQ(sent_.size(), 2UL);
+  EXPECT_EQ(hedger_.hedges(), 1UL);
+}
+
+TEST_F(HedgerTest, FailureReleasesTheNext) {
+  Add("https://a.example/");
+  Add("https://b.example/");
+  Settle();
+  ASSERT_EQ(sent_.size(), 1UL);
+  Respond(sent_.front(), 504);
+  EXPECT_EQ(answered_.at(sent_.front()), 504);
+  ASSERT_EQ(sent_.size(), 2UL);
+  EXPECT_NE(sent_.back(), sent_.front());
+  EXPECT_EQ(hedger_.hedges(), 0UL);
+}
+
+TEST_F(HedgerTest, SuccessIsOnlyCreditedToTheGatewayAsked) {
+  // Nothing is known about any of them, so the first added goes first.
+  Add("https://a.example/");
+  auto cancel_b = Add("https://b.example/");
+  Add("https://c.example/");
+  Settle();
+  ASSERT_EQ(sent_, std::vector<std::string>{"https://a.example/"});
+  Respond("https://a.example/", 200);
+  EXPECT_EQ(answered_.size(), 1UL) << "Not on behalf of those never sent";
+  EXPECT_EQ(answered_.at("https://a.example/"), 200);
+  // The scheduler cancels its own copy now it has the block. The other is
+  //   some other request's, and goes to its own gateway.
+  cancel_b();
+  Settle();
+  ASSERT_EQ(sent_.size(), 2UL);
+  EXPECT_EQ(sent_.back(), "https://c.example/");
+  Respond("https://c.example/", 200);
+  EXPECT_EQ(answered_.at("https://c.example/"), 200);
+  EXPECT_FALSE(answered_.contains("https://b.example/"));
+}
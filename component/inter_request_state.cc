@@ -1,11 +1,14 @@
 #include "inter_request_state.h"
 
+#include "chromium_http.h"
 #include "chromium_ipfs_context.h"
-#include "json_parser_adapter.h"
 #include "preferences.h"
 
 #include <base/logging.h>
+#include <base/task/task_traits.h>
+#include <base/timer/timer.h>
 #include <content/public/browser/browser_context.h>
+#include <content/public/browser/browser_thread.h>
 #include <content/browser/child_process_security_policy_impl.h>
 #include <third_party/blink/renderer/platform/weborigin/scheme_registry.h>
 
@@ -18,6 +21,13 @@ using Self = ipfs::InterRequestState;
 
 namespace {
 constexpr char user_data_key[] = "ipfs_request_userdata";
+std::unique_ptr<ipfs::Hedger> MakeHedger(ipfs::GatewayLatencies const& lat,
+                                         PrefService const* prefs) {
+  if (auto budget = ipfs::HedgeBudgetPref(prefs)) {
+    return std::make_unique<ipfs::Hedger>(lat, *budget);
+  }
+  return {};
+}
 }
 
 void Self::CreateForBrowserContext(content::BrowserContext* c, PrefService* p) {
@@ -70,15 +80,64 @@ auto Self::orchestrator() -> Partition& {
   // TODO - use origin
   return *api()->partition({});
 }
+base::OnceClosure Self::LaunchPrefetch(std::string const& root,
+                                       Prefetcher::Done done) {
+  if (!http_loader_factory_) {
+    // Set when the profile is initialized; this is before that.
+    return {};
+  }
+  api()->with(std::make_unique<ChromiumHttp>(*http_loader_factory_, *this));
+  auto done_once = std::make_shared<Prefetcher::Done>(std::move(done));
+  auto whendone = [done_once](IpfsRequest const&, Response const&) {
+    if (*done_once) {
+      std::move(*done_once).Run();
+    }
+  };
+  auto req = std::make_shared<IpfsRequest>(root, whendone);
+  // Stepped like IpfsUrlLoader steps a navigation, but what it sends mustn't
+  //   compete with one.
+  auto* orc = &orchestrator();
+  auto step = [](InterRequestState* s, Partition* o,
+                 std::shared_ptr<IpfsRequest> r) {
+    auto idle = s->SendingAt(net::IDLE);
+    o->build_response(r);
+  };
+  auto stepper = std::make_unique<base::RepeatingTimer>();
+  // Unretained: the prefetcher, and so the stepper, belong to this.
+  stepper->Start(FROM_HERE, base::Seconds(2),
+                 base::BindRepeating(step, base::Unretained(this),
+                                     base::Unretained(orc), req));
+  step(this, orc, req);
+  // Dropping the stepper (& with it the request) is what stops it.
+  return base::BindOnce([](std::unique_ptr<base::RepeatingTimer>) {},
+                        std::move(stepper));
+}
 void Self::network_context(network::mojom::NetworkContext* val) {
   network_context_ = val;
 }
 network::mojom::NetworkContext* Self::network_context() const {
   return network_context_;
 }
+void Self::http_loader_factory(network::mojom::URLLoaderFactory* val) {
+  http_loader_factory_ = val;
+}
+network::mojom::URLLoaderFactory* Self::http_loader_factory() const {
+  return http_loader_factory_;
+}
+auto Self::SendingAt(net::RequestPriority p)
+    -> base::AutoReset<net::RequestPriority> {
+  return base::AutoReset<net::RequestPriority>{&http_priority_, p};
+}
 Self::InterRequestState(base::FilePath p, PrefService* prefs)
-    : api_{CreateContext(*this, prefs)}, disk_path_{p} {
-  api_->with(std::make_unique<JsonParserAdapter>());
+    : dns_txt_cache_{p},
+      hedger_{MakeHedger(latencies_, prefs)},
+      disk_path_{p},
+      api_{CreateContext(*this, prefs)},
+      prefetcher_{[this](std::string const& root, Prefetcher::Done done) {
+                    return LaunchPrefetch(root, std::move(done));
+                  },
+                  content::GetUIThreadTaskRunner(
+                      {base::TaskPriority::BEST_EFFORT})} {
   DCHECK(prefs);
 
   // Boot the XyzOnion service eagerly — it takes 10s–2min to become ready,
@@ -90,10 +149,12 @@ Self::InterRequestState(base::FilePath p, PrefService* prefs)
   xyz_domain_patch_ = std::make_unique<XyzDomainPatch>(xyz_onion_.get());
 }
 Self::~InterRequestState() noexcept {
+  prefetcher_.CancelAll();
   // Tear down observers before the service they observe.
   xyz_domain_patch_.reset();
   xyz_onion_.reset();
   network_context_ = nullptr;
+  http_loader_factory_ = nullptr;
   cache_.reset();
 }
 ipfs::XyzOnion& Self::xyz_onion() {
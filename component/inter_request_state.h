@@ -1,8 +1,16 @@
 #ifndef IPFS_INTER_REQUEST_STATE_H_
 #define IPFS_INTER_REQUEST_STATE_H_
 
+#include "affinity_bandit.h"
 #include "cache_requestor.h"
+#include "car_batcher.h"
+#include "circuit_breaker.h"
+#include "dns_txt_cache.h"
 #include "export.h"
+#include "gateway_latencies.h"
+#include "gateway_throttle.h"
+#include "hedger.h"
+#include "prefetcher.h"
 #include "xyz_domain_patch.h"
 #include "xyz_onion.h"
 
@@ -10,7 +18,9 @@
 #include "ipfs_client/ipns_names.h"
 #include "ipfs_client/partition.h"
 
+#include "base/auto_reset.h"
 #include "base/supports_user_data.h"
+#include "net/base/request_priority.h"
 #include "services/network/network_context.h"
 
 class PrefService;
@@ -24,26 +34,60 @@ class Scheduler;
 class COMPONENT_EXPORT(IPFS) InterRequestState
     : public base::SupportsUserData::Data {
   IpnsNames names_;
+  DnsTxtCache dns_txt_cache_;
+  GatewayThrottle throttle_;
+  GatewayLatencies latencies_;
+  CircuitBreaker breaker_;
+  AffinityBandit bandit_;
+  CarBatcher batcher_;
+  std::unique_ptr<Hedger> hedger_;
+  base::FilePath const disk_path_;
   std::shared_ptr<Client> api_;
   std::shared_ptr<CacheRequestor> cache_;
-  base::FilePath const disk_path_;
   raw_ptr<network::mojom::NetworkContext> network_context_;
+  raw_ptr<network::mojom::URLLoaderFactory> http_loader_factory_;
+  net::RequestPriority http_priority_ = net::HIGHEST;
   std::unique_ptr<XyzOnion> xyz_onion_;
   std::unique_ptr<XyzDomainPatch> xyz_domain_patch_;
+  Prefetcher prefetcher_;
 
   std::shared_ptr<CacheRequestor>& cache();
+  base::OnceClosure LaunchPrefetch(std::string const& root, Prefetcher::Done);
 
  public:
   InterRequestState(base::FilePath, PrefService*);
   ~InterRequestState() noexcept override;
 
   IpnsNames& names() { return names_; }
+  DnsTxtCache& dns_txt_cache() { return dns_txt_cache_; }
+  GatewayThrottle& gateway_throttle() { return throttle_; }
+  GatewayLatencies& gateway_latencies() { return latencies_; }
+  CircuitBreaker& circuit_breaker() { return breaker_; }
+  AffinityBandit& affinity_bandit() { return bandit_; }
+  CarBatcher& car_batcher() { return batcher_; }
+  /*! Warms caches for likely navigations; fed by IpfsOmniboxPrefetch */
+  Prefetcher& prefetcher() { return prefetcher_; }
+  /*! \return nullptr if hedging is disabled */
+  Hedger* hedger() { return hedger_.get(); }
+  /*! \return The profile's directory */
+  base::FilePath const& disk_path() const { return disk_path_; }
   Scheduler& scheduler();
   std::shared_ptr<Client> api();
   std::array<std::shared_ptr<CacheRequestor>,2> serialized_caches();
   Partition& orchestrator();
   void network_context(network::mojom::NetworkContext*);
   network::mojom::NetworkContext* network_context() const;
+  /*! For requests this component makes itself, e.g. DNS-over-HTTPS */
+  void http_loader_factory(network::mojom::URLLoaderFactory*);
+  network::mojom::URLLoaderFactory* http_loader_factory() const;
+  /*! Priority for HTTP requests sent now (\see SendingAt) */
+  net::RequestPriority http_priority() const { return http_priority_; }
+  /*! \brief Send HTTP requests at a priority until the result goes away
+   *  \details e.g. net::IDLE while a prefetch is being stepped. Requests
+   *    that follow from their responses inherit it, \see ChromiumHttp.
+   */
+  [[nodiscard]] base::AutoReset<net::RequestPriority> SendingAt(
+      net::RequestPriority);
 
   XyzOnion& xyz_onion();
   XyzDomainPatch& xyz_domain_patch();
@@ -21,6 +21,7 @@ void Interceptor::MaybeCreateLoader(network::ResourceRequest const& req,
                                     LoaderCallback loader_callback) {
   auto& state = InterRequestState::FromBrowserContext(context);
   state.network_context(network_context_);
+  state.http_loader_factory(loader_factory_);
   if (XyzDomainPatch::IsXyzDomain(req.url.host()) ||
       XyzDomainPatch::IsOnionDomain(req.url.host())) {
     state.xyz_domain_patch().OnXyzFetch(req.url.spec());
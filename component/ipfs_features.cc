@@ -3,5 +3,11 @@
 namespace ipfs {
 
 BASE_FEATURE(kEnableIpfs, "EnableIpfs", base::FEATURE_DISABLED_BY_DEFAULT);
+BASE_FEATURE(kLazyDagCbor,
+             "IpfsLazyDagCbor",
+             base::FEATURE_DISABLED_BY_DEFAULT);
+BASE_FEATURE(kStructuralJson,
+             "IpfsStructuralJson",
+             base::FEATURE_DISABLED_BY_DEFAULT);
 
 }
@@ -7,6 +7,10 @@
 namespace ipfs {
 
 COMPONENT_EXPORT(IPFS) BASE_DECLARE_FEATURE(kEnableIpfs);
+/*! Parse DAG-CBOR with LazyCborAdapter instead of ChromiumCborAdapter */
+COMPONENT_EXPORT(IPFS) BASE_DECLARE_FEATURE(kLazyDagCbor);
+/*! Parse JSON with StructuralJsonParser instead of JsonParserAdapter */
+COMPONENT_EXPORT(IPFS) BASE_DECLARE_FEATURE(kStructuralJson);
 
 }  // namespace ipfs
 
@@ -8,15 +8,20 @@
 #include "ipfs_client/ipfs_request.h"
 #include "ipfs_client/ipld/dag_headers.h"
 
-#include "base/check_version_internal.h"
+#include "base/containers/lru_cache.h"
 #include "base/debug/stack_trace.h"
+#include "base/no_destructor.h"
 #include "base/notimplemented.h"
 #include "base/notreached.h"
+#include "base/strings/string_util.h"
 #include "base/strings/stringprintf.h"
+#include "base/synchronization/lock.h"
 #include "base/task/bind_post_task.h"
 #include "base/task/thread_pool.h"
 #include "base/threading/platform_thread.h"
 #include "content/public/browser/browser_thread.h"
+#include "mojo/public/cpp/system/data_pipe_producer.h"
+#include "mojo/public/cpp/system/string_data_source.h"
 #include "net/http/http_status_code.h"
 #include "services/network/public/cpp/parsed_headers.h"
 #include "services/network/public/cpp/simple_url_loader.h"
@@ -24,20 +29,13 @@
 #include "services/network/public/mojom/url_response_head.mojom.h"
 #include "services/network/url_loader_factory.h"
 
+#include <algorithm>
 #include <fstream>
 
-#if BASE_CHECK_VERSION_INTERNAL < 125
-using PipeByteCount = uint32_t;
-#define SPAN_ARG 0
-#elif BASE_CHECK_VERSION_INTERNAL < 128
-using PipeByteCount = size_t;
-#define SPAN_ARG 0
-#else
-using PipeByteCount = size_t;
-#define SPAN_ARG 1
-#endif
-
 namespace {
+    /*! Bodies bigger than this go through the pipe in pieces, as it drains */
+    constexpr std::size_t kMaxPipeCapacity = 2UL * 1024UL * 1024UL;
+
     template<class T>
     concept OptionalGetHeader = requires(T& t,std::string_view k) {
         { t.GetHeader(k) } -> std::same_as<std::optional<std::string>>;
@@ -53,6 +51,87 @@ namespace {
         }
         return std::nullopt;
     }
+    /*!
+     * \brief Response headers, and their parsed form, by what they're made of
+     * \details Pages with many ipfs:// subresources would otherwise build,
+     *    edit & parse the same headers again for each one. Each response gets
+     *    its own HttpResponseHeaders, re-read from the already-normalized raw
+     *    form, and a clone of the parsed headers.
+     */
+    class HeadTemplates {
+     public:
+      static constexpr std::size_t kMaxEntries = 256UL;
+
+      /*! Headers whose parsing resolves URLs against the response's own */
+      static bool UrlDependent(std::string_view name) {
+        constexpr std::string_view kNames[] = {
+            "content-security-policy", "content-security-policy-report-only",
+            "link", "reporting-endpoints"};
+        for (auto n : kNames) {
+          if (base::EqualsCaseInsensitiveASCII(name, n)) {
+            return true;
+          }
+        }
+        return false;
+      }
+      static std::string Key(int status,
+                             std::string const& mime_type,
+                             std::string const& location,
+                             GURL const& url,
+                             ipfs::ipld::DagHeaders const& hdrs) {
+        auto rv = base::StringPrintf("%d\n%s\n%s\n", status, mime_type.c_str(),
+                                     location.c_str());
+        auto whole_url = false;
+        for (auto& [n, v] : hdrs.headers()) {
+          rv.append(n).append(": ").append(v).append("\n");
+          whole_url = whole_url || UrlDependent(n);
+        }
+        // Otherwise only the origin matters, e.g. as CSP's 'self'.
+        return rv + (whole_url ? url.spec() : url.GetWithEmptyPath().spec());
+      }
+      /*! \return false if there's no template for key */
+      bool Fill(std::string const& key, network::mojom::URLResponseHead& head) {
+        base::AutoLock lock{lock_};
+        auto it = memo_.Get(key);
+        if (it == memo_.end()) {
+          return false;
+        }
+        head.headers =
+            base::MakeRefCounted<net::HttpResponseHeaders>(it->second.raw);
+        head.parsed_headers = it->second.parsed.Clone();
+        return true;
+      }
+      void Put(std::string key, network::mojom::URLResponseHead const& head) {
+        Template t{head.headers->raw_headers(), head.parsed_headers.Clone()};
+        base::AutoLock lock{lock_};
+        memo_.Put(std::move(key), std::move(t));
+      }
+
+     private:
+      struct Template {
+        std::string raw;
+        network::mojom::ParsedHeadersPtr parsed;
+      };
+      base::Lock lock_;
+      base::HashingLRUCache<std::string, Template> memo_{kMaxEntries};
+    };
+    /*! Write all of body into producer, then let both go */
+    void StreamBody(mojo::ScopedDataPipeProducerHandle producer,
+                    std::unique_ptr<std::string> body) {
+      using Source = mojo::StringDataSource;
+      auto writer = std::make_unique<mojo::DataPipeProducer>(std::move(producer));
+      auto* raw = writer.get();
+      auto source = std::make_unique<Source>(
+          *body, Source::AsyncWritingMode::STRING_STAYS_VALID_UNTIL_COMPLETION);
+      auto done = [](std::unique_ptr<mojo::DataPipeProducer>,
+                     std::unique_ptr<std::string>, MojoResult result) {
+        if (result != MOJO_RESULT_OK) {
+          VLOG(1) << "Response body cut short: " << result;
+        }
+      };
+      raw->Write(std::move(source),
+                 base::BindOnce(done, std::move(writer), std::move(body)));
+    }
 }
 
 ipfs::IpfsUrlLoader::IpfsUrlLoader(
@@ -108,8 +187,8 @@ void ipfs::IpfsUrlLoader::StartRequest(
             .append(path)
             ;
     me->root_ = cid_str;
-    me->api_->with(
-        std::make_unique<ChromiumHttp>(*(me->lower_loader_factory_)));
+    me->api_->with(std::make_unique<ChromiumHttp>(*(me->lower_loader_factory_),
+                                                  *(me->state_)));
     auto whendone = [me](IpfsRequest const& req, ipfs::Response const& res) {
       if (!res.body_.empty()) {
         me->ReceiveBlockBytes(res.body_);
@@ -149,57 +228,58 @@ void ipfs::IpfsUrlLoader::BlocksComplete(std::string mime_type,
   if (complete_) {
     return;
   }
-  auto result =
-      mojo::CreateDataPipe(partial_block_.size(), pipe_prod_, pipe_cons_);
+  // The head goes out with the pipe, and the body follows as it drains,
+  //   rather than needing a pipe the whole body fits in up front.
+  auto result = mojo::CreateDataPipe(
+      std::min(partial_block_.size(), kMaxPipeCapacity), pipe_prod_,
+      pipe_cons_);
   if (result) {
     LOG(ERROR) << " ERROR: TaskFailed to create data pipe: " << result;
     return;
   }
+  auto body = std::make_unique<std::string>(std::move(partial_block_));
   complete_ = true;
   auto head = network::mojom::URLResponseHead::New();
   if (mime_type.size()) {
     head->mime_type = mime_type;
   }
-  auto byte_count = static_cast<PipeByteCount>(partial_block_.size());
-#if SPAN_ARG
-  pipe_prod_->WriteData(ipfs::as_octets(partial_block_),
-                        MOJO_BEGIN_WRITE_DATA_FLAG_ALL_OR_NONE,
-                        byte_count);
-#else
-  pipe_prod_->WriteData(partial_block_.data(), &byte_count,
-                        MOJO_BEGIN_WRITE_DATA_FLAG_ALL_OR_NONE);
-#endif
-  head->content_length = byte_count;
-  head->headers =
-      net::HttpResponseHeaders::TryToCreate("access-control-allow-origin: *");
-  if (!head->headers) {
-    LOG(ERROR) << "\n\tFailed to create headers!\n";
-    return;
-  }
-  auto* reason =
-      net::GetHttpReasonPhrase(static_cast<net::HttpStatusCode>(status_));
-  auto status_line = base::StringPrintf("HTTP/1.1 %d %s", status_, reason);
-  head->headers->ReplaceStatusLine(status_line);
-  if (mime_type.size()) {
-    head->headers->SetHeader("Content-Type", mime_type);
-  }
-  head->headers->SetHeader("Access-Control-Allow-Origin", "*");
-  head->was_fetched_via_spdy = false;
+  head->content_length = static_cast<int64_t>(body->size());
+  GURL url{original_url_};
+  static base::NoDestructor<HeadTemplates> templates;
+  auto key = HeadTemplates::Key(status_, mime_type, resp_loc_, url, hdrs);
+  if (!templates->Fill(key, *head)) {
+    head->headers =
+        net::HttpResponseHeaders::TryToCreate("access-control-allow-origin: *");
+    if (!head->headers) {
+      LOG(ERROR) << "\n\tFailed to create headers!\n";
+      return;
+    }
+    auto* reason =
+        net::GetHttpReasonPhrase(static_cast<net::HttpStatusCode>(status_));
+    auto status_line = base::StringPrintf("HTTP/1.1 %d %s", status_, reason);
+    head->headers->ReplaceStatusLine(status_line);
+    if (mime_type.size()) {
+      head->headers->SetHeader("Content-Type", mime_type);
+    }
+    head->headers->SetHeader("Access-Control-Allow-Origin", "*");
 
-  for (auto& [n, v] : hdrs.headers()) {
-    head->headers->AddHeader(n, v);
-  }
-  if (resp_loc_.size()) {
-    head->headers->AddHeader("Location", resp_loc_);
-    VLOG(2) << "Sending response for " << original_url_ << " with mime type "
-            << head->mime_type << " and status line '" << status_line
-            << "' @location '" << resp_loc_ << "'";
+    for (auto& [n, v] : hdrs.headers()) {
+      head->headers->AddHeader(n, v);
+    }
+    if (resp_loc_.size()) {
+      head->headers->AddHeader("Location", resp_loc_);
+      VLOG(2) << "Sending response for " << original_url_ << " with mime type "
+              << head->mime_type << " and status line '" << status_line
+              << "' @location '" << resp_loc_ << "'";
+    }
+    head->parsed_headers =
+        network::PopulateParsedHeaders(head->headers.get(), url);
+    templates->Put(std::move(key), *head);
   }
-  head->parsed_headers =
-      network::PopulateParsedHeaders(head->headers.get(), GURL{original_url_});
+  head->was_fetched_via_spdy = false;
   if (status_ / 100 == 3 && resp_loc_.size()) {
     auto ri = net::RedirectInfo::ComputeRedirectInfo(
-        "GET", GURL{original_url_}, net::SiteForCookies{},
+        "GET", url, net::SiteForCookies{},
         net::RedirectInfo::FirstPartyURLPolicy::UPDATE_URL_ON_REDIRECT,
         net::ReferrerPolicy::NO_REFERRER,
         "", //original_referrer
@@ -209,6 +289,7 @@ void ipfs::IpfsUrlLoader::BlocksComplete(std::string mime_type,
   } else {
     client_->OnReceiveResponse(std::move(head), std::move(pipe_cons_),
                                absl::nullopt);
+    StreamBody(std::move(pipe_prod_), std::move(body));
   }
   client_->OnComplete(network::URLLoaderCompletionStatus{});
   if (stepper_) {
@@ -0,0 +1,83 @@
+#include "latency_sketch.h"
+
+#include <algorithm>
+#include <cmath>
+
+using Self = ipfs::LatencySketch;
+
+ipfs::Ewma::Ewma(double alpha) : alpha_{alpha} {}
+void ipfs::Ewma::Add(double sample) {
+  if (value_) {
+    value_ = alpha_ * sample + (1.0 - alpha_) * value_.value();
+  } else {
+    value_ = sample;
+  }
+}
+
+void Self::Add(double millis) {
+  counts_[BucketOf(millis)]++;
+  if (++total_ >= kDecayAt) {
+    total_ = 0U;
+    for (auto& c : counts_) {
+      c /= 2U;
+      total_ += c;
+    }
+  }
+}
+std::optional<double> Self::Quantile(double q) const {
+  if (!total_) {
+    return std::nullopt;
+  }
+  auto target = std::clamp(q, 0.0, 1.0) * total_;
+  double seen = 0.0;
+  for (auto i = 0UL; i < kBuckets; ++i) {
+    if (!counts_[i]) {
+      continue;
+    }
+    if (seen + counts_[i] >= target) {
+      // Interpolate geometrically within the bucket.
+      auto frac = (target - seen) / counts_[i];
+      auto lo = i ? UpperBound(i - 1UL) : 1.0;
+      auto hi = UpperBound(i);
+      return lo * std::pow(hi / lo, frac);
+    }
+    seen += counts_[i];
+  }
+  return UpperBound(kBuckets - 1UL);
+}
+std::size_t Self::BucketOf(double millis) {
+  if (!(millis > 1.0)) {
+    return 0UL;
+  }
+  auto b = std::ceil(2.0 * std::log2(millis)) - 1.0;
+  return static_cast<std::size_t>(
+      std::clamp(b, 0.0, static_cast<double>(kBuckets - 1UL)));
+}
+double Self::UpperBound(std::size_t bucket) {
+  return std::exp2((static_cast<double>(bucket) + 1.0) / 2.0);
+}
+base::Value::List Self::ToList() const {
+  base::Value::List l;
+  // Trailing zeros are common (nobody takes 10 seconds) - drop them.
+  auto end = kBuckets;
+  while (end && !counts_[end - 1UL]) {
+    --end;
+  }
+  for (auto i = 0UL; i < end; ++i) {
+    l.Append(static_cast<int>(counts_[i]));
+  }
+  return l;
+}
+Self Self::FromList(base::Value::List const* l) {
+  Self result;
+  if (!l) {
+    return result;
+  }
+  auto n = std::min(l->size(), kBuckets);
+  for (auto i = 0UL; i < n; ++i) {
+    auto c = (*l)[i].GetIfInt().value_or(0);
+    result.counts_[i] = static_cast<std::uint32_t>(std::max(c, 0));
+    result.total_ += result.counts_[i];
+  }
+  return result;
+}
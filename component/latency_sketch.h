@@ -0,0 +1,57 @@
+#ifndef IPFS_LATENCY_SKETCH_H_
+#define IPFS_LATENCY_SKETCH_H_
+
+#include <base/values.h>
+
+#include <array>
+#include <cstdint>
+#include <optional>
+
+namespace ipfs {
+
+/*! Exponentially-weighted moving average
+ */
+class Ewma {
+  std::optional<double> value_;
+  double alpha_;
+
+ public:
+  explicit Ewma(double alpha = 0.2);
+  void Add(double sample);
+  std::optional<double> value() const { return value_; }
+  void value(double v) { value_ = v; }
+};
+
+/*! A compact, mergeable-enough quantile estimate for latencies.
+ *  \details Log-spaced buckets, each sqrt(2) wider than the last, from
+ *    ~1.4ms to ~11.6s plus an overflow bucket. Counts are halved once the
+ *    total gets large, so old observations fade out and the whole thing
+ *    stays small enough to live in preferences as a short list of ints.
+ *    Resolution is +/- ~20%, which is plenty to tell gateways apart.
+ */
+class LatencySketch {
+ public:
+  static constexpr std::size_t kBuckets = 28UL;
+  static constexpr std::uint32_t kDecayAt = 512U;
+
+  void Add(double millis);
+
+  /*! \param q in [0,1], e.g. 0.9 for p90
+   *  \return Estimated latency in milliseconds, or nullopt if empty
+   */
+  std::optional<double> Quantile(double q) const;
+  std::uint32_t count() const { return total_; }
+
+  base::Value::List ToList() const;
+  static LatencySketch FromList(base::Value::List const*);
+
+ private:
+  std::array<std::uint32_t, kBuckets> counts_ = {};
+  std::uint32_t total_ = 0U;
+
+  static std::size_t BucketOf(double millis);
+  static double UpperBound(std::size_t bucket);
+};
+}  // namespace ipfs
+
+#endif  // IPFS_LATENCY_SKETCH_H_
@@ -0,0 +1,303 @@
+#include "lazy_cbor_adapter.h"
+
+#include <base/logging.h>
+#include <base/memory/ptr_util.h>
+
+#include <algorithm>
+#include <bit>
+#include <limits>
+#include <vector>
+
+using Self = ipfs::LazyCborAdapter;
+
+namespace {
+enum Major : std::uint8_t {
+  kUnsigned = 0,
+  kNegative = 1,
+  kBytes = 2,
+  kText = 3,
+  kArray = 4,
+  kMap = 5,
+  kTag = 6,  // Only ever 42, and then it's the tagged byte string
+  kSimple = 7,
+};
+constexpr std::uint64_t kLinkTag = 42U;
+constexpr std::uint8_t kFalse = 20U;
+constexpr std::uint8_t kTrue = 21U;
+constexpr std::uint8_t kUndefined = 23U;
+constexpr std::uint8_t kFloat64 = 27U;
+
+struct Item {
+  std::uint64_t arg;     ///< Value; length; entries; or a float's bits
+  std::uint32_t offset;  ///< Of the payload, past header (and tag)
+  std::uint32_t next;    ///< Index of the first item after this subtree
+  std::uint8_t major;
+  std::uint8_t info;  ///< Additional info from the initial byte
+};
+struct Open {
+  std::uint32_t item;
+  std::uint64_t remaining;  ///< Children still to come, keys included
+  bool map;
+};
+
+/*! \return The argument of the header at bytes[pos], moving pos past it */
+std::optional<std::uint64_t> Argument(ipfs::ByteView bytes,
+                                      std::size_t& pos,
+                                      std::uint8_t info) {
+  if (info < 24U) {
+    return info;
+  }
+  if (info > 27U) {
+    // 28-30 reserved, 31 indefinite length: neither is DAG-CBOR.
+    return std::nullopt;
+  }
+  auto len = std::size_t{1} << (info - 24U);
+  if (bytes.size() - pos < len) {
+    return std::nullopt;
+  }
+  std::uint64_t rv = 0U;
+  for (auto i = 0UL; i < len; ++i) {
+    rv = (rv << 8) | std::to_integer<std::uint64_t>(bytes[pos++]);
+  }
+  return rv;
+}
+}  // namespace
+
+struct Self::Block {
+  std::vector<std::byte> bytes;
+  std::vector<Item> items;
+
+  /*! \brief Index bytes (already copied in)
+   *  \return false if malformed
+   */
+  bool Index();
+};
+
+bool Self::Block::Index() {
+  ByteView b{bytes.data(), bytes.size()};
+  if (b.size() > std::numeric_limits<std::uint32_t>::max()) {
+    return false;
+  }
+  std::vector<Open> open;
+  std::size_t pos = 0UL;
+  do {
+    if (pos >= b.size()) {
+      return false;
+    }
+    auto initial = std::to_integer<std::uint8_t>(b[pos++]);
+    Item it;
+    it.major = initial >> 5;
+    it.info = initial & 0x1FU;
+    auto arg = Argument(b, pos, it.info);
+    if (!arg) {
+      return false;
+    }
+    it.arg = *arg;
+    if (it.major == kTag) {
+      if (it.arg != kLinkTag || pos >= b.size()) {
+        return false;
+      }
+      // The link's byte string becomes this item.
+      initial = std::to_integer<std::uint8_t>(b[pos++]);
+      it.info = initial & 0x1FU;
+      arg = Argument(b, pos, it.info);
+      // At least the multibase prefix
+      if ((initial >> 5) != kBytes || !arg || *arg < 1U) {
+        return false;
+      }
+      it.arg = *arg;
+    }
+    if (!open.empty() && open.back().map &&
+        open.back().remaining % 2U == 0U && it.major != kText) {
+      return false;  // Map keys are strings
+    }
+    it.offset = static_cast<std::uint32_t>(pos);
+    auto index = static_cast<std::uint32_t>(items.size());
+    auto children = std::uint64_t{0};
+    switch (it.major) {
+      case kUnsigned:
+      case kNegative:
+        break;
+      case kBytes:
+      case kText:
+      case kTag:
+        if (it.arg > b.size() - pos) {
+          return false;
+        }
+        pos += it.arg;
+        break;
+      case kArray:
+        children = it.arg;
+        break;
+      case kMap:
+        children = it.arg * 2U;
+        if (children < it.arg) {
+          return false;
+        }
+        break;
+      case kSimple:
+        if (it.info == kFloat64) {
+          break;
+        }
+        if (it.info < kFalse || it.info > kUndefined) {
+          return false;  // Unassigned simple values, and narrow floats
+        }
+        break;
+    }
+    // Each child takes at least a byte: refuse to believe in more.
+    if (children > b.size() - pos) {
+      return false;
+    }
+    it.next = index + 1U;
+    items.push_back(it);
+    if (children) {
+      if (open.size() >= kMaxNesting) {
+        return false;
+      }
+      open.push_back({index, children, it.major == kMap});
+      continue;
+    }
+    // Close whatever this item was the last child of.
+    while (!open.empty() && --open.back().remaining == 0U) {
+      items[open.back().item].next = static_cast<std::uint32_t>(items.size());
+      open.pop_back();
+    }
+  } while (!open.empty());
+  return pos == b.size();
+}
+
+auto Self::Parse(ByteView bytes) -> std::unique_ptr<DagCborValue> {
+  auto block = std::make_shared<Block>();
+  block->bytes.assign(bytes.begin(), bytes.end());
+  if (!block->Index()) {
+    LOG(ERROR) << "Failed to parse DAG-CBOR.";
+    return {};
+  }
+  return base::WrapUnique(new Self(std::move(block), 0U));
+}
+std::size_t Self::items() const {
+  return block_->items.size();
+}
+ipfs::ByteView Self::Payload(std::uint32_t i) const {
+  auto& it = block_->items[i];
+  return ByteView{block_->bytes}.subspan(it.offset, it.arg);
+}
+std::string_view Self::Text(std::uint32_t i) const {
+  auto p = Payload(i);
+  return {reinterpret_cast<char const*>(p.data()), p.size()};
+}
+
+bool Self::is_map() const {
+  return block_->items[item_].major == kMap;
+}
+bool Self::is_array() const {
+  return block_->items[item_].major == kArray;
+}
+auto Self::at(std::string_view key) const -> std::unique_ptr<DagCborValue> {
+  if (!is_map()) {
+    return {};
+  }
+  auto& items = block_->items;
+  auto i = item_ + 1U;
+  for (auto n = items[item_].arg; n; --n) {
+    auto value = items[i].next;
+    if (Text(i) == key) {
+      return base::WrapUnique(new Self(block_, value));
+    }
+    i = items[value].next;
+  }
+  return {};
+}
+std::optional<std::uint64_t> Self::as_unsigned() const {
+  auto& it = block_->items[item_];
+  if (it.major == kUnsigned) {
+    return it.arg;
+  }
+  return std::nullopt;
+}
+std::optional<std::int64_t> Self::as_signed() const {
+  auto& it = block_->items[item_];
+  auto max = static_cast<std::uint64_t>(std::numeric_limits<std::int64_t>::max());
+  if ((it.major != kUnsigned && it.major != kNegative) || it.arg > max) {
+    return std::nullopt;
+  }
+  auto magnitude = static_cast<std::int64_t>(it.arg);
+  return it.major == kUnsigned ? magnitude : -1 - magnitude;
+}
+std::optional<double> Self::as_float() const {
+  auto& it = block_->items[item_];
+  if (it.major == kSimple && it.info == kFloat64) {
+    return std::bit_cast<double>(it.arg);
+  }
+  return std::nullopt;
+}
+std::optional<std::string> Self::as_string() const {
+  if (block_->items[item_].major == kText) {
+    return std::string{Text(item_)};
+  }
+  return std::nullopt;
+}
+auto Self::as_bytes() const -> std::optional<std::vector<std::uint8_t>> {
+  auto major = block_->items[item_].major;
+  if (major != kBytes && major != kTag) {
+    return std::nullopt;
+  }
+  auto p = Payload(item_);
+  std::vector<std::uint8_t> rv(p.size());
+  std::transform(p.begin(), p.end(), rv.begin(),
+                 [](std::byte b) { return std::to_integer<std::uint8_t>(b); });
+  return rv;
+}
+auto Self::as_link() const -> std::optional<Cid> {
+  if (block_->items[item_].major != kTag) {
+    VLOG(2) << "This is not a link.";
+    return std::nullopt;
+  }
+  // Drop the multibase prefix, which is 1B for all supported multibases
+  auto result = Cid(Payload(item_).subspan(1));
+  if (result.valid()) {
+    return result;
+  }
+  LOG(ERROR) << "Unable to decode bytes from DAG-CBOR Link as CID.";
+  return std::nullopt;
+}
+std::optional<bool> Self::as_bool() const {
+  auto& it = block_->items[item_];
+  if (it.major == kSimple && (it.info == kFalse || it.info == kTrue)) {
+    return it.info == kTrue;
+  }
+  return std::nullopt;
+}
+void Self::iterate_map(MapElementCallback cb) const {
+  if (!is_map()) {
+    return;
+  }
+  auto& items = block_->items;
+  auto i = item_ + 1U;
+  for (auto n = items[item_].arg; n; --n) {
+    auto value = items[i].next;
+    cb(Text(i), Self{block_, value});
+    i = items[value].next;
+  }
+}
+void Self::iterate_array(ArrayElementCallback cb) const {
+  if (!is_array()) {
+    return;
+  }
+  auto& items = block_->items;
+  auto i = item_ + 1U;
+  for (auto n = items[item_].arg; n; --n) {
+    cb(Self{block_, i});
+    i = items[i].next;
+  }
+}
+
+Self::LazyCborAdapter() {
+  auto b = std::make_shared<Block>();
+  b->items.push_back({kUndefined, 0U, 1U, kSimple, kUndefined});
+  block_ = std::move(b);
+}
+Self::LazyCborAdapter(LazyCborAdapter const&) = default;
+Self::LazyCborAdapter(std::shared_ptr<Block const> block, std::uint32_t item)
+    : block_{std::move(block)}, item_{item} {}
+Self::~LazyCborAdapter() noexcept = default;
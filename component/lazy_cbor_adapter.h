@@ -0,0 +1,75 @@
+#ifndef IPFS_LAZY_CBOR_ADAPTER_H_
+#define IPFS_LAZY_CBOR_ADAPTER_H_
+
+#include <ipfs_client/ctx/cbor_parser.h>
+#include <ipfs_client/dag_cbor_value.h>
+#include <vocab/byte_view.h>
+
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace ipfs {
+
+/*! DAG-CBOR decoded only as far as it's looked at
+ *  \details Parse makes one pass over the block recording where each item
+ *    is - a flat, pre-order list of offsets, with each container's children
+ *    following it and each item knowing where its subtree ends - but decodes
+ *    no strings, byte strings or numbers. Those are read straight out of the
+ *    block when asked for, so resolving one path segment through a large
+ *    manifest costs the index plus the keys compared on the way. Links
+ *    become a Cid directly from the block's bytes.
+ *    Values are cursors (block + item) like ChromiumCborAdapter's, sharing
+ *    the one copy of the block. Stricter than components/cbor in the ways
+ *    DAG-CBOR is: no indefinite lengths, no tags but 42, text keys only,
+ *    and only 64-bit floats (which it, unlike that, can read).
+ *    Used instead of ChromiumCborAdapter when kLazyDagCbor is enabled.
+ */
+class LazyCborAdapter final : public DagCborValue, public ctx::CborParser {
+ public:
+  /*! Deeper than this is rejected */
+  static constexpr std::size_t kMaxNesting = 256UL;
+
+  /*! A parser, itself an undefined value */
+  LazyCborAdapter();
+  LazyCborAdapter(LazyCborAdapter const&);
+  ~LazyCborAdapter() noexcept override;
+
+  /*! \brief Index CBOR bytes, which are copied once
+   *  \return nullptr if the bytes aren't one well-formed DAG-CBOR item
+   */
+  std::unique_ptr<DagCborValue> Parse(ByteView bytes) override;
+
+  /*! \return Items indexed in the whole block (for tests) */
+  std::size_t items() const;
+
+ private:
+  struct Block;
+  std::shared_ptr<Block const> block_;
+  std::uint32_t item_ = 0U;
+
+  LazyCborAdapter(std::shared_ptr<Block const>, std::uint32_t item);
+
+  std::unique_ptr<DagCborValue> at(std::string_view) const override;
+  std::optional<std::uint64_t> as_unsigned() const override;
+  std::optional<std::int64_t> as_signed() const override;
+  std::optional<double> as_float() const override;
+  std::optional<std::string> as_string() const override;
+  std::optional<std::vector<std::uint8_t>> as_bytes() const override;
+  std::optional<Cid> as_link() const override;
+  std::optional<bool> as_bool() const override;
+  bool is_map() const override;
+  bool is_array() const override;
+  void iterate_map(MapElementCallback) const override;
+  void iterate_array(ArrayElementCallback) const override;
+
+  /*! \return Item i's payload as text, e.g. a map key */
+  std::string_view Text(std::uint32_t i) const;
+  ByteView Payload(std::uint32_t i) const;
+};
+}  // namespace ipfs
+
+#endif  // IPFS_LAZY_CBOR_ADAPTER_H_
@@ -0,0 +1,126 @@
+#include "lazy_cbor_adapter.h"
+
+#include "chromium_cbor_adapter.h"
+
+#include <components/cbor/writer.h>
+
+#include <gtest/gtest.h>
+
+#include <string>
+#include <vector>
+
+namespace {
+std::vector<std::uint8_t> Encode(cbor::Value const& v) {
+  return cbor::Writer::Write(v).value();
+}
+/*! Everything the resolver could ask of a value, as text to compare */
+std::string Describe(ipfs::DagCborValue const& v) {
+  std::string rv;
+  if (v.is_map()) {
+    rv = "{";
+    v.iterate_map([&rv](std::string_view k, ipfs::DagCborValue const& e) {
+      rv.append(k).append(":").append(Describe(e)).append(",");
+      return true;
+    });
+    return rv + "}";
+  }
+  if (v.is_array()) {
+    rv = "[";
+    v.iterate_array([&rv](ipfs::DagCborValue const& e) {
+      rv.append(Describe(e)).append(",");
+      return true;
+    });
+    return rv + "]";
+  }
+  if (auto u = v.as_unsigned()) {
+    return "u" + std::to_string(*u);
+  }
+  if (auto i = v.as_signed()) {
+    return "i" + std::to_string(*i);
+  }
+  if (auto s = v.as_string()) {
+    return '"' + *s + '"';
+  }
+  if (auto b = v.as_bytes()) {
+    return "h" + std::string(b->begin(), b->end());
+  }
+  if (auto b = v.as_bool()) {
+    return *b ? "true" : "false";
+  }
+  return "?";
+}
+std::unique_ptr<ipfs::DagCborValue> Lazy(std::vector<std::uint8_t> const& b) {
+  return ipfs::LazyCborAdapter{}.Parse(ipfs::as_bytes(b));
+}
+}  // namespace
+
+TEST(LazyCborAdapterTest, AgreesWithChromiumCbor) {
+  cbor::Value::MapValue inner;
+  inner.emplace(cbor::Value{"empty"}, cbor::Value{cbor::Value::MapValue{}});
+  inner.emplace(cbor::Value{"none"}, cbor::Value{cbor::Value::ArrayValue{}});
+  cbor::Value::ArrayValue list;
+  list.emplace_back(1);
+  list.emplace_back("two");
+  list.emplace_back(std::vector<std::uint8_t>{'3', '3', '3'});
+  list.emplace_back(cbor::Value{std::move(inner)});
+  cbor::Value::MapValue root;
+  root.emplace(cbor::Value{"name"}, cbor::Value{"index.html"});
+  root.emplace(cbor::Value{"neg"}, cbor::Value{-5});
+  root.emplace(cbor::Value{"big"}, cbor::Value{int64_t{1} << 40});
+  root.emplace(cbor::Value{"ok"}, cbor::Value{true});
+  root.emplace(cbor::Value{"list"}, cbor::Value{std::move(list)});
+  auto bytes = Encode(cbor::Value{std::move(root)});
+
+  auto lazy = Lazy(bytes);
+  auto eager = ipfs::ChromiumCborAdapter{}.Parse(ipfs::as_bytes(bytes));
+  ASSERT_TRUE(lazy);
+  ASSERT_TRUE(eager);
+  EXPECT_EQ(Describe(*lazy), Describe(*eager));
+  for (auto key : {"name", "neg", "big", "ok", "list"}) {
+    auto l = lazy->at(key);
+    ASSERT_TRUE(l) << key;
+    EXPECT_EQ(Describe(*l), Describe(*eager->at(key))) << key;
+  }
+  EXPECT_FALSE(lazy->at("missing"));
+  EXPECT_FALSE(lazy->at("name")->at("name"));
+  EXPECT_EQ(lazy->at("neg")->as_signed(), -5);
+  EXPECT_FALSE(lazy->at("neg")->as_unsigned());
+}
+
+TEST(LazyCborAdapterTest, LinksAndFloats) {
+  // {"l": 42(h'00' + CIDv1 raw sha2-256), "f": 1.5}
+  std::vector<std::uint8_t> bytes{0xa2, 0x61, 'l', 0xd8, 0x2a, 0x58, 0x25,
+                                  0x00, 0x01, 0x55, 0x12, 0x20};
+  bytes.insert(bytes.end(), 32UL, 0xAB);
+  bytes.insert(bytes.end(), {0x61, 'f', 0xfb, 0x3f, 0xf8, 0, 0, 0, 0, 0, 0});
+  auto doc = Lazy(bytes);
+  ASSERT_TRUE(doc);
+  auto link = doc->at("l");
+  ASSERT_TRUE(link);
+  auto cid = link->as_link();
+  ASSERT_TRUE(cid);
+  EXPECT_TRUE(cid->valid());
+  EXPECT_EQ(link->as_bytes()->size(), 37UL);
+  EXPECT_FALSE(doc->at("f")->as_link());
+  EXPECT_EQ(doc->at("f")->as_float(), 1.5);
+}
+
+TEST(LazyCborAdapterTest, RejectsWhatDagCborDoesNot) {
+  using B = std::vector<std::uint8_t>;
+  EXPECT_TRUE(Lazy(B{0x82, 0x01, 0x02}));
+  EXPECT_FALSE(Lazy(B{})) << "Empty";
+  EXPECT_FALSE(Lazy(B{0x9f, 0x01, 0xff})) << "Indefinite length";
+  EXPECT_FALSE(Lazy(B{0x63, 'a'})) << "Truncated";
+  EXPECT_FALSE(Lazy(B{0x82, 0x01})) << "Missing array item";
+  EXPECT_FALSE(Lazy(B{0x01, 0x02})) << "Trailing bytes";
+  EXPECT_FALSE(Lazy(B{0xa1, 0x01, 0x02})) << "Non-text key";
+  EXPECT_FALSE(Lazy(B{0xc1, 0x00})) << "Tag other than 42";
+  EXPECT_FALSE(Lazy(B{0xd8, 0x2a, 0x40})) << "Link without multibase";
+  EXPECT_FALSE(Lazy(B{0xf9, 0x3c, 0x00})) << "Half float";
+  EXPECT_FALSE(Lazy(B{0x9a, 0xff, 0xff, 0xff, 0xff})) << "Absurd count";
+  B deep(ipfs::LazyCborAdapter::kMaxNesting + 1UL, 0x81);
+  deep.push_back(0x00);
+  EXPECT_FALSE(Lazy(deep)) << "Too deep";
+  deep.erase(deep.begin());
+  EXPECT_TRUE(Lazy(deep));
+}
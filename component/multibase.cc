@@ -0,0 +1,434 @@
+#include "multibase.h"
+
+#include <base/check.h>
+#include <build/build_config.h>
+
+#if defined(ARCH_CPU_X86_FAMILY)
+#include <base/cpu.h>
+
+#include <tmmintrin.h>
+#endif
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstring>
+
+namespace mb = ipfs::multibase;
+
+namespace {
+constexpr char kBase32[] = "abcdefghijklmnopqrstuvwxyz234567";
+constexpr char kBase64Url[] =
+    "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789-_";
+constexpr char kBase58Btc[] =
+    "123456789ABCDEFGHJKLMNPQRSTUVWXYZabcdefghijkmnopqrstuvwxyz";
+/*! 58^5, the most base58 digits a limb holds below 2^32 */
+constexpr std::uint64_t kBase58Limb = 656356768U;
+
+/*! Symbol to value, -1 for anything not in the alphabet */
+template <std::size_t N>
+constexpr std::array<std::int8_t, 256> Reverse(char const (&alphabet)[N]) {
+  std::array<std::int8_t, 256> rv{};
+  for (auto& v : rv) {
+    v = -1;
+  }
+  for (auto i = 0UL; i + 1UL < N; ++i) {
+    rv[static_cast<std::uint8_t>(alphabet[i])] = static_cast<std::int8_t>(i);
+  }
+  return rv;
+}
+constexpr auto kFromBase32 = [] {
+  auto rv = Reverse(kBase32);
+  for (char c = 'A'; c <= 'Z'; ++c) {
+    rv[static_cast<std::uint8_t>(c)] = static_cast<std::int8_t>(c - 'A');
+  }
+  return rv;
+}();
+constexpr auto kFromBase64Url = Reverse(kBase64Url);
+constexpr auto kFromBase58Btc = Reverse(kBase58Btc);
+
+/*! The unpadded encoding of n bytes, in symbols of Bits bits each */
+template <int Bits>
+constexpr std::size_t EncodedSize(std::size_t n) {
+  return (n * 8UL + Bits - 1) / Bits;
+}
+
+/*! Any number of whole bytes, one symbol at a time */
+template <int Bits>
+char* EncodeScalar(std::uint8_t const* in,
+                   std::size_t n,
+                   char const* alphabet,
+                   char* out) {
+  constexpr std::uint32_t mask = (1U << Bits) - 1U;
+  std::uint32_t buf = 0U;
+  int bits = 0;
+  for (auto i = 0UL; i < n; ++i) {
+    buf = (buf << 8) | in[i];
+    bits += 8;
+    while (bits >= Bits) {
+      bits -= Bits;
+      *out++ = alphabet[(buf >> bits) & mask];
+    }
+  }
+  if (bits) {
+    *out++ = alphabet[(buf << (Bits - bits)) & mask];
+  }
+  return out;
+}
+/*! \return false if a symbol is invalid, or the end doesn't make whole bytes
+ *    with zero bits to spare
+ */
+template <int Bits>
+bool DecodeScalar(char const* in,
+                  std::size_t n,
+                  std::array<std::int8_t, 256> const& table,
+                  std::uint8_t* out) {
+  std::uint32_t buf = 0U;
+  int bits = 0;
+  for (auto i = 0UL; i < n; ++i) {
+    auto v = table[static_cast<std::uint8_t>(in[i])];
+    if (v < 0) {
+      return false;
+    }
+    buf = (buf << Bits) | static_cast<std::uint32_t>(v);
+    bits += Bits;
+    if (bits >= 8) {
+      bits -= 8;
+      *out++ = static_cast<std::uint8_t>(buf >> bits);
+    }
+  }
+  // A whole leftover symbol means a length no encoder produces.
+  return bits < Bits && (buf & ((1U << bits) - 1U)) == 0U;
+}
+
+#if defined(ARCH_CPU_X86_FAMILY)
+/*! 0xFF where lo <= x <= hi, unsigned */
+inline __m128i InRange(__m128i x, char lo, char hi) {
+  auto t = _mm_sub_epi8(x, _mm_set1_epi8(lo));
+  return _mm_cmpeq_epi8(_mm_min_epu8(t, _mm_set1_epi8(hi - lo)), t);
+}
+
+/*! 10 bytes to 16 characters per step; reads 16 bytes, so stops 6 early */
+__attribute__((target("ssse3"))) std::size_t
+EncodeBase32Ssse3(std::uint8_t const* in, std::size_t n, char*& out) {
+  // Each 5-byte group, big-endian, in the low 40 bits of a 64-bit lane.
+  auto const gather = _mm_setr_epi8(4, 3, 2, 1, 0, -128, -128, -128, 9, 8, 7,
+                                    6, 5, -128, -128, -128);
+  auto const second20 = _mm_set_epi32(0xFFFFF, 0, 0xFFFFF, 0);
+  auto const second10 = _mm_set1_epi32(0x03FF0000);
+  auto const second5 = _mm_set1_epi16(0x1F00);
+  auto const last_letter = _mm_set1_epi8(25);
+  auto const to_letter = _mm_set1_epi8('a');
+  auto const to_digit = _mm_set1_epi8('2' - 'a' - 26);
+  std::size_t i = 0UL;
+  for (; n - i >= 16UL; i += 10UL, out += 16) {
+    auto v = _mm_loadu_si128(reinterpret_cast<__m128i const*>(in + i));
+    v = _mm_shuffle_epi8(v, gather);
+    // Halve the field width three times, 40 -> 20 -> 10 -> 5 bits, keeping
+    //   the earlier half in the lower-addressed lane.
+    v = _mm_or_si128(_mm_srli_epi64(v, 20),
+                     _mm_and_si128(_mm_slli_epi64(v, 32), second20));
+    v = _mm_or_si128(_mm_srli_epi32(v, 10),
+                     _mm_and_si128(_mm_slli_epi32(v, 16), second10));
+    v = _mm_or_si128(_mm_srli_epi16(v, 5),
+                     _mm_and_si128(_mm_slli_epi16(v, 8), second5));
+    auto digits = _mm_cmpgt_epi8(v, last_letter);
+    v = _mm_add_epi8(_mm_add_epi8(v, to_letter), _mm_and_si128(digits, to_digit));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(out), v);
+  }
+  return i;
+}
+/*! 16 characters to 10 bytes per step
+ *  \return How much of in was consumed, or npos on an invalid character
+ */
+__attribute__((target("ssse3"))) std::size_t
+DecodeBase32Ssse3(char const* in, std::size_t n, std::uint8_t*& out) {
+  auto const case_bit = _mm_set1_epi8(0x20);
+  auto const from_letter = _mm_set1_epi8('a');
+  auto const from_digit = _mm_set1_epi8('2' - 26);
+  auto const first20 = _mm_set_epi32(0, -1, 0, -1);
+  auto const scatter = _mm_setr_epi8(4, 3, 2, 1, 0, 12, 11, 10, 9, 8, -128,
+                                     -128, -128, -128, -128, -128);
+  std::size_t i = 0UL;
+  for (; n - i >= 16UL; i += 16UL, out += 10) {
+    auto c = _mm_loadu_si128(reinterpret_cast<__m128i const*>(in + i));
+    auto lower = _mm_or_si128(c, case_bit);
+    auto letter = InRange(lower, 'a', 'z');
+    // Not on lower: 0x12 | 0x20 would pass for '2'.
+    auto digit = InRange(c, '2', '7');
+    if (_mm_movemask_epi8(_mm_or_si128(letter, digit)) != 0xFFFF) {
+      return std::string_view::npos;
+    }
+    auto v = _mm_or_si128(
+        _mm_and_si128(letter, _mm_sub_epi8(lower, from_letter)),
+        _mm_and_si128(digit, _mm_sub_epi8(c, from_digit)));
+    // The reverse of encoding: 5 -> 10 -> 20 -> 40 bits per field.
+    v = _mm_maddubs_epi16(v, _mm_set1_epi16(0x0120));
+    v = _mm_madd_epi16(v, _mm_set1_epi32(0x00010400));
+    v = _mm_or_si128(_mm_slli_epi64(_mm_and_si128(v, first20), 20),
+                     _mm_srli_epi64(v, 32));
+    alignas(16) std::uint8_t bytes[16];
+    _mm_store_si128(reinterpret_cast<__m128i*>(bytes),
+                    _mm_shuffle_epi8(v, scatter));
+    std::memcpy(out, bytes, 10UL);
+  }
+  return i;
+}
+
+/*! 12 bytes to 16 characters per step, after Muła's base64 work */
+__attribute__((target("ssse3"))) std::size_t
+EncodeBase64UrlSsse3(std::uint8_t const* in, std::size_t n, char*& out) {
+  auto const gather =
+      _mm_set_epi8(10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1);
+  auto const mask_ac = _mm_set1_epi32(0x0FC0FC00);
+  auto const shift_ac = _mm_set1_epi32(0x04000040);
+  auto const mask_bd = _mm_set1_epi32(0x003F03F0);
+  auto const shift_bd = _mm_set1_epi32(0x01000010);
+  // Offset from value to symbol, by which range the value's in.
+  auto const offsets = _mm_setr_epi8(
+      'a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+      '0' - 52, '0' - 52, '0' - 52, '0' - 52, '-' - 62, '_' - 63, 'A', 0, 0);
+  std::size_t i = 0UL;
+  for (; n - i >= 16UL; i += 12UL, out += 16) {
+    auto v = _mm_loadu_si128(reinterpret_cast<__m128i const*>(in + i));
+    v = _mm_shuffle_epi8(v, gather);
+    v = _mm_or_si128(_mm_mulhi_epu16(_mm_and_si128(v, mask_ac), shift_ac),
+                     _mm_mullo_epi16(_mm_and_si128(v, mask_bd), shift_bd));
+    // 0-25 -> 13, 26-51 -> 0, 52-61 -> 1-10, 62 -> 11, 63 -> 12
+    auto range = _mm_subs_epu8(v, _mm_set1_epi8(51));
+    auto upper = _mm_cmpgt_epi8(_mm_set1_epi8(26), v);
+    range = _mm_or_si128(range, _mm_and_si128(upper, _mm_set1_epi8(13)));
+    v = _mm_add_epi8(v, _mm_shuffle_epi8(offsets, range));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(out), v);
+  }
+  return i;
+}
+__attribute__((target("ssse3"))) std::size_t
+DecodeBase64UrlSsse3(char const* in, std::size_t n, std::uint8_t*& out) {
+  auto const scatter = _mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12,
+                                     -128, -128, -128, -128);
+  std::size_t i = 0UL;
+  for (; n - i >= 16UL; i += 16UL, out += 12) {
+    auto c = _mm_loadu_si128(reinterpret_cast<__m128i const*>(in + i));
+    auto upper = InRange(c, 'A', 'Z');
+    auto lower = InRange(c, 'a', 'z');
+    auto digit = InRange(c, '0', '9');
+    auto dash = _mm_cmpeq_epi8(c, _mm_set1_epi8('-'));
+    auto underscore = _mm_cmpeq_epi8(c, _mm_set1_epi8('_'));
+    auto valid = _mm_or_si128(_mm_or_si128(upper, lower),
+                              _mm_or_si128(digit, _mm_or_si128(dash, underscore)));
+    if (_mm_movemask_epi8(valid) != 0xFFFF) {
+      return std::string_view::npos;
+    }
+    auto v = _mm_or_si128(
+        _mm_or_si128(_mm_and_si128(upper, _mm_sub_epi8(c, _mm_set1_epi8('A'))),
+                     _mm_and_si128(lower, _mm_sub_epi8(c, _mm_set1_epi8('a' - 26)))),
+        _mm_or_si128(
+            _mm_and_si128(digit, _mm_sub_epi8(c, _mm_set1_epi8('0' - 52))),
+            _mm_or_si128(_mm_and_si128(dash, _mm_set1_epi8(62)),
+                         _mm_and_si128(underscore, _mm_set1_epi8(63)))));
+    // 6 -> 12 -> 24 bits per field, then the 3 bytes of each, big-endian.
+    v = _mm_maddubs_epi16(v, _mm_set1_epi32(0x01400140));
+    v = _mm_madd_epi16(v, _mm_set1_epi32(0x00011000));
+    alignas(16) std::uint8_t bytes[16];
+    _mm_store_si128(reinterpret_cast<__m128i*>(bytes),
+                    _mm_shuffle_epi8(v, scatter));
+    std::memcpy(out, bytes, 12UL);
+  }
+  return i;
+}
+bool Simd(mb::Kernel k) {
+  DCHECK(k != mb::Kernel::kSsse3 || mb::Best() == mb::Kernel::kSsse3);
+  return k == mb::Kernel::kSsse3;
+}
+#endif
+
+std::uint8_t const* Bytes(ipfs::ByteView b) {
+  return reinterpret_cast<std::uint8_t const*>(b.data());
+}
+}  // namespace
+
+auto mb::Best() -> Kernel {
+#if defined(ARCH_CPU_X86_FAMILY)
+  static bool const ssse3 = base::CPU().has_ssse3();
+  return ssse3 ? Kernel::kSsse3 : Kernel::kScalar;
+#else
+  return Kernel::kScalar;
+#endif
+}
+
+std::string mb::EncodeBase32(ByteView bin, Kernel k) {
+  std::string rv(EncodedSize<5>(bin.size()), '\0');
+  auto* out = rv.data();
+  std::size_t done = 0UL;
+#if defined(ARCH_CPU_X86_FAMILY)
+  if (Simd(k)) {
+    done = EncodeBase32Ssse3(Bytes(bin), bin.size(), out);
+  }
+#endif
+  EncodeScalar<5>(Bytes(bin) + done, bin.size() - done, kBase32, out);
+  return rv;
+}
+auto mb::DecodeBase32(std::string_view txt, Kernel k)
+    -> std::optional<std::vector<std::byte>> {
+  std::vector<std::byte> rv(txt.size() * 5UL / 8UL);
+  auto* out = reinterpret_cast<std::uint8_t*>(rv.data());
+  std::size_t done = 0UL;
+#if defined(ARCH_CPU_X86_FAMILY)
+  if (Simd(k)) {
+    done = DecodeBase32Ssse3(txt.data(), txt.size(), out);
+    if (done == std::string_view::npos) {
+      return std::nullopt;
+    }
+  }
+#endif
+  // 16 characters are exactly 10 bytes, so the tail starts on a boundary.
+  if (!DecodeScalar<5>(txt.data() + done, txt.size() - done, kFromBase32,
+                       out)) {
+    return std::nullopt;
+  }
+  return rv;
+}
+
+std::string mb::EncodeBase64Url(ByteView bin, Kernel k) {
+  std::string rv(EncodedSize<6>(bin.size()), '\0');
+  auto* out = rv.data();
+  std::size_t done = 0UL;
+#if defined(ARCH_CPU_X86_FAMILY)
+  if (Simd(k)) {
+    done = EncodeBase64UrlSsse3(Bytes(bin), bin.size(), out);
+  }
+#endif
+  EncodeScalar<6>(Bytes(bin) + done, bin.size() - done, kBase64Url, out);
+  return rv;
+}
+auto mb::DecodeBase64Url(std::string_view txt, Kernel k)
+    -> std::optional<std::vector<std::byte>> {
+  std::vector<std::byte> rv(txt.size() * 6UL / 8UL);
+  auto* out = reinterpret_cast<std::uint8_t*>(rv.data());
+  std::size_t done = 0UL;
+#if defined(ARCH_CPU_X86_FAMILY)
+  if (Simd(k)) {
+    done = DecodeBase64UrlSsse3(txt.data(), txt.size(), out);
+    if (done == std::string_view::npos) {
+      return std::nullopt;
+    }
+  }
+#endif
+  if (!DecodeScalar<6>(txt.data() + done, txt.size() - done, kFromBase64Url,
+                       out)) {
+    return std::nullopt;
+  }
+  return rv;
+}
+
+std::string mb::EncodeBase58Btc(ByteView bin) {
+  auto* in = Bytes(bin);
+  auto zeros = 0UL;
+  while (zeros < bin.size() && in[zeros] == 0U) {
+    ++zeros;
+  }
+  // Little-endian limbs, each 5 base58 digits. The input is absorbed 4 bytes
+  //   at a time (the odd ones first), so a 34-byte CIDv0 takes 9 passes over
+  //   at most 10 limbs rather than 34 passes over 46 digits.
+  std::vector<std::uint32_t> limbs;
+  limbs.reserve((bin.size() - zeros) * 138UL / 500UL + 1UL);
+  auto absorb = [&limbs](std::uint64_t scale, std::uint64_t carry) {
+    for (auto& l : limbs) {
+      auto x = l * scale + carry;
+      l = static_cast<std::uint32_t>(x % kBase58Limb);
+      carry = x / kBase58Limb;
+    }
+    for (; carry; carry /= kBase58Limb) {
+      limbs.push_back(static_cast<std::uint32_t>(carry % kBase58Limb));
+    }
+  };
+  auto i = zeros;
+  if (auto odd = (bin.size() - zeros) % 4UL) {
+    std::uint64_t word = 0U;
+    for (auto end = i + odd; i < end; ++i) {
+      word = (word << 8) | in[i];
+    }
+    absorb(1U << (8 * odd), word);
+  }
+  for (; i < bin.size(); i += 4UL) {
+    std::uint64_t word = (std::uint64_t{in[i]} << 24) | (in[i + 1] << 16) |
+                         (in[i + 2] << 8) | in[i + 3];
+    absorb(std::uint64_t{1} << 32, word);
+  }
+  std::string rv(zeros, '1');
+  if (limbs.empty()) {
+    return rv;
+  }
+  auto digits = [](std::uint32_t l, int n) {
+    char buf[5];
+    for (auto d = n; d--; l /= 58U) {
+      buf[d] = kBase58Btc[l % 58U];
+    }
+    return std::string(buf, static_cast<std::size_t>(n));
+  };
+  auto top = limbs.back();
+  auto width = 0;
+  for (auto t = top; t; t /= 58U) {
+    ++width;
+  }
+  rv.append(digits(top, width));
+  for (auto l = limbs.rbegin() + 1; l != limbs.rend(); ++l) {
+    rv.append(digits(*l, 5));
+  }
+  return rv;
+}
+auto mb::DecodeBase58Btc(std::string_view txt)
+    -> std::optional<std::vector<std::byte>> {
+  auto zeros = 0UL;
+  while (zeros < txt.size() && txt[zeros] == '1') {
+    ++zeros;
+  }
+  // Little-endian 32-bit limbs, taking up to 5 digits per pass.
+  std::vector<std::uint32_t> limbs;
+  limbs.reserve((txt.size() - zeros) * 733UL / 1000UL / 4UL + 1UL);
+  for (auto i = zeros; i < txt.size();) {
+    std::uint64_t scale = 1U;
+    std::uint64_t carry = 0U;
+    for (auto end = std::min(i + 5UL, txt.size()); i < end; ++i) {
+      auto v = kFromBase58Btc[static_cast<std::uint8_t>(txt[i])];
+      if (v < 0) {
+        return std::nullopt;
+      }
+      scale *= 58U;
+      carry = carry * 58U + static_cast<std::uint64_t>(v);
+    }
+    for (auto& l : limbs) {
+      auto x = l * scale + carry;
+      l = static_cast<std::uint32_t>(x);
+      carry = x >> 32;
+    }
+    if (carry) {
+      limbs.push_back(static_cast<std::uint32_t>(carry));
+    }
+  }
+  std::vector<std::byte> rv(zeros);
+  rv.reserve(zeros + limbs.size() * 4UL);
+  auto leading = true;
+  for (auto l = limbs.rbegin(); l != limbs.rend(); ++l) {
+    for (auto shift = 24; shift >= 0; shift -= 8) {
+      auto b = static_cast<std::uint8_t>(*l >> shift);
+      if (leading && !b) {
+        continue;
+      }
+      leading = false;
+      rv.push_back(static_cast<std::byte>(b));
+    }
+  }
+  return rv;
+}
+
+std::string mb::CidV1Base32(ByteView cid) {
+  if (cid.size() == 34UL && cid[0] == std::byte{0x12} &&
+      cid[1] == std::byte{0x20}) {
+    std::array<std::byte, 36> v1{std::byte{0x01}, std::byte{0x70}};
+    std::copy(cid.begin(), cid.end(), v1.begin() + 2);
+    return 'b' + EncodeBase32(v1);
+  }
+  return 'b' + EncodeBase32(cid);
+}
@@ -0,0 +1,57 @@
+#ifndef IPFS_MULTIBASE_H_
+#define IPFS_MULTIBASE_H_
+
+#include <vocab/byte_view.h>
+
+#include <cstddef>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/*!
+ * \brief The multibase encodings CIDs are actually spelled in
+ * \details base32 (RFC 4648 lowercase, unpadded: multibase 'b'), base64url
+ *    (unpadded: multibase 'u') and base58btc (CIDv0's "Qm..."). The strings
+ *    here are the bare encodings; the multibase prefix is the caller's.
+ *    base32 and base64url have SSSE3 kernels chosen at runtime, with a
+ *    portable loop everywhere else and for the tail of every input.
+ */
+namespace ipfs::multibase {
+
+/*! Which implementation does the work */
+enum class Kernel {
+  kScalar,  ///< One symbol at a time; the reference
+  kSsse3,   ///< 16 characters per step, x86 with SSSE3 only
+};
+
+/*! \return The fastest Kernel this CPU can run, decided once */
+Kernel Best();
+
+std::string EncodeBase32(ByteView, Kernel = Best());
+/*! \return nullopt on a character outside [a-z2-7] (either case), an
+ *    impossible length, or nonzero padding bits
+ */
+std::optional<std::vector<std::byte>> DecodeBase32(std::string_view,
+                                                   Kernel = Best());
+
+std::string EncodeBase64Url(ByteView, Kernel = Best());
+/*! \return nullopt on a character outside [A-Za-z0-9_-] (so also on '='
+ *    padding), an impossible length, or nonzero padding bits
+ */
+std::optional<std::vector<std::byte>> DecodeBase64Url(std::string_view,
+                                                      Kernel = Best());
+
+/*! \brief Big-number conversion, 5 digits per limb rather than 1 */
+std::string EncodeBase58Btc(ByteView);
+std::optional<std::vector<std::byte>> DecodeBase58Btc(std::string_view);
+
+/*!
+ * \brief Spell a binary CID the way Cid::to_string does
+ * \details "b" + base32 of the CIDv1. A CIDv0 (a bare sha2-256 multihash) is
+ *    first given version 1 and the dag-pb codec. Validity isn't checked.
+ */
+std::string CidV1Base32(ByteView cid);
+}  // namespace ipfs::multibase
+
+#endif  // IPFS_MULTIBASE_H_
@@ -0,0 +1,110 @@
+#include "multibase.h"
+
+#include <base/timer/elapsed_timer.h>
+#include <testing/gtest/include/gtest/gtest.h>
+#include <testing/perf/perf_result_reporter.h>
+
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace mb = ipfs::multibase;
+
+namespace {
+constexpr int kPasses = 100000;
+
+/*! A CIDv1 (dag-pb, sha2-256) as it comes out of a CAR */
+std::vector<std::byte> CidBytes() {
+  auto v = mb::DecodeBase32(
+      "afybeigdyrzt5sfp7udm7hu76uh7y26nf3efuylqabf3oclgtqy55fbzdi");
+  return v.value_or(std::vector<std::byte>{});
+}
+
+void Report(std::string const& story, std::size_t count, base::TimeDelta t) {
+  perf_test::PerfResultReporter reporter("Multibase", story);
+  reporter.RegisterImportantMetric("per_cid", "ns");
+  reporter.AddResult("per_cid", t.InNanosecondsF() / count);
+}
+}  // namespace
+
+TEST(MultibasePerfTest, Base32Cid) {
+  auto bin = CidBytes();
+  ASSERT_EQ(bin.size(), 36UL);
+  for (auto [name, k] : {std::pair{"scalar", mb::Kernel::kScalar},
+                         std::pair{"best", mb::Best()}}) {
+    std::size_t sum = 0UL;
+    base::ElapsedTimer enc;
+    for (auto p = 0; p < kPasses; ++p) {
+      bin[35] = static_cast<std::byte>(p);
+      sum += mb::EncodeBase32(bin, k).size();
+    }
+    Report(std::string{"base32_encode_"} + name, kPasses, enc.Elapsed());
+    auto txt = mb::EncodeBase32(bin, k);
+    base::ElapsedTimer dec;
+    for (auto p = 0; p < kPasses; ++p) {
+      sum += mb::DecodeBase32(txt, k)->size();
+    }
+    Report(std::string{"base32_decode_"} + name, kPasses, dec.Elapsed());
+    EXPECT_EQ(sum, kPasses * (58UL + 36UL));
+  }
+}
+
+TEST(MultibasePerfTest, Base64UrlCid) {
+  auto bin = CidBytes();
+  for (auto [name, k] : {std::pair{"scalar", mb::Kernel::kScalar},
+                         std::pair{"best", mb::Best()}}) {
+    std::size_t sum = 0UL;
+    base::ElapsedTimer enc;
+    for (auto p = 0; p < kPasses; ++p) {
+      bin[35] = static_cast<std::byte>(p);
+      sum += mb::EncodeBase64Url(bin, k).size();
+    }
+    Report(std::string{"base64url_encode_"} + name, kPasses, enc.Elapsed());
+    auto txt = mb::EncodeBase64Url(bin, k);
+    base::ElapsedTimer dec;
+    for (auto p = 0; p < kPasses; ++p) {
+      sum += mb::DecodeBase64Url(txt, k)->size();
+    }
+    Report(std::string{"base64url_decode_"} + name, kPasses, dec.Elapsed());
+    EXPECT_EQ(sum, kPasses * (48UL + 36UL));
+  }
+}
+
+TEST(MultibasePerfTest, Base58CidV0) {
+  constexpr char kV0[] = "QmPZ9gcCEpqKTo6aq61g2nXGUhM4iCL3ewB6LDXZCtioEB";
+  std::size_t sum = 0UL;
+  base::ElapsedTimer dec;
+  for (auto p = 0; p < kPasses; ++p) {
+    sum += mb::DecodeBase58Btc(kV0)->size();
+  }
+  Report("base58btc_decode", kPasses, dec.Elapsed());
+  auto bin = mb::DecodeBase58Btc(kV0).value();
+  base::ElapsedTimer enc;
+  for (auto p = 0; p < kPasses; ++p) {
+    sum += mb::EncodeBase58Btc(bin).size();
+  }
+  Report("base58btc_encode", kPasses, enc.Elapsed());
+  EXPECT_EQ(sum, kPasses * (34UL + 46UL));
+}
+
+TEST(MultibasePerfTest, LargeBase32) {
+  // Long enough that the per-call overhead disappears: raw kernel speed.
+  std::vector<std::byte> bin(1UL << 20);
+  for (auto i = 0UL; i < bin.size(); ++i) {
+    bin[i] = static_cast<std::byte>(i * 131UL);
+  }
+  for (auto [name, k] : {std::pair{"scalar", mb::Kernel::kScalar},
+                         std::pair{"best", mb::Best()}}) {
+    base::ElapsedTimer timer;
+    std::size_t sum = 0UL;
+    for (auto p = 0; p < 20; ++p) {
+      sum += mb::DecodeBase32(mb::EncodeBase32(bin, k), k)->size();
+    }
+    perf_test::PerfResultReporter reporter("Multibase",
+                                           std::string{"base32_1MiB_"} + name);
+    reporter.RegisterImportantMetric("round_trip", "MB/s");
+    reporter.AddResult("round_trip",
+                       20.0 * bin.size() / 1e6 / timer.Elapsed().InSecondsF());
+    EXPECT_EQ(sum, 20UL * bin.size());
+  }
+}
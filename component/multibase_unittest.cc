@@ -0,0 +1,124 @@
+#include "multibase.h"
+
+#include <gtest/gtest.h>
+
+#include <random>
+#include <string>
+#include <vector>
+
+namespace mb = ipfs::multibase;
+
+namespace {
+std::vector<std::byte> Bytes(std::string_view s) {
+  auto b = ipfs::as_bytes(s);
+  return {b.begin(), b.end()};
+}
+/*! The textbook one-digit-at-a-time conversion, to check the limbs against */
+std::string ReferenceBase58(std::vector<std::byte> const& bin) {
+  constexpr char kAlphabet[] =
+      "123456789ABCDEFGHJKLMNPQRSTUVWXYZabcdefghijkmnopqrstuvwxyz";
+  std::vector<std::uint8_t> digits;
+  for (auto b : bin) {
+    auto carry = static_cast<unsigned>(b);
+    for (auto& d : digits) {
+      carry += d * 256U;
+      d = static_cast<std::uint8_t>(carry % 58U);
+      carry /= 58U;
+    }
+    for (; carry; carry /= 58U) {
+      digits.push_back(static_cast<std::uint8_t>(carry % 58U));
+    }
+  }
+  std::string rv;
+  for (auto b : bin) {
+    if (b != std::byte{}) {
+      break;
+    }
+    rv.push_back('1');
+  }
+  for (auto d = digits.rbegin(); d != digits.rend(); ++d) {
+    rv.push_back(kAlphabet[*d]);
+  }
+  return rv;
+}
+}  // namespace
+
+TEST(MultibaseTest, Rfc4648Vectors) {
+  std::pair<char const*, char const*> base32[] = {
+      {"", ""},          {"f", "my"},         {"fo", "mzxq"},
+      {"foo", "mzxw6"},  {"foob", "mzxw6yq"}, {"fooba", "mzxw6ytb"},
+      {"foobar", "mzxw6ytboi"},
+  };
+  for (auto [in, out] : base32) {
+    EXPECT_EQ(mb::EncodeBase32(Bytes(in)), out);
+    EXPECT_EQ(mb::DecodeBase32(out), Bytes(in));
+  }
+  EXPECT_EQ(mb::DecodeBase32("MZXW6YTBOI"), Bytes("foobar"));
+  EXPECT_EQ(mb::EncodeBase64Url(Bytes("\xFB\xFF\xBF")), "-_-_");
+  EXPECT_EQ(mb::EncodeBase64Url(Bytes("foobar")), "Zm9vYmFy");
+  EXPECT_EQ(mb::DecodeBase64Url("Zm9vYg"), Bytes("foob"));
+}
+
+TEST(MultibaseTest, Rejects) {
+  for (auto bad : {"a", "abc", "abcdef", "mzxw6ytbo!", "mzxw6ytbo1", "mz",
+                   "mzxw6ytboj"}) {
+    EXPECT_FALSE(mb::DecodeBase32(bad)) << bad;
+  }
+  for (auto bad : {"Z", "Zm9vYg==", "Zm9v+mFy", "Zm9vYh"}) {
+    EXPECT_FALSE(mb::DecodeBase64Url(bad)) << bad;
+  }
+  EXPECT_FALSE(mb::DecodeBase58Btc("Qm0"));
+  EXPECT_FALSE(mb::DecodeBase58Btc("QmIl"));
+}
+
+TEST(MultibaseTest, CidV0BecomesV1) {
+  auto v0 = mb::DecodeBase58Btc("QmPZ9gcCEpqKTo6aq61g2nXGUhM4iCL3ewB6LDXZCtioEB");
+  ASSERT_TRUE(v0);
+  ASSERT_EQ(v0->size(), 34UL);
+  EXPECT_EQ(mb::EncodeBase58Btc(*v0),
+            "QmPZ9gcCEpqKTo6aq61g2nXGUhM4iCL3ewB6LDXZCtioEB");
+  EXPECT_EQ(mb::CidV1Base32(*v0),
+            "bafybeiasb5vpmaounyilfuxbd3lryvosl4yefqrfahsb2esg46q6tu6y5q");
+  auto v1 = mb::DecodeBase32(
+      "afkreigh2akiscaildcqabsyg3dfr6chu3fgpregiymsck7e7aqa4s52zy");
+  ASSERT_TRUE(v1);
+  EXPECT_EQ(mb::CidV1Base32(*v1),
+            "bafkreigh2akiscaildcqabsyg3dfr6chu3fgpregiymsck7e7aqa4s52zy");
+}
+
+TEST(MultibaseTest, FastKernelsAgreeWithScalar) {
+  // On a CPU without SSSE3 this compares the scalar kernel with itself.
+  auto fast = mb::Best();
+  std::mt19937 rng{47U};
+  constexpr char kSymbols[] =
+      "abcdefghijklmnopqrstuvwxyz234567ABCDEFGHIJKLMNOPQRSTUVWXYZ01-_=\x80";
+  for (auto round = 0; round < 20000; ++round) {
+    // Low-entropy bytes too, so runs of zeros and '1's come up.
+    std::vector<std::byte> bin(rng() % 100U);
+    for (auto& b : bin) {
+      b = static_cast<std::byte>(rng() % (round % 3 ? 256U : 2U));
+    }
+    auto b32 = mb::EncodeBase32(bin, mb::Kernel::kScalar);
+    ASSERT_EQ(mb::EncodeBase32(bin, fast), b32);
+    ASSERT_EQ(mb::DecodeBase32(b32, fast), bin) << b32;
+    auto b64 = mb::EncodeBase64Url(bin, mb::Kernel::kScalar);
+    ASSERT_EQ(mb::EncodeBase64Url(bin, fast), b64);
+    ASSERT_EQ(mb::DecodeBase64Url(b64, fast), bin) << b64;
+    auto b58 = mb::EncodeBase58Btc(bin);
+    ASSERT_EQ(b58, ReferenceBase58(bin));
+    ASSERT_EQ(mb::DecodeBase58Btc(b58), bin) << b58;
+
+    // Arbitrary text: same verdict, and the same bytes if accepted.
+    std::string txt(rng() % 70U, ' ');
+    auto alphabet = round % 4 ? 32U : sizeof kSymbols - 1U;
+    for (auto& c : txt) {
+      c = kSymbols[rng() % alphabet];
+    }
+    EXPECT_EQ(mb::DecodeBase32(txt, fast),
+              mb::DecodeBase32(txt, mb::Kernel::kScalar))
+        << txt;
+    EXPECT_EQ(mb::DecodeBase64Url(txt, fast),
+              mb::DecodeBase64Url(txt, mb::Kernel::kScalar))
+        << txt;
+  }
+}
@@ -1,48 +1,108 @@
 #include "preferences.h"
 
+#include "affinity_bandit.h"
+#include "circuit_breaker.h"
+#include "gateway_journal.h"
+#include "gateway_latencies.h"
+#include "gateway_throttle.h"
+
 #include <ipfs_client/ctx/default_gateways.h>
-#include <ipfs_client/ctx/transitory_gateway_config.h>
 
 #include <base/logging.h>
 #include <base/debug/stack_trace.h>
+#include <base/task/bind_post_task.h>
 #include <base/task/thread_pool.h>
 #include <components/prefs/pref_registry_simple.h>
 #include <components/prefs/pref_service.h>
 #include <content/public/browser/browser_thread.h>
+#include <url/gurl.h>
 
+#include <algorithm>
+#include <cmath>
 #include <string_view>
 
 namespace {
   using namespace std::literals;
   auto constexpr kGateway = "ipfs.gateway"sv;
   auto constexpr kDnslinkFallback = "ipfs.dnslink.fallback_to_gateway"sv;
+  auto constexpr kDohResolvers = "ipfs.dnslink.doh_resolvers"sv;
   auto constexpr kDiscoveryRate = "ipfs.discovery.rate"sv;
   auto constexpr kDiscoveryOfUnencrypted = "ipfs.discovery.http"sv;
+  auto constexpr kHedging = "ipfs.hedging.enabled"sv;
+  auto constexpr kHedgeBudget = "ipfs.hedging.budget_percent"sv;
+
+  /*! Rate given to gateways found through the routing API */
+  auto constexpr kDefaultDiscoveryRate = 120;
 
   auto constexpr kRateKey = "max_requests_per_minute"sv;
+  auto constexpr kLatencyKey = "latency"sv;
+  auto constexpr kBreakerKey = "breaker"sv;
+  auto constexpr kBanditKey = "bandit"sv;
 
 base::Value::Dict AsJson(ipfs::GatewaySpec const&);
-}
+
+/*! Writes the static gateway list straight into a preferences dict,
+ *  rather than loading it somewhere and then probing index by index.
+ */
+class DefaultsCollector final : public ipfs::ctx::GatewayConfig {
+  base::Value::Dict& out_;
+
+ public:
+  explicit DefaultsCollector(base::Value::Dict& out) : out_{out} {}
+  unsigned GetGatewayRate(std::string_view k) override {
+    auto* d = out_.FindDict(k);
+    return static_cast<unsigned>(d ? d->FindInt(kRateKey).value_or(0) : 0);
+  }
+  void SetGatewayRate(std::string_view k, unsigned r) override {
+    if (auto* d = out_.FindDict(k)) {
+      d->Set(kRateKey, static_cast<int>(r));
+    }
+  }
+  std::optional<ipfs::GatewaySpec> GetGateway(std::size_t) const override {
+    return std::nullopt;
+  }
+  void AddGateway(std::string_view k, unsigned r) override {
+    DCHECK(!k.empty());
+    if (!out_.FindDict(k)) {
+      out_.Set(k, AsJson(ipfs::GatewaySpec{k, r}));
+    }
+  }
+  unsigned RoutingApiDiscoveryDefaultRate() const override {
+    return static_cast<unsigned>(kDefaultDiscoveryRate);
+  }
+  bool RoutingApiDiscoveryOfUnencryptedGateways() const override {
+    return true;
+  }
+  int GetTypeAffinity(std::string_view k,
+                      ipfs::gw::GatewayRequestType t) const override {
+    auto* d = out_.FindDict(k);
+    return d ? d->FindInt(name(t)).value_or(0) : 0;
+  }
+  void SetTypeAffinity(std::string_view k,
+                       ipfs::gw::GatewayRequestType t,
+                       int v) override {
+    if (auto* d = out_.FindDict(k)) {
+      d->Set(name(t), v);
+    }
+  }
+};
+}  // namespace
 
 void ipfs::RegisterPreferences(PrefRegistrySimple* registry) {
   LOG(WARNING) << "ipfs::RegisterPreferences(" << static_cast<void const*>(registry) << "):\n" <<
     base::debug::StackTrace();
-  ctx::TransitoryGatewayConfig cfg;
-  ctx::LoadStaticGatewayList(cfg);
   base::Value::Dict vals;
-  for (auto i = 0UL; i < 999UL; ++i) {
-    auto gw = cfg.GetGateway(i);
-    if (!gw) {
-      break;
-    }
-    DCHECK(!(gw->prefix.empty()));
-    //    vals.Set(gw->prefix, static_cast<int>(gw->rate));
-    vals.Set(gw->prefix, AsJson(*gw));
-  }
+  DefaultsCollector cfg{vals};
+  ctx::LoadStaticGatewayList(cfg);
   registry->RegisterDictionaryPref(kGateway, std::move(vals));
-  registry->RegisterIntegerPref(kDiscoveryRate, 120);
+  registry->RegisterIntegerPref(kDiscoveryRate, kDefaultDiscoveryRate);
   registry->RegisterBooleanPref(kDiscoveryOfUnencrypted, true);
   registry->RegisterBooleanPref(kDnslinkFallback, true);
+  // Opt-in: a resolver here sees every DNSLink name looked up, outside of
+  //   whatever the user chose for Secure DNS.
+  registry->RegisterListPref(kDohResolvers);
+  registry->RegisterBooleanPref(kHedging, true);
+  registry->RegisterIntegerPref(kHedgeBudget, 10);
 }
 bool ipfs::DnsFallbackPref(PrefService const* p) {
   if (!p) {
@@ -51,24 +111,68 @@ bool ipfs::DnsFallbackPref(PrefService const* p) {
   }
   return p->GetBoolean(kDnslinkFallback);
 }
+std::vector<std::string> ipfs::DohResolversPref(PrefService const* p) {
+  std::vector<std::string> rv;
+  if (!p) {
+    return rv;
+  }
+  for (auto& v : p->GetList(kDohResolvers)) {
+    if (auto* s = v.GetIfString(); s && GURL{*s}.SchemeIsHTTPOrHTTPS()) {
+      rv.push_back(*s);
+    }
+  }
+  return rv;
+}
+std::optional<double> ipfs::HedgeBudgetPref(PrefService const* p) {
+  if (!p || !p->GetBoolean(kHedging)) {
+    return std::nullopt;
+  }
+  return std::clamp(p->GetInteger(kHedgeBudget), 0, 100) / 100.0;
+}
 
 using Self = ipfs::ChromiumIpfsGatewayConfig;
-Self::ChromiumIpfsGatewayConfig(PrefService* prefs) : prefs_{prefs} {
+Self::ChromiumIpfsGatewayConfig(PrefService* prefs,
+                                GatewayLatencies& latencies,
+                                CircuitBreaker& breaker,
+                                AffinityBandit* bandit,
+                                GatewayThrottle* throttle,
+                                base::FilePath journal_dir)
+    : prefs_{prefs},
+      latencies_{&latencies},
+      breaker_{&breaker},
+      bandit_{bandit},
+      throttle_{throttle} {
   if (prefs) {
-    last_ = prefs->GetDict(kGateway).Clone();
-    curr_ = last_.Clone();
+    curr_ = prefs->GetDict(kGateway).Clone();
     for (auto [k, v] : curr_) {
       DCHECK(!k.empty());
+      if (auto* d = v.GetIfDict()) {
+        LoadScores(k, *d);
+      }
     }
   } else {
     LOG(ERROR)
         << "Reading preferences without a preferences service is not great.";
   }
+  Snapshot();
+  if (prefs && !journal_dir.empty()) {
+    loaded_ = curr_.Clone();
+    journal_ = std::make_unique<GatewayJournal>(journal_dir);
+    journal_->Replay(
+        base::BindOnce(&Self::Merge, weak_factory_.GetWeakPtr()));
+  } else {
+    replayed_ = true;
+  }
+}
+Self::~ChromiumIpfsGatewayConfig() noexcept {
+  MarkScoresDirty();
+  if (journal_ && !dirty_.empty()) {
+    Flush();
+  }
 }
 unsigned Self::GetGatewayRate(std::string_view k) {
-  if (auto* d = curr_.FindDict(k)) {
-    auto i = d->FindInt(kRateKey).value_or(0);
-    return static_cast<unsigned>(i);
+  if (auto p = position_.find(k); p != position_.end()) {
+    return snapshot_[p->second].spec.rate;
   }
   return 0U;
 }
@@ -81,82 +185,353 @@ void Self::SetGatewayRate(std::string_view k, unsigned val) {
     return;
   }
   auto i = std::min(static_cast<int>(val), INT_MAX);
-  d->Set(kRateKey, i);
-  if (++changes > update_thresh) {
-    auto delt = delta();
-    if (delt > update_thresh) {
-      save();
-    } else {
-      changes = delt / 2;
-    }
+  auto p = position_.find(k);
+  DCHECK(p != position_.end());
+  auto& e = snapshot_[p->second];
+  // While its breaker is open, requests there fail without being sent.
+  //   Don't let that wear the score down to nothing - it'll be back.
+  if (val < e.spec.rate && breaker_->IsOpen(e.key)) {
+    return;
   }
+  d->Set(kRateKey, i);
+  e.spec.rate = static_cast<unsigned>(i);
+  Enforce(e);
+  Reposition(p->second);
+  MarkDirty(k);
 }
 void Self::AddGateway(std::string_view k, unsigned r) {
   DCHECK(!k.empty());
   if (auto* d = curr_.FindDict(k)) {
-    d->Set(kRateKey, d->FindInt(kRateKey).value_or(r) + 1);
-  } else {
-    auto j = AsJson(GatewaySpec{k, r});
-    VLOG(2) << static_cast<void*>(this) << " Adding " << k << " @ " << r
-            << " = " << j;
-    curr_.Set(k, std::move(j));
+    auto rate = d->FindInt(kRateKey).value_or(static_cast<int>(r)) + 1;
+    d->Set(kRateKey, rate);
+    if (auto p = position_.find(k); p != position_.end()) {
+      snapshot_[p->second].spec.rate = static_cast<unsigned>(rate);
+      Enforce(snapshot_[p->second]);
+      Reposition(p->second);
+    }
+    MarkDirty(k);
+    return;
   }
+  auto j = AsJson(GatewaySpec{k, r});
+  VLOG(2) << static_cast<void*>(this) << " Adding " << k << " @ " << r
+          << " = " << j;
+  curr_.Set(k, std::move(j));
+  snapshot_.push_back(MakeEntry(k, r));
+  position_[std::string{k}] = snapshot_.size() - 1UL;
+  Reposition(snapshot_.size() - 1UL);
+  MarkDirty(k);
+}
+auto Self::MakeEntry(std::string_view prefix, unsigned rate) const -> Entry {
+  Entry e{GatewaySpec{prefix, rate}};
+  e.affinity = e.spec.request_type_affinity;
+  e.key = GatewayThrottle::GatewayKey(prefix);
+  e.ect = latencies_->ExpectedMillis(e.key, gw::GatewayRequestType::Block);
+  e.open = breaker_->IsOpen(e.key);
+  Enforce(e);
+  return e;
+}
+void Self::Enforce(Entry const& e) const {
+  // A score of 0 is still a (very slow) rate, not "unlimited".
+  if (throttle_) {
+    throttle_->SetRate(e.key, std::max(e.spec.rate, 1U));
+  }
+}
+void Self::Snapshot() {
+  snapshot_.clear();
+  for (auto [k, v] : curr_) {
+    auto* d = v.GetIfDict();
+    auto r = d ? std::max(0, d->FindInt(kRateKey).value_or(0)) : 0;
+    auto e = MakeEntry(k, static_cast<unsigned>(r));
+    if (!d) {
+      snapshot_.push_back(std::move(e));
+      continue;
+    }
+    // The only time affinities are parsed out of JSON.
+    for (auto [n, a] : *d) {
+      auto t = gw::from_name(n);
+      if (t && static_cast<std::size_t>(*t) < e.affinity.size()) {
+        e.affinity[static_cast<std::size_t>(*t)] = a.GetIfInt().value_or(0);
+      }
+    }
+    snapshot_.push_back(std::move(e));
+  }
+  Rank(true);
+}
+void Self::Rank(bool force) const {
+  auto lat_gen = latencies_->generation();
+  auto brk_gen = breaker_->generation();
+  auto now = base::TimeTicks::Now();
+  auto drew = Resample(now);
+  // Latencies change with every response; re-sorting that often buys little.
+  if (!force && !drew && brk_gen == breaker_gen_ &&
+      (lat_gen == latency_gen_ || now - ranked_at_ < kRerankInterval)) {
+    return;
+  }
+  for (auto& e : snapshot_) {
+    e.ect = latencies_->ExpectedMillis(e.key, gw::GatewayRequestType::Block);
+    e.open = breaker_->IsOpen(e.key);
+  }
+  for (auto t = 0UL; t < typical_ms_.size(); ++t) {
+    std::vector<double> known;
+    auto typ = static_cast<gw::GatewayRequestType>(t);
+    for (auto& e : snapshot_) {
+      if (auto ect = latencies_->ExpectedMillis(e.key, typ)) {
+        known.push_back(*ect);
+      }
+    }
+    typical_ms_[t] = std::nullopt;
+    if (!known.empty()) {
+      auto mid = known.begin() + static_cast<long>(known.size() / 2);
+      std::nth_element(known.begin(), mid, known.end());
+      typical_ms_[t] = *mid;
+    }
+  }
+  for (auto& e : snapshot_) {
+    ApplyBonus(e);
+  }
+  std::stable_sort(snapshot_.begin(), snapshot_.end(),
+                   [this](auto& a, auto& b) { return Before(a, b); });
+  position_.clear();
+  for (auto i = 0UL; i < snapshot_.size(); ++i) {
+    position_.emplace(snapshot_[i].spec.prefix, i);
+  }
+  latency_gen_ = lat_gen;
+  breaker_gen_ = brk_gen;
+  ranked_at_ = now;
+}
+bool Self::Before(Entry const& a, Entry const& b) const {
+  if (a.open != b.open) {
+    return b.open;
+  }
+  // Gateways we haven't timed yet are presumed typical, not best or worst.
+  auto typical = typical_ms_[static_cast<std::size_t>(
+                                 gw::GatewayRequestType::Block)]
+                     .value_or(0.0);
+  auto ae = a.ect.value_or(typical);
+  auto be = b.ect.value_or(typical);
+  if (ae != be) {
+    return ae < be;
+  }
+  return a.spec.rate > b.spec.rate;
+}
+void Self::Reposition(std::size_t i) const {
+  // Only this one entry changed, so it need only slide to its new place.
+  auto lo = i;
+  while (lo > 0UL && Before(snapshot_[i], snapshot_[lo - 1UL])) {
+    --lo;
+  }
+  auto hi = i;
+  while (hi + 1UL < snapshot_.size() && Before(snapshot_[hi + 1UL], snapshot_[i])) {
+    ++hi;
+  }
+  auto first = snapshot_.begin();
+  if (lo < i) {
+    std::rotate(first + static_cast<long>(lo), first + static_cast<long>(i),
+                first + static_cast<long>(i + 1UL));
+  } else if (hi > i) {
+    std::rotate(first + static_cast<long>(i), first + static_cast<long>(i + 1UL),
+                first + static_cast<long>(hi + 1UL));
+  }
+  for (auto j = std::min(lo, i); j <= std::max(hi, i); ++j) {
+    position_[snapshot_[j].spec.prefix] = j;
+  }
+}
+void Self::ApplyBonus(Entry& e) const {
+  for (auto t = 0UL; t < e.affinity.size(); ++t) {
+    e.spec.request_type_affinity[t] =
+        e.affinity[t] + e.drawn[t] +
+        LatencyBonus(e.key, static_cast<gw::GatewayRequestType>(t));
+  }
+}
+int Self::LatencyBonus(std::string_view key, gw::GatewayRequestType typ) const {
+  auto t = static_cast<std::size_t>(typ);
+  if (t >= typical_ms_.size() || !typical_ms_[t]) {
+    return 0;
+  }
+  auto mine = latencies_->ExpectedMillis(key, typ);
+  if (!mine) {
+    return 0;
+  }
+  // +1 per halving of the typical time, -1 per doubling; capped.
+  auto b = std::log2(std::max(*typical_ms_[t], 1.0) / std::max(*mine, 1.0));
+  return std::clamp(static_cast<int>(std::lround(b)), -3, 3);
 }
 auto Self::GetGateway(std::size_t index) const -> std::optional<GatewaySpec> {
-  if (index >= curr_.size()) {
+  Rank();
+  if (index >= snapshot_.size()) {
     return std::nullopt;
   }
-  auto it = std::next(curr_.cbegin(), index);
-  auto* p_k = &(it->first);
-  DCHECK(!(p_k->empty()));
-  auto* vals = it->second.GetIfDict();
-  if (!vals) {
-    LOG(WARNING) << "Gateway values were not Dict!!";
-    return std::nullopt;
+  return snapshot_[index].spec;
+}
+void Self::LoadScores(std::string_view k, base::Value::Dict const& d) {
+  auto gk = GatewayThrottle::GatewayKey(k);
+  if (auto* lat = d.FindDict(kLatencyKey)) {
+    latencies_->Load(gk, *lat);
+    latency_saved_[gk] = latencies_->generation(gk);
   }
-  auto i = std::max(0, vals->FindInt(kRateKey).value_or(0));
-  GatewaySpec result{*p_k, static_cast<unsigned>(i)};
-  DCHECK_EQ(result.prefix, *p_k);
-  for (auto [k, v] : *vals) {
-    if (auto t = gw::from_name(k)) {
-      auto idx = static_cast<int>(*t);
-      if (idx < static_cast<int>(result.request_type_affinity.size())) {
-        result.request_type_affinity[idx] = v.GetInt();
-      }
+  if (auto* brk = d.FindDict(kBreakerKey)) {
+    breaker_->Load(gk, *brk);
+  }
+  if (auto* arms = d.FindDict(kBanditKey); arms && bandit_) {
+    bandit_->Load(gk, *arms);
+    bandit_saved_[gk] = bandit_->generation(gk);
+  }
+}
+void Self::AddScores(std::string_view k, base::Value::Dict& d) const {
+  auto gk = GatewayThrottle::GatewayKey(k);
+  if (auto lat = latencies_->ToDict(gk); !lat.empty()) {
+    d.Set(kLatencyKey, std::move(lat));
+  }
+  latency_saved_[gk] = latencies_->generation(gk);
+  if (auto brk = breaker_->ToDict(gk); !brk.empty()) {
+    d.Set(kBreakerKey, std::move(brk));
+  } else {
+    d.Remove(kBreakerKey);
+  }
+  if (!bandit_) {
+    return;
+  }
+  if (auto arms = bandit_->ToDict(gk); !arms.empty()) {
+    d.Set(kBanditKey, std::move(arms));
+  }
+  bandit_saved_[gk] = bandit_->generation(gk);
+}
+bool Self::Resample(base::TimeTicks now) const {
+  if (!bandit_ || bandit_->generation() == bandit_gen_ ||
+      now - sampled_at_ < kRerankInterval) {
+    return false;
+  }
+  bandit_gen_ = bandit_->generation();
+  sampled_at_ = now;
+  // A fresh Thompson draw for every arm: the winners mostly stay on top, but
+  //   uncertain gateways get their turn often enough to be learned about.
+  //   Only the ranking sees the draws; what's configured stays as it was.
+  for (auto& e : snapshot_) {
+    for (auto t = 0UL; t < kRequestTypes; ++t) {
+      auto v = bandit_->Sample(e.key, static_cast<gw::GatewayRequestType>(t));
+      e.drawn[t] = v.value_or(0);
     }
   }
-  return result;
+  return true;
 }
-std::size_t Self::delta() const {
-  std::size_t rv = 0;
-  for (auto [k, v] : curr_) {
-    int c = 0;
-    int p = 0;
-    if (auto* curr_dict = v.GetIfDict()) {
-      c = curr_dict->FindInt(kRateKey).value_or(0);
+void Self::MarkDirty(std::string_view k) {
+  if (!replayed_) {
+    touched_.emplace(k);
+  }
+  dirty_.emplace(k);
+  if (!flush_timer_.IsRunning()) {
+    flush_timer_.Start(FROM_HERE, kFlushDelay,
+                       base::BindOnce(&Self::Flush, base::Unretained(this)));
+  }
+}
+void Self::MarkScoresDirty() {
+  // Latencies & bandit arms are updated without going through here, so look
+  //   for gateways whose scores moved since they were last written. The
+  //   scheduler sets a rate with each response, so a flush is always due
+  //   soon after; and a busy gateway is rewritten at most once per flush.
+  auto stale = [](auto const& saved, std::string const& key, std::size_t gen) {
+    auto s = saved.find(key);
+    return gen && (s == saved.end() || s->second != gen);
+  };
+  for (auto& e : snapshot_) {
+    if (stale(latency_saved_, e.key, latencies_->generation(e.key)) ||
+        (bandit_ && stale(bandit_saved_, e.key, bandit_->generation(e.key)))) {
+      dirty_.emplace(e.spec.prefix);
     }
-    if (auto* prev_dict = last_.FindDict(k)) {
-      p = prev_dict->FindInt(kRateKey).value_or(0);
+  }
+}
+void Self::Flush() {
+  flush_timer_.Stop();
+  MarkScoresDirty();
+  if (!journal_) {
+    Compact();
+    return;
+  }
+  // Only what changed, however many gateways there are in total.
+  base::Value::Dict changes;
+  for (auto& k : dirty_) {
+    if (auto* d = curr_.FindDict(k)) {
+      auto entry = d->Clone();
+      AddScores(k, entry);
+      changes.Set(k, std::move(entry));
     }
-    auto off = std::abs(c - p);
-    rv += static_cast<std::size_t>(off);
   }
-  return rv;
+  dirty_.clear();
+  journal_->Append(std::move(changes));
+  if (journal_->records() >= kCompactAfter && !saving_) {
+    Compact();
+  }
 }
-void Self::save() {
-  // Should be called on UI thread
-  changes = 0;
-  last_ = curr_.Clone();
-  update_thresh++;
-  //  void (*f)(PrefService*, base::Value::Dict) = ;
+void Self::Compact() {
+  flush_timer_.Stop();
+  dirty_.clear();
+  if (!prefs_) {
+    return;
+  }
+  for (auto [k, v] : curr_) {
+    if (auto* d = v.GetIfDict()) {
+      AddScores(k, *d);
+    }
+  }
+  VLOG(1) << "Writing all " << curr_.size() << " gateways to preferences.";
+  // The journal may only go once what it holds is on disk elsewhere. Until
+  //   then it's set aside, still to be replayed if the write never happens.
+  base::OnceClosure saved;
+  if (journal_) {
+    journal_->Rotate();
+    saving_ = true;
+    saved = base::BindPostTaskToCurrentDefault(
+        base::BindOnce(&Self::Saved, weak_factory_.GetWeakPtr()));
+  }
   auto cb = base::BindOnce(
-      [](PrefService* prefs, base::Value::Dict to_save) {
+      [](PrefService* prefs, base::Value::Dict to_save,
+         base::OnceClosure saved) {
         prefs->SetDict(kGateway, std::move(to_save));
+        prefs->CommitPendingWrite(std::move(saved));
       },
-      prefs_.get(), last_.Clone());
-  // base::MayBlock(), base::TaskShutdownBehavior::SKIP_ON_SHUTDOWN
+      prefs_.get(), curr_.Clone(), std::move(saved));
   content::GetUIThreadTaskRunner({})->PostTask(FROM_HERE, std::move(cb));
 }
+void Self::Saved() {
+  saving_ = false;
+  journal_->DropRotated();
+}
+void Self::Merge(base::Value::Dict replayed) {
+  replayed_ = true;
+  for (auto [k, v] : replayed) {
+    auto* d = v.GetIfDict();
+    if (!d) {
+      continue;
+    }
+    auto* now = curr_.FindDict(k);
+    if (!touched_.contains(k) || !now) {
+      LoadScores(k, *d);
+      curr_.Set(k, std::move(v));
+      continue;
+    }
+    // Changed since startup, but starting from the stale preference rather
+    //   than the journal. Redo the change on top of the journal's entry.
+    //   Its scores are left alone: the live ones are newer.
+    auto* was = loaded_.FindDict(k);
+    auto rate = d->FindInt(kRateKey).value_or(0);
+    if (was) {
+      rate += now->FindInt(kRateKey).value_or(0) -
+              was->FindInt(kRateKey).value_or(0);
+    }
+    d->Set(kRateKey, std::max(rate, 0));
+    for (auto t = 0UL; t < kRequestTypes; ++t) {
+      auto nm = name(static_cast<gw::GatewayRequestType>(t));
+      auto a = now->FindInt(nm);
+      if (a && (!was || was->FindInt(nm) != a)) {
+        d->Set(nm, *a);
+      }
+    }
+    curr_.Set(k, std::move(v));
+  }
+  touched_.clear();
+  loaded_.clear();
+  Snapshot();
+}
 unsigned Self::RoutingApiDiscoveryDefaultRate() const {
   auto i = prefs_->GetInteger(kDiscoveryRate);
   return static_cast<unsigned>(i);
@@ -166,8 +541,10 @@ bool Self::RoutingApiDiscoveryOfUnencryptedGateways() const {
 }
 int Self::GetTypeAffinity(std::string_view url_prefix,
                           gw::GatewayRequestType typ) const {
-  if (auto* d = curr_.FindDict(url_prefix)) {
-    return d->FindInt(name(typ)).value_or(0);
+  auto t = static_cast<std::size_t>(typ);
+  if (auto p = position_.find(url_prefix);
+      p != position_.end() && t < kRequestTypes) {
+    return snapshot_[p->second].affinity[t];
   }
   return 0;
 }
@@ -177,6 +554,15 @@ void Self::SetTypeAffinity(std::string_view url_prefix,
   auto nm = name(typ);
   if (auto* d = curr_.FindDict(url_prefix)) {
     d->Set(nm, val);
+    MarkDirty(url_prefix);
+  }
+  auto t = static_cast<std::size_t>(typ);
+  if (auto p = position_.find(url_prefix);
+      p != position_.end() && t < kRequestTypes) {
+    auto& e = snapshot_[p->second];
+    e.affinity[t] = val;
+    e.spec.request_type_affinity[t] =
+        val + e.drawn[t] + LatencyBonus(e.key, typ);
   }
 }
 
@@ -3,17 +3,33 @@
 
 #include "export.h"
 
+#include <base/files/file_path.h>
 #include <base/memory/raw_ptr.h>
+#include <base/memory/weak_ptr.h>
+#include <base/time/time.h>
+#include <base/timer/timer.h>
 #include <base/values.h>
 
 #include <ipfs_client/ctx/gateway_config.h>
 
+#include <array>
+#include <map>
+#include <memory>
+#include <optional>
 #include <ranges>
+#include <set>
+#include <string>
+#include <vector>
 
 class PrefRegistrySimple;
 class PrefService;
 
 namespace ipfs {
+class AffinityBandit;
+class CircuitBreaker;
+class GatewayJournal;
+class GatewayLatencies;
+class GatewayThrottle;
 
 /*!
  *  \brief Register IPFS-specific preferences
@@ -22,27 +38,118 @@ namespace ipfs {
 COMPONENT_EXPORT(IPFS) void RegisterPreferences(PrefRegistrySimple*);
 bool DnsFallbackPref(PrefService const*);
 
+/*! \return DNS-over-HTTPS JSON endpoints to ask for DNSLink records,
+ *    alongside the system resolver. May be empty.
+ */
+std::vector<std::string> DohResolversPref(PrefService const*);
+
+/*! \return The fraction of extra (hedge) requests allowed,
+ *    or nullopt if the scheduler's fan-out should be left alone.
+ */
+std::optional<double> HedgeBudgetPref(PrefService const*);
+
 /*! Configuration of gateways using Chromium preferences
  */
 class ChromiumIpfsGatewayConfig final : public ipfs::ctx::GatewayConfig {
   raw_ptr<PrefService> prefs_;
-  base::Value::Dict last_;
+  raw_ptr<GatewayLatencies> latencies_;
+  raw_ptr<CircuitBreaker> breaker_;
+  raw_ptr<AffinityBandit> bandit_;
+  raw_ptr<GatewayThrottle> throttle_;
   base::Value::Dict curr_;
-  std::size_t changes = 0;
-  std::size_t update_thresh = 1;
+  std::unique_ptr<GatewayJournal> journal_;
+  /*! Prefixes changed since the last journal write */
+  std::set<std::string, std::less<>> dirty_;
+  /*! Prefixes changed before the journal was replayed, which it mustn't undo */
+  std::set<std::string, std::less<>> touched_;
+  /*! curr_ as read from preferences, until the journal is replayed */
+  base::Value::Dict loaded_;
+  bool replayed_ = false;
+  /*! A rotated journal awaits the preference write it was compacted into */
+  bool saving_ = false;
+  /*! GatewayLatencies::generation(key) as of its last write */
+  mutable std::map<std::string, std::size_t, std::less<>> latency_saved_;
+  /*! AffinityBandit::generation(key) as of its last write */
+  mutable std::map<std::string, std::size_t, std::less<>> bandit_saved_;
+  base::OneShotTimer flush_timer_;
+  /*! Changes are batched up for this long before being written */
+  static constexpr base::TimeDelta kFlushDelay = base::Seconds(5);
+  /*! Journal records before folding it all back into preferences */
+  static constexpr std::size_t kCompactAfter = 256UL;
+  static constexpr std::size_t kRequestTypes =
+      std::tuple_size_v<decltype(GatewaySpec::request_type_affinity)>;
+  /*! Don't re-sort for latency changes more often than this */
+  static constexpr base::TimeDelta kRerankInterval = base::Seconds(1);
 
-  void save();
-  std::size_t delta() const;
+  /*! A gateway as handed to the scheduler, plus what it's ranked by */
+  struct Entry {
+    GatewaySpec spec;  ///< Affinities here include the latency bonus
+    decltype(GatewaySpec::request_type_affinity) affinity{};  ///< As set
+    decltype(affinity) drawn{};  ///< The bandit's latest draw, never saved
+    std::string key;  ///< \see GatewayThrottle::GatewayKey
+    std::optional<double> ect;
+    bool open = false;
+  };
+  /*! Ordered as GetGateway indexes them, so that's O(1) */
+  mutable std::vector<Entry> snapshot_;
+  /*! prefix -> index in snapshot_ */
+  mutable std::map<std::string, std::size_t, std::less<>> position_;
+  mutable std::size_t latency_gen_ = 0;
+  mutable std::size_t breaker_gen_ = 0;
+  mutable base::TimeTicks ranked_at_;
+  mutable std::size_t bandit_gen_ = 0;
+  mutable base::TimeTicks sampled_at_;
+  mutable std::array<std::optional<double>, kRequestTypes> typical_ms_;
+
+  /*! \return Whether there were fresh draws, so ranks need redoing */
+  bool Resample(base::TimeTicks now) const;
+  void Enforce(Entry const&) const;
+  void MarkDirty(std::string_view prefix);
+  void MarkScoresDirty();
+  void Flush();
+  void Compact();
+  void Saved();
+  void Merge(base::Value::Dict replayed);
+  void LoadScores(std::string_view prefix, base::Value::Dict const&);
+  void AddScores(std::string_view prefix, base::Value::Dict&) const;
+  Entry MakeEntry(std::string_view prefix, unsigned rate) const;
+  void Snapshot();
+  void Rank(bool force = false) const;
+  bool Before(Entry const&, Entry const&) const;
+  void Reposition(std::size_t) const;
+  void ApplyBonus(Entry&) const;
+  int LatencyBonus(std::string_view key, gw::GatewayRequestType) const;
 
  public:
 
   /*! \brief construct
    *  \param prefs The underlying preference service for persisting configuration
+   *  \param latencies Observed gateway speeds, restored from & saved to prefs
+   *  \param breaker Which gateways are down, restored from & saved to prefs
+   *  \param bandit If not null, draws from it are added to the configured
+   *    type affinities as it learns. Its posteriors are persisted too.
+   *  \param throttle If not null, told each gateway's rate, to enforce
+   *  \param journal_dir Where to journal score changes between (infrequent)
+   *    writes of the whole ipfs.gateway preference. Empty for no journal.
    */
-  ChromiumIpfsGatewayConfig(PrefService* prefs);
+  ChromiumIpfsGatewayConfig(PrefService* prefs,
+                            GatewayLatencies& latencies,
+                            CircuitBreaker& breaker,
+                            AffinityBandit* bandit,
+                            GatewayThrottle* throttle,
+                            base::FilePath journal_dir);
+  ~ChromiumIpfsGatewayConfig() noexcept override;
 
   unsigned GetGatewayRate(std::string_view) override;
   void SetGatewayRate(std::string_view, unsigned) override;
+
+  /*! \brief Get a gateway by index
+   *  \details Gateways are indexed fastest-first by expected completion
+   *    time, those whose circuit breaker is open last, and per-type
+   *    affinities include a bonus/penalty for being faster/slower than
+   *    typical at that type of request. Served from a snapshot kept in order
+   *    as rates change, so iterating over all gateways is O(n).
+   */
   std::optional<GatewaySpec> GetGateway(std::size_t index) const override;
   void AddGateway(std::string_view, unsigned) override;
   //  std::pair<std::string const*, unsigned> at(std::size_t index) const;
@@ -53,6 +160,9 @@ class ChromiumIpfsGatewayConfig final : public ipfs::ctx::GatewayConfig {
   void SetTypeAffinity(std::string_view url_prefix,
                        gw::GatewayRequestType,
                        int) override;
+
+ private:
+  base::WeakPtrFactory<ChromiumIpfsGatewayConfig> weak_factory_{this};
 };
 }
 
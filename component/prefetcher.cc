@@ -0,0 +1,146 @@
+#include "prefetcher.h"
+
+#include <base/functional/bind.h>
+#include <base/logging.h>
+#include <base/task/sequenced_task_runner.h>
+#include <url/gurl.h>
+
+#include <algorithm>
+
+using Self = ipfs::Prefetcher;
+
+namespace {
+/*! Forget about prefetches done longer ago than kRecent past this many */
+constexpr std::size_t kMaxRecent = 64UL;
+}  // namespace
+
+Self::Prefetcher(Launch launch, scoped_refptr<base::SequencedTaskRunner> idle)
+    : launch_{std::move(launch)}, idle_{std::move(idle)} {}
+Self::~Prefetcher() noexcept {
+  CancelAll();
+}
+
+bool Self::Prefetch(GURL const& url) {
+  auto root = RootOf(url);
+  if (!root) {
+    return false;
+  }
+  auto now = base::TimeTicks::Now();
+  if (running_.contains(*root) ||
+      std::ranges::find(queued_, *root) != queued_.end()) {
+    return true;
+  }
+  if (auto it = recent_.find(*root);
+      it != recent_.end() && now - it->second < kRecent) {
+    return true;
+  }
+  if (OverBudget(now)) {
+    VLOG(2) << "Not prefetching " << *root << ": over budget.";
+    return false;
+  }
+  queued_.push_back(*root);
+  if (queued_.size() > kMaxQueued) {
+    queued_.pop_front();
+  }
+  SchedulePump();
+  return true;
+}
+void Self::Cancel(GURL const& url) {
+  auto root = RootOf(url);
+  if (!root) {
+    return;
+  }
+  std::erase(queued_, *root);
+  auto node = running_.extract(*root);
+  if (!node.empty()) {
+    VLOG(2) << "Prefetch of " << *root << " cancelled.";
+    Stop(node.mapped());
+  }
+}
+void Self::CancelAll() {
+  queued_.clear();
+  for (auto& [root, r] : std::exchange(running_, {})) {
+    Stop(r);
+  }
+}
+void Self::Stop(Running& r) {
+  if (auto it = std::ranges::find(spent_, r.started); it != spent_.end()) {
+    spent_.erase(it);
+  }
+  if (r.stop) {
+    std::move(r.stop).Run();
+  }
+}
+auto Self::RootOf(GURL const& url) -> std::optional<std::string> {
+  if (!url.is_valid() || !(url.SchemeIs("ipfs") || url.SchemeIs("ipns")) ||
+      url.host().empty()) {
+    return std::nullopt;
+  }
+  std::string rv{"/"};
+  rv.append(url.scheme()).append("/").append(url.host()).append("/");
+  return rv;
+}
+bool Self::OverBudget(base::TimeTicks now) {
+  while (!spent_.empty() && now - spent_.front() >= kBudgetWindow) {
+    spent_.pop_front();
+  }
+  return spent_.size() >= kBudget;
+}
+void Self::SchedulePump() {
+  if (pump_posted_) {
+    return;
+  }
+  pump_posted_ = true;
+  idle_->PostTask(FROM_HERE,
+                  base::BindOnce(&Self::Pump, weak_factory_.GetWeakPtr()));
+}
+void Self::Pump() {
+  pump_posted_ = false;
+  auto now = base::TimeTicks::Now();
+  while (running_.size() < kMaxRunning && !queued_.empty() &&
+         !OverBudget(now)) {
+    auto root = std::move(queued_.back());
+    queued_.pop_back();
+    spent_.push_back(now);
+    VLOG(1) << "Prefetching " << root;
+    running_.try_emplace(root).first->second.started = now;
+    auto stop = launch_(
+        root, base::BindOnce(&Self::Finish, weak_factory_.GetWeakPtr(), root));
+    auto it = running_.find(root);
+    if (it == running_.end()) {
+      // Finished already, e.g. everything was cached.
+      if (stop) {
+        std::move(stop).Run();
+      }
+      continue;
+    }
+    if (!stop) {
+      running_.erase(it);
+      continue;
+    }
+    it->second.stop = std::move(stop);
+    // Unretained: the timer belongs to this.
+    it->second.deadline.Start(
+        FROM_HERE, kTimeout,
+        base::BindOnce(&Self::Finish, base::Unretained(this), root));
+  }
+}
+void Self::Finish(std::string const& root) {
+  auto node = running_.extract(root);
+  if (node.empty()) {
+    return;
+  }
+  auto now = base::TimeTicks::Now();
+  if (recent_.size() >= kMaxRecent) {
+    std::erase_if(recent_,
+                  [now](auto& e) { return now - e.second >= kRecent; });
+  }
+  recent_[root] = now;
+  if (node.mapped().stop) {
+    std::move(node.mapped().stop).Run();
+  }
+  SchedulePump();
+}
+
+Self::Running::Running() = default;
+Self::Running::~Running() noexcept = default;
@@ -0,0 +1,107 @@
+#ifndef IPFS_PREFETCHER_H_
+#define IPFS_PREFETCHER_H_
+
+#include <base/functional/callback.h>
+#include <base/memory/scoped_refptr.h>
+#include <base/memory/weak_ptr.h>
+#include <base/time/time.h>
+#include <base/timer/timer.h>
+
+#include <deque>
+#include <functional>
+#include <map>
+#include <optional>
+#include <string>
+
+class GURL;
+
+namespace base {
+class SequencedTaskRunner;
+}
+
+namespace ipfs {
+
+/*! Speculatively resolves names & fetches root blocks of likely navigations
+ *  \details Meant to be told about ipfs:// & ipns:// URLs the user may be
+ *    about to visit: the omnibox's default match, a hovered link, a preload
+ *    hint. For each, the root of the URL (e.g. ipns://example.com/) is loaded
+ *    the same way a navigation would load it, but the response is thrown
+ *    away. What's left behind is the DNSLink/IPNS resolution and root
+ *    block(s) in the caches, or in flight to be joined by the navigation.
+ *    Work starts at BEST_EFFORT task priority, only so many at once, and
+ *    only so many per minute. Each has a deadline and can be cancelled; one
+ *    cancelled before it's done isn't counted against the per-minute budget.
+ */
+class Prefetcher {
+ public:
+  /*! Called when a launched prefetch has finished, whatever the outcome */
+  using Done = base::OnceClosure;
+  /*! \brief Start loading a root path, e.g. /ipns/example.com/
+   *  \return Stops it, and cleans up. Null if it couldn't be started.
+   */
+  using Launch = std::function<base::OnceClosure(std::string const&, Done)>;
+
+  /*! Prefetches running at once */
+  static constexpr std::size_t kMaxRunning = 2UL;
+  /*! Waiting to run: the most recent hint is the most relevant */
+  static constexpr std::size_t kMaxQueued = 4UL;
+  /*! Prefetches started per kBudgetWindow */
+  static constexpr std::size_t kBudget = 10UL;
+  static constexpr base::TimeDelta kBudgetWindow = base::Minutes(1);
+  /*! Give up on one after this long */
+  static constexpr base::TimeDelta kTimeout = base::Seconds(15);
+  /*! Don't prefetch the same root again this soon (a DNSLink TTL, roughly) */
+  static constexpr base::TimeDelta kRecent = base::Minutes(5);
+
+  /*! \param launch Does the work
+   *  \param idle Where launches are posted, at low priority
+   */
+  Prefetcher(Launch launch, scoped_refptr<base::SequencedTaskRunner> idle);
+  ~Prefetcher() noexcept;
+
+  Prefetcher(Prefetcher const&) = delete;
+  Prefetcher& operator=(Prefetcher const&) = delete;
+
+  /*! \brief Hint that url may be navigated to soon
+   *  \return false if it won't be prefetched: not IPFS, or over budget
+   */
+  bool Prefetch(GURL const& url);
+  /*! \brief The hint no longer applies, e.g. the pointer left the link */
+  void Cancel(GURL const& url);
+  void CancelAll();
+
+  /*! \return e.g. "/ipfs/bafy.../" for ipfs://bafy.../a/b.html */
+  static std::optional<std::string> RootOf(GURL const&);
+
+  std::size_t running() const { return running_.size(); }
+  std::size_t queued() const { return queued_.size(); }
+
+ private:
+  struct Running {
+    Running();
+    ~Running() noexcept;
+    base::OnceClosure stop;
+    base::OneShotTimer deadline;
+    /*! Its entry in spent_ */
+    base::TimeTicks started;
+  };
+  Launch launch_;
+  scoped_refptr<base::SequencedTaskRunner> idle_;
+  std::map<std::string, Running> running_;
+  std::deque<std::string> queued_;
+  /*! When each prefetch within the budget window was started */
+  std::deque<base::TimeTicks> spent_;
+  std::map<std::string, base::TimeTicks> recent_;
+  bool pump_posted_ = false;
+  base::WeakPtrFactory<Prefetcher> weak_factory_{this};
+
+  bool OverBudget(base::TimeTicks now);
+  void SchedulePump();
+  void Pump();
+  void Finish(std::string const& root);
+  /*! A prefetch stopped before it got anywhere gives back its budget */
+  void Stop(Running&);
+};
+}  // namespace ipfs
+
+#endif  // IPFS_PREFETCHER_H_
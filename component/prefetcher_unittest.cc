@@ -0,0 +1,128 @@
+#include "prefetcher.h"
+
+#include <base/run_loop.h>
+#include <base/task/sequenced_task_runner.h>
+#include <base/test/bind.h>
+#include <base/test/task_environment.h>
+#include <url/gurl.h>
+
+#include <gtest/gtest.h>
+
+#include <map>
+#include <string>
+#include <vector>
+
+using P = ipfs::Prefetcher;
+
+namespace {
+class PrefetcherTest : public testing::Test {
+ protected:
+  /*! Pretends to load, until told it's done or stopped */
+  base::OnceClosure Launch(std::string const& root, P::Done done) {
+    launched_.push_back(root);
+    done_[root] = std::move(done);
+    return base::BindLambdaForTesting([this]() { ++stopped_; });
+  }
+  void Complete(std::string const& root) {
+    std::move(done_.at(root)).Run();
+    base::RunLoop().RunUntilIdle();
+  }
+  bool Hint(std::string const& url) {
+    auto rv = prefetcher_.Prefetch(GURL{url});
+    base::RunLoop().RunUntilIdle();
+    return rv;
+  }
+
+  base::test::TaskEnvironment env_{
+      base::test::TaskEnvironment::TimeSource::MOCK_TIME};
+  std::vector<std::string> launched_;
+  std::map<std::string, P::Done> done_;
+  int stopped_ = 0;
+  P prefetcher_{[this](std::string const& r,
+                       P::Done d) { return Launch(r, std::move(d)); },
+                base::SequencedTaskRunner::GetCurrentDefault()};
+};
+}  // namespace
+
+TEST_F(PrefetcherTest, RootOf) {
+  EXPECT_EQ(P::RootOf(GURL{"ipns://example.com/a/b.html?q#f"}),
+            "/ipns/example.com/");
+  // Not a CID at all would get canonicalized into an error message.
+  EXPECT_EQ(P::RootOf(GURL{"ipfs://bafkreigh2akiscaildcqabsyg3dfr6chu3fgpre"
+                           "giymsck7e7aqa4s52zy"}),
+            "/ipfs/bafkreigh2akiscaildcqabsyg3dfr6chu3fgpregiymsck7e7aqa4s52zy/");
+  EXPECT_FALSE(P::RootOf(GURL{"https://example.com/"}));
+}
+
+TEST_F(PrefetcherTest, OncePerRootAndNotForOtherSchemes) {
+  EXPECT_FALSE(Hint("https://example.com/"));
+  EXPECT_TRUE(Hint("ipns://example.com/"));
+  EXPECT_TRUE(Hint("ipns://example.com/other/page.html"));
+  ASSERT_EQ(launched_.size(), 1UL);
+  EXPECT_EQ(launched_.front(), "/ipns/example.com/");
+
+  Complete("/ipns/example.com/");
+  EXPECT_EQ(stopped_, 1);
+  EXPECT_TRUE(Hint("ipns://example.com/"));
+  EXPECT_EQ(launched_.size(), 1UL) << "Recently prefetched";
+  env_.FastForwardBy(P::kRecent);
+  EXPECT_TRUE(Hint("ipns://example.com/"));
+  EXPECT_EQ(launched_.size(), 2UL);
+}
+
+TEST_F(PrefetcherTest, LimitedConcurrencyNewestFirst) {
+  for (auto h : {"ipns://a.example", "ipns://b.example", "ipns://c.example",
+                 "ipns://d.example"}) {
+    prefetcher_.Prefetch(GURL{h});
+  }
+  base::RunLoop().RunUntilIdle();
+  ASSERT_EQ(prefetcher_.running(), P::kMaxRunning);
+  EXPECT_EQ(launched_.at(0), "/ipns/d.example/");
+  EXPECT_EQ(launched_.at(1), "/ipns/c.example/");
+  Complete("/ipns/d.example/");
+  EXPECT_EQ(launched_.size(), 3UL);
+  EXPECT_EQ(launched_.back(), "/ipns/b.example/");
+}
+
+TEST_F(PrefetcherTest, CancelAndTimeout) {
+  Hint("ipns://a.example");
+  Hint("ipfs://bafyexample/x");
+  EXPECT_EQ(prefetcher_.running(), 2UL);
+  prefetcher_.Cancel(GURL{"ipns://a.example/whatever"});
+  EXPECT_EQ(stopped_, 1);
+  EXPECT_EQ(prefetcher_.running(), 1UL);
+  env_.FastForwardBy(P::kTimeout);
+  EXPECT_EQ(stopped_, 2);
+  EXPECT_EQ(prefetcher_.running(), 0UL);
+}
+
+TEST_F(PrefetcherTest, Budget) {
+  for (auto i = 0UL; i < P::kBudget; ++i) {
+    EXPECT_TRUE(Hint("ipns://h" + std::to_string(i) + ".example"));
+    Complete(launched_.back());
+  }
+  EXPECT_FALSE(Hint("ipns://one-too-many.example"));
+  EXPECT_EQ(launched_.size(), P::kBudget);
+  env_.FastForwardBy(P::kBudgetWindow);
+  EXPECT_TRUE(Hint("ipns://one-too-many.example"));
+  EXPECT_EQ(launched_.size(), P::kBudget + 1UL);
+}
+
+TEST_F(PrefetcherTest, CancelledBeforeDoneCostsNothing) {
+  // Typing a name out, one hint per keystroke, each replacing the last.
+  for (auto i = 0UL; i < P::kBudget * 2UL; ++i) {
+    auto url = "ipns://e" + std::string(i, 'x') + ".example";
+    EXPECT_TRUE(Hint(url)) << i;
+    prefetcher_.Cancel(GURL{url});
+  }
+  EXPECT_EQ(launched_.size(), P::kBudget * 2UL);
+  EXPECT_EQ(prefetcher_.running(), 0UL);
+  // Timed out isn't cancelled: it was sent and never answered.
+  Hint("ipns://slow.example");
+  env_.FastForwardBy(P::kTimeout);
+  for (auto i = 1UL; i < P::kBudget; ++i) {
+    EXPECT_TRUE(Hint("ipns://h" + std::to_string(i) + ".example"));
+    Complete(launched_.back());
+  }
+  EXPECT_FALSE(Hint("ipns://one-too-many.example"));
+}
@@ -0,0 +1,543 @@
+#include "structural_json_parser.h"
+
+#include <base/json/json_reader.h>
+#include <base/logging.h>
+#include <base/strings/string_util.h>
+#include <base/strings/utf_string_conversion_utils.h>
+#include <build/build_config.h>
+
+#include <ipfs_client/dag_json_value.h>
+
+#if defined(ARCH_CPU_X86_FAMILY)
+#include <emmintrin.h>
+#elif defined(ARCH_CPU_ARM64)
+#include <arm_neon.h>
+#endif
+
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <limits>
+#include <memory>
+
+using Self = ipfs::StructuralJsonParser;
+
+namespace {
+constexpr std::size_t kBlock = 64UL;
+constexpr std::string_view kByteOrderMark = "\xEF\xBB\xBF";
+
+/*! One bit per byte of a block */
+struct Masks {
+  std::uint64_t quote = 0U;
+  std::uint64_t backslash = 0U;
+  std::uint64_t structural = 0U;  ///< {}[]:,
+  std::uint64_t control = 0U;     ///< < 0x20
+};
+
+#if defined(ARCH_CPU_X86_FAMILY)
+Masks Classify(char const* p) {
+  auto const quote = _mm_set1_epi8('"');
+  auto const backslash = _mm_set1_epi8('\\');
+  auto const colon = _mm_set1_epi8(':');
+  auto const comma = _mm_set1_epi8(',');
+  // '[' and '{' differ only by 0x20, as do ']' and '}'
+  auto const case_bit = _mm_set1_epi8(0x20);
+  auto const open = _mm_set1_epi8('{');
+  auto const close = _mm_set1_epi8('}');
+  auto const max_control = _mm_set1_epi8(0x1F);
+  Masks m;
+  for (auto i = 0; i < 4; ++i) {
+    auto v = _mm_loadu_si128(reinterpret_cast<__m128i const*>(p + 16 * i));
+    auto bits = [i](__m128i eq) {
+      auto mask = static_cast<std::uint16_t>(_mm_movemask_epi8(eq));
+      return static_cast<std::uint64_t>(mask) << (16 * i);
+    };
+    auto folded = _mm_or_si128(v, case_bit);
+    auto brackets = _mm_or_si128(_mm_cmpeq_epi8(folded, open),
+                                 _mm_cmpeq_epi8(folded, close));
+    auto separators = _mm_or_si128(_mm_cmpeq_epi8(v, colon),
+                                   _mm_cmpeq_epi8(v, comma));
+    m.quote |= bits(_mm_cmpeq_epi8(v, quote));
+    m.backslash |= bits(_mm_cmpeq_epi8(v, backslash));
+    m.structural |= bits(_mm_or_si128(brackets, separators));
+    m.control |=
+        bits(_mm_cmpeq_epi8(_mm_max_epu8(v, max_control), max_control));
+  }
+  return m;
+}
+#elif defined(ARCH_CPU_ARM64)
+Masks Classify(char const* p) {
+  static constexpr std::uint8_t kBits[16] = {1, 2, 4,  8,  16, 32, 64, 128,
+                                             1, 2, 4,  8,  16, 32, 64, 128};
+  auto const weights = vld1q_u8(kBits);
+  Masks m;
+  for (auto i = 0; i < 4; ++i) {
+    auto v = vld1q_u8(reinterpret_cast<std::uint8_t const*>(p + 16 * i));
+    auto bits = [i, weights](uint8x16_t eq) {
+      auto w = vandq_u8(eq, weights);
+      auto lo = static_cast<std::uint64_t>(vaddv_u8(vget_low_u8(w)));
+      auto hi = static_cast<std::uint64_t>(vaddv_u8(vget_high_u8(w)));
+      return (lo | hi << 8) << (16 * i);
+    };
+    auto folded = vorrq_u8(v, vdupq_n_u8(0x20));
+    auto brackets = vorrq_u8(vceqq_u8(folded, vdupq_n_u8('{')),
+                             vceqq_u8(folded, vdupq_n_u8('}')));
+    auto separators = vorrq_u8(vceqq_u8(v, vdupq_n_u8(':')),
+                               vceqq_u8(v, vdupq_n_u8(',')));
+    m.quote |= bits(vceqq_u8(v, vdupq_n_u8('"')));
+    m.backslash |= bits(vceqq_u8(v, vdupq_n_u8('\\')));
+    m.structural |= bits(vorrq_u8(brackets, separators));
+    m.control |= bits(vcleq_u8(v, vdupq_n_u8(0x1F)));
+  }
+  return m;
+}
+#else
+Masks Classify(char const* p) {
+  Masks m;
+  for (auto i = 0UL; i < kBlock; ++i) {
+    auto c = static_cast<unsigned char>(p[i]);
+    auto bit = std::uint64_t{1} << i;
+    switch (c) {
+      case '"':
+        m.quote |= bit;
+        break;
+      case '\\':
+        m.backslash |= bit;
+        break;
+      case '{':
+      case '}':
+      case '[':
+      case ']':
+      case ':':
+      case ',':
+        m.structural |= bit;
+        break;
+      default:
+        if (c < 0x20U) {
+          m.control |= bit;
+        }
+    }
+  }
+  return m;
+}
+#endif
+
+/*! Each bit becomes the parity of itself and every bit below it */
+std::uint64_t PrefixXor(std::uint64_t x) {
+  for (auto shift = 1; shift < 64; shift *= 2) {
+    x ^= x << shift;
+  }
+  return x;
+}
+
+enum class Kind : std::uint8_t { Object, Array, String, EscapedString, Scalar };
+struct Node {
+  std::uint32_t begin;
+  std::uint32_t end;   ///< One past the last byte
+  std::uint32_t next;  ///< Index of the first node after this subtree
+  Kind kind;
+};
+bool IsSpace(char c) {
+  return c == ' ' || c == '\n' || c == '\r' || c == '\t';
+}
+/*! A number, true, false or null */
+bool IsScalar(std::string_view s) {
+  if (s == "true" || s == "false" || s == "null") {
+    return true;
+  }
+  std::size_t i = 0UL;
+  auto digit = [s, &i]() { return i < s.size() && base::IsAsciiDigit(s[i]); };
+  auto digits = [&digit, &i]() {
+    if (!digit()) {
+      return false;
+    }
+    while (digit()) {
+      ++i;
+    }
+    return true;
+  };
+  if (i < s.size() && s[i] == '-') {
+    ++i;
+  }
+  if (i < s.size() && s[i] == '0') {
+    ++i;
+  } else if (!digits()) {
+    return false;
+  }
+  if (i < s.size() && s[i] == '.') {
+    ++i;
+    if (!digits()) {
+      return false;
+    }
+  }
+  if (i < s.size() && (s[i] == 'e' || s[i] == 'E')) {
+    ++i;
+    if (i < s.size() && (s[i] == '+' || s[i] == '-')) {
+      ++i;
+    }
+    if (!digits()) {
+      return false;
+    }
+  }
+  return i == s.size();
+}
+std::optional<std::uint32_t> Hex4(std::string_view s, std::size_t at) {
+  if (s.size() < at + 4UL) {
+    return std::nullopt;
+  }
+  std::uint32_t rv = 0U;
+  for (auto c : s.substr(at, 4UL)) {
+    if (!base::IsHexDigit(c)) {
+      return std::nullopt;
+    }
+    rv = rv << 4 | static_cast<std::uint32_t>(base::HexDigitToInt(c));
+  }
+  return rv;
+}
+
+struct Doc {
+  std::string json;
+  std::vector<Node> nodes;
+
+  /*! \brief Stage 2: check the grammar and record nodes
+   *  \param tokens From stage 1
+   */
+  bool Build(std::vector<std::uint32_t> const& tokens);
+  std::string_view Text(Node const& n) const {
+    return std::string_view{json}.substr(n.begin, n.end - n.begin);
+  }
+  /*! \return What's between a string's quotes */
+  std::string_view Contents(Node const& n) const {
+    return std::string_view{json}.substr(n.begin + 1U, n.end - n.begin - 2U);
+  }
+};
+bool Doc::Build(std::vector<std::uint32_t> const& tokens) {
+  enum class Want { Value, ValueOrClose, KeyOrClose, Colon, CommaOrClose, End };
+  struct Open {
+    std::uint32_t node;
+    char close;
+  };
+  std::vector<Open> open;
+  auto want = Want::Value;
+  auto const n = json.size();
+  std::size_t t = 0UL;
+  std::size_t pos = json.starts_with(kByteOrderMark) ? kByteOrderMark.size()
+                                                     : 0UL;
+  nodes.reserve(tokens.size() / 2UL + 1UL);
+  auto add = [this](Kind k, std::size_t begin, std::size_t end) {
+    auto i = static_cast<std::uint32_t>(nodes.size());
+    nodes.push_back({static_cast<std::uint32_t>(begin),
+                     static_cast<std::uint32_t>(end), i + 1U, k});
+  };
+  auto after_value = [&open, &want]() {
+    want = open.empty() ? Want::End : Want::CommaOrClose;
+  };
+  // The opening quote is tokens[t]; the next token is its closing quote.
+  auto string = [&]() {
+    if (t + 1UL >= tokens.size() || json[tokens[t + 1UL]] != '"') {
+      return false;
+    }
+    auto end = tokens[t + 1UL] + 1UL;
+    auto contents = std::string_view{json}.substr(pos + 1UL, end - pos - 2UL);
+    auto escaped = contents.find('\\') != std::string_view::npos;
+    if (escaped && !Self::Unescape(contents)) {
+      return false;
+    }
+    add(escaped ? Kind::EscapedString : Kind::String, pos, end);
+    t += 2UL;
+    pos = end;
+    return true;
+  };
+  while (true) {
+    while (pos < n && IsSpace(json[pos])) {
+      ++pos;
+    }
+    if (pos == n) {
+      break;
+    }
+    auto c = json[pos];
+    auto token = t < tokens.size() && tokens[t] == pos;
+    switch (want) {
+      case Want::End:
+        return false;
+      case Want::Colon:
+        if (!token || c != ':') {
+          return false;
+        }
+        ++t;
+        ++pos;
+        want = Want::Value;
+        continue;
+      case Want::CommaOrClose:
+        if (token && c == ',') {
+          ++t;
+          ++pos;
+          // A close may follow: trailing commas are allowed.
+          want = open.back().close == '}' ? Want::KeyOrClose
+                                          : Want::ValueOrClose;
+          continue;
+        }
+        break;
+      case Want::KeyOrClose:
+        if (token && c == '"') {
+          if (!string()) {
+            return false;
+          }
+          want = Want::Colon;
+          continue;
+        }
+        break;
+      case Want::Value:
+      case Want::ValueOrClose:
+        if (!token) {
+          auto end = t < tokens.size() ? tokens[t] : n;
+          auto text = std::string_view{json}.substr(pos, end - pos);
+          while (IsSpace(text.back())) {
+            text.remove_suffix(1UL);
+          }
+          if (!IsScalar(text)) {
+            return false;
+          }
+          add(Kind::Scalar, pos, pos + text.size());
+          pos += text.size();
+          after_value();
+          continue;
+        }
+        if (c == '"') {
+          if (!string()) {
+            return false;
+          }
+          after_value();
+          continue;
+        }
+        if (c == '{' || c == '[') {
+          if (open.size() >= Self::kMaxDepth) {
+            return false;
+          }
+          auto object = c == '{';
+          open.push_back({static_cast<std::uint32_t>(nodes.size()),
+                          object ? '}' : ']'});
+          add(object ? Kind::Object : Kind::Array, pos, pos);
+          ++t;
+          ++pos;
+          want = object ? Want::KeyOrClose : Want::ValueOrClose;
+          continue;
+        }
+        break;
+    }
+    // All that could still be valid here is closing the innermost container.
+    if (want == Want::Value || !token || c != open.back().close) {
+      return false;
+    }
+    auto& container = nodes[open.back().node];
+    container.end = static_cast<std::uint32_t>(pos + 1UL);
+    container.next = static_cast<std::uint32_t>(nodes.size());
+    open.pop_back();
+    ++t;
+    ++pos;
+    after_value();
+  }
+  return want == Want::End && t == tokens.size();
+}
+
+/*! A cursor into a Doc, which it shares */
+class StructuralJsonValue final : public ipfs::DagJsonValue {
+ public:
+  StructuralJsonValue(std::shared_ptr<Doc const> doc, std::uint32_t node)
+      : doc_{std::move(doc)}, node_{node} {}
+  ~StructuralJsonValue() noexcept override = default;
+
+ private:
+  std::shared_ptr<Doc const> doc_;
+  std::uint32_t node_;
+
+  Node const& node() const { return doc_->nodes[node_]; }
+  std::string Decode(Node const& n) const {
+    auto contents = doc_->Contents(n);
+    if (n.kind == Kind::String) {
+      return std::string{contents};
+    }
+    // Checked while parsing
+    return Self::Unescape(contents).value_or("");
+  }
+
+  std::string pretty_print() const override {
+    // Only for debugging: just let Chromium do it.
+    auto text = doc_->Text(node());
+    auto v = base::JSONReader::Read(text, base::JSON_ALLOW_TRAILING_COMMAS);
+    return v ? v->DebugString() : std::string{text};
+  }
+  std::unique_ptr<DagJsonValue> operator[](std::string_view k) const override {
+    if (node().kind != Kind::Object) {
+      return {};
+    }
+    auto& nodes = doc_->nodes;
+    std::unique_ptr<DagJsonValue> rv;
+    for (auto i = node_ + 1U; i < node().next; i = nodes[i + 1U].next) {
+      auto& key = nodes[i];
+      auto match = key.kind == Kind::String ? doc_->Contents(key) == k
+                                            : Decode(key) == k;
+      // Keep going: of duplicate keys, the last wins, as with JSONReader.
+      if (match) {
+        rv = std::make_unique<StructuralJsonValue>(doc_, i + 1U);
+      }
+    }
+    return rv;
+  }
+  std::optional<std::string> get_if_string() const override {
+    auto& n = node();
+    if (n.kind == Kind::String || n.kind == Kind::EscapedString) {
+      return Decode(n);
+    }
+    return std::nullopt;
+  }
+  std::optional<std::vector<std::string>> object_keys() const override {
+    if (node().kind != Kind::Object) {
+      return std::nullopt;
+    }
+    auto& nodes = doc_->nodes;
+    std::vector<std::string> rv;
+    for (auto i = node_ + 1U; i < node().next; i = nodes[i + 1U].next) {
+      rv.push_back(Decode(nodes[i]));
+    }
+    // In the order, and as unique as, base::Value::Dict's.
+    std::sort(rv.begin(), rv.end());
+    rv.erase(std::unique(rv.begin(), rv.end()), rv.end());
+    return rv;
+  }
+  bool iterate_list(std::function<void(DagJsonValue const&)> cb) const override {
+    if (node().kind != Kind::Array) {
+      return false;
+    }
+    auto& nodes = doc_->nodes;
+    for (auto i = node_ + 1U; i < node().next; i = nodes[i].next) {
+      cb(StructuralJsonValue{doc_, i});
+    }
+    return true;
+  }
+};
+}  // namespace
+
+Self::~StructuralJsonParser() noexcept = default;
+
+auto Self::Parse(std::string_view j_str) -> std::unique_ptr<DagJsonValue> {
+  auto doc = std::make_shared<Doc>();
+  doc->json.assign(j_str);
+  auto tokens = Tokens(doc->json);
+  if (!tokens || !base::IsStringUTF8AllowingNoncharacters(doc->json) ||
+      !doc->Build(*tokens)) {
+    VLOG(1) << "Failed to parse JSON.";
+    return {};
+  }
+  return std::make_unique<StructuralJsonValue>(std::move(doc), 0U);
+}
+auto Self::Tokens(std::string_view json)
+    -> std::optional<std::vector<std::uint32_t>> {
+  if (json.size() > std::numeric_limits<std::uint32_t>::max()) {
+    return std::nullopt;
+  }
+  std::vector<std::uint32_t> rv;
+  rv.reserve(json.size() / 4UL);
+  std::uint64_t in_string = 0U;  // All ones if the last block ended in one
+  auto escape_next = false;
+  char tail[kBlock];
+  for (auto at = 0UL; at < json.size(); at += kBlock) {
+    auto const* p = json.data() + at;
+    if (json.size() - at < kBlock) {
+      std::memset(tail, ' ', kBlock);
+      std::memcpy(tail, p, json.size() - at);
+      p = tail;
+    }
+    auto m = Classify(p);
+    if (m.backslash || escape_next) {
+      // Whatever follows an unescaped backslash is escaped. Rare enough to
+      //   walk bit by bit.
+      std::uint64_t escaped = escape_next ? 1U : 0U;
+      escape_next = false;
+      for (auto b = m.backslash; b; b &= b - 1U) {
+        auto i = std::countr_zero(b);
+        if ((escaped >> i) & 1U) {
+          continue;
+        }
+        if (i == 63) {
+          escape_next = true;
+        } else {
+          escaped |= std::uint64_t{2} << i;
+        }
+      }
+      m.quote &= ~escaped;
+    }
+    // Set from each opening quote up to (not including) its closing one
+    auto inside = PrefixXor(m.quote) ^ in_string;
+    in_string = (inside >> 63) ? ~std::uint64_t{0} : 0U;
+    if (m.control & inside) {
+      return std::nullopt;
+    }
+    for (auto bits = (m.structural & ~inside) | m.quote; bits;
+         bits &= bits - 1U) {
+      rv.push_back(static_cast<std::uint32_t>(at + std::countr_zero(bits)));
+    }
+  }
+  if (in_string) {
+    return std::nullopt;
+  }
+  return rv;
+}
+auto Self::Unescape(std::string_view s) -> std::optional<std::string> {
+  std::string rv;
+  rv.reserve(s.size());
+  for (auto i = 0UL; i < s.size(); ++i) {
+    if (s[i] != '\\') {
+      rv.push_back(s[i]);
+      continue;
+    }
+    if (++i == s.size()) {
+      return std::nullopt;
+    }
+    switch (s[i]) {
+      case '"':
+      case '\\':
+      case '/':
+        rv.push_back(s[i]);
+        break;
+      case 'b':
+        rv.push_back('\b');
+        break;
+      case 'f':
+        rv.push_back('\f');
+        break;
+      case 'n':
+        rv.push_back('\n');
+        break;
+      case 'r':
+        rv.push_back('\r');
+        break;
+      case 't':
+        rv.push_back('\t');
+        break;
+      case 'u': {
+        auto cp = Hex4(s, i + 1UL);
+        if (!cp || (*cp >= 0xDC00U && *cp <= 0xDFFFU)) {
+          return std::nullopt;
+        }
+        i += 4UL;
+        if (*cp >= 0xD800U && *cp <= 0xDBFFU) {
+          if (s.substr(i + 1UL, 2UL) != "\\u") {
+            return std::nullopt;
+          }
+          auto low = Hex4(s, i + 3UL);
+          if (!low || *low < 0xDC00U || *low > 0xDFFFU) {
+            return std::nullopt;
+          }
+          i += 6UL;
+          *cp = 0x10000U + ((*cp - 0xD800U) << 10) + (*low - 0xDC00U);
+        }
+        base::WriteUnicodeCharacter(static_cast<base_icu::UChar32>(*cp), &rv);
+        break;
+      }
+      default:
+        return std::nullopt;
+    }
+  }
+  return rv;
+}
@@ -0,0 +1,56 @@
+#ifndef IPFS_STRUCTURAL_JSON_PARSER_H_
+#define IPFS_STRUCTURAL_JSON_PARSER_H_
+
+#include <ipfs_client/ctx/json_parser.h>
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace ipfs {
+
+/*!
+ * \brief A JSON parser for throughput: index first, decode on demand
+ * \details Two stages, after simdjson's design:
+ *    1. Classify the text 64 bytes at a time (SSE2 or NEON where available,
+ *       otherwise a byte loop) into bitmasks of quotes, backslashes,
+ *       structural characters and control characters. The escaped quotes are
+ *       removed and a prefix-XOR of the rest gives which bytes are inside
+ *       strings. What's left is the position of every token that matters.
+ *    2. Walk those positions once, checking the grammar and recording each
+ *       value's extent and where its subtree ends.
+ *    Nothing is decoded while parsing. Keys are compared in place, and a
+ *    string is unescaped when get_if_string asks for it. Accepts what
+ *    JsonParserAdapter does (RFC 8259 plus trailing commas), so either one
+ *    can be used; this one is behind kStructuralJson.
+ */
+class StructuralJsonParser final : public ctx::JsonParser {
+ public:
+  /*! Same as base::JSONReader's */
+  static constexpr std::size_t kMaxDepth = 200UL;
+
+  ~StructuralJsonParser() noexcept override;
+
+  /*!
+   * \brief Parse a JSON string into a DAG JSON node
+   * \param j_str The string representation of JSON, which is copied once
+   * \return nullptr if it isn't valid JSON
+   */
+  std::unique_ptr<DagJsonValue> Parse(std::string_view j_str) override;
+
+  /*! \brief Stage 1 alone
+   *  \return Offsets of structural characters and unescaped quotes, or
+   *    nullopt if a string is unterminated or holds a control character
+   */
+  static std::optional<std::vector<std::uint32_t>> Tokens(std::string_view);
+
+  /*! \brief Decode a JSON string's contents (between the quotes)
+   *  \return nullopt on a bad escape, or an unpaired surrogate
+   */
+  static std::optional<std::string> Unescape(std::string_view);
+};
+}  // namespace ipfs
+
+#endif  // IPFS_STRUCTURAL_JSON_PARSER_H_
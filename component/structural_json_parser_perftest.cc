@@ -0,0 +1,82 @@
+#include "structural_json_parser.h"
+
+#include "json_parser_adapter.h"
+
+#include <base/strings/stringprintf.h>
+#include <base/timer/elapsed_timer.h>
+#include <testing/gtest/include/gtest/gtest.h>
+#include <testing/perf/perf_result_reporter.h>
+
+#include <string>
+#include <utility>
+
+namespace {
+constexpr int kPasses = 20;
+
+/*! As test_server.py answers /routing */
+constexpr char kTestServerRouting[] =
+    R"({"Providers":[{"Addrs": ["/ip4/127.0.0.1/tcp/8080/http"],)"
+    R"("ID": "12D3KooWHEzPJNmo4shWendFFrxDNttYf8DW4eLC7M2JzuXHC1hE",)"
+    R"("Protocol": "transport-ipfs-gateway-http"}]})";
+
+/*! Shaped like a busy delegated routing (/routing/v1/providers) response */
+std::string LargeRouting() {
+  std::string rv = R"({"Providers":[)";
+  for (auto i = 0UL; i < 10000UL; ++i) {
+    base::StringAppendF(
+        &rv,
+        R"(%s{"Schema":"peer","ID":"12D3KooWProvider%zu",)"
+        R"("Addrs":["/ip4/10.0.%zu.%zu/tcp/4001",)"
+        R"("/dns4/node-%zu.example.net/tcp/443/wss"],)"
+        R"("Protocols":["transport-bitswap"],)"
+        R"("transport-bitswap":"gBI="})",
+        i ? "," : "", i, i / 256UL, i % 256UL, i);
+  }
+  return rv + "]}";
+}
+
+/*! Parse, then read every provider's ID */
+std::size_t Consume(ipfs::ctx::JsonParser& parser, std::string_view json) {
+  auto doc = parser.Parse(json);
+  if (!doc) {
+    return 0UL;
+  }
+  auto providers = (*doc)["Providers"];
+  std::size_t ids = 0UL;
+  providers->iterate_list([&ids](ipfs::DagJsonValue const& p) {
+    if (auto id = p["ID"]) {
+      ids += id->get_if_string().has_value();
+    }
+  });
+  return ids;
+}
+
+void Measure(std::string const& story,
+             std::string_view json,
+             std::size_t repeat,
+             std::size_t expected_ids) {
+  ipfs::JsonParserAdapter chromium;
+  ipfs::StructuralJsonParser structural;
+  using Entry = std::pair<char const*, ipfs::ctx::JsonParser*>;
+  for (auto [name, parser] : {Entry{"JsonParserAdapter", &chromium},
+                              Entry{"StructuralJsonParser", &structural}}) {
+    base::ElapsedTimer timer;
+    for (auto i = 0UL; i < repeat * kPasses; ++i) {
+      ASSERT_EQ(Consume(*parser, json), expected_ids) << name;
+    }
+    auto megabytes = static_cast<double>(json.size() * repeat * kPasses) / 1e6;
+    perf_test::PerfResultReporter reporter(name, story);
+    reporter.RegisterImportantMetric("throughput", "MB/s");
+    reporter.AddResult("throughput", megabytes / timer.Elapsed().InSecondsF());
+  }
+}
+}  // namespace
+
+TEST(StructuralJsonParserPerfTest, TestServerRouting) {
+  // Tiny, so per-parse overhead dominates.
+  Measure("test_server_routing", kTestServerRouting, 1000UL, 1UL);
+}
+
+TEST(StructuralJsonParserPerfTest, LargeRouting) {
+  Measure("providers_10000", LargeRouting(), 1UL, 10000UL);
+}
@@ -0,0 +1,120 @@
+#include "structural_json_parser.h"
+
+#include "json_parser_adapter.h"
+
+#include <base/strings/stringprintf.h>
+
+#include <gtest/gtest.h>
+
+#include <string>
+
+namespace {
+/*! Everything the resolver could ask of a value, as text to compare */
+std::string Describe(ipfs::DagJsonValue const& v) {
+  if (auto keys = v.object_keys()) {
+    std::string rv = "{";
+    for (auto& k : *keys) {
+      auto e = v[k];
+      rv.append(k).append(":").append(e ? Describe(*e) : "MISSING").append(",");
+    }
+    return rv + "}";
+  }
+  std::string rv = "[";
+  if (v.iterate_list([&rv](ipfs::DagJsonValue const& e) {
+        rv.append(Describe(e)).append(",");
+      })) {
+    return rv + "]";
+  }
+  if (auto s = v.get_if_string()) {
+    return '"' + *s + '"';
+  }
+  return "scalar";
+}
+/*! Both parsers agree on whether it's JSON, and if so on what it says */
+void ExpectSame(std::string_view json) {
+  auto expected = ipfs::JsonParserAdapter{}.Parse(json);
+  auto actual = ipfs::StructuralJsonParser{}.Parse(json);
+  ASSERT_EQ(!!actual, !!expected) << json;
+  if (expected) {
+    EXPECT_EQ(Describe(*actual), Describe(*expected)) << json;
+  }
+}
+}  // namespace
+
+TEST(StructuralJsonParserTest, AgreesWithJsonParserAdapter) {
+  for (auto json : {
+           // What test_server.py serves for /routing
+           R"({"Providers":[{"Addrs": ["/ip4/127.0.0.1/tcp/8080/http"],)"
+           R"("ID": "12D3KooWHEzPJNmo4shWendFFrxDNttYf8DW4eLC7M2JzuXHC1hE",)"
+           R"("Protocol": "transport-ipfs-gateway-http"}]})",
+           R"({"Providers":null})",
+           R"({"/":{"bytes":"aGVsbG8"}})",
+           R"({"Links":[{"/":"bafyreib"},{"/":"bafyreic"}],"n":-1.5e+3})",
+           R"("top level")",
+           "17",
+           "  [ true , false , null , 0 , -0.25 , 1E9 ]  ",
+           R"({"esc":"a\"b\\c\/d\né😀","key":1})",
+           R"({"dup":1,"dup":"second"})",
+           R"({"b":1,"a":2,"":3})",
+           "[1,2,]",
+           R"({"a":1,})",
+           "[[[[[[[[[[]]]]]]]]]]",
+           "\xEF\xBB\xBF{\"bom\":1}",
+           R"({"utf8":"héllo wörld ✓"})",
+           "",
+           "   ",
+           "[",
+           "[1 2]",
+           "[,]",
+           "[1,,2]",
+           R"({"a" 1})",
+           R"({"a":1 "b":2})",
+           R"({1:2})",
+           R"({"a":})",
+           "[01]",
+           "[1.]",
+           "[.5]",
+           "[1e]",
+           "[+1]",
+           "[tru]",
+           "[nulll]",
+           R"(["unterminated])",
+           R"(["bad \x escape"])",
+           R"(["lone \ud800 surrogate"])",
+           R"(["\udc00"])",
+           "[\"tab\tinside\"]",
+           "[\"newline\ninside\"]",
+           "[1]]",
+           "{}}",
+           "[1] 2",
+           "[\"\xC3\x28\"]",
+           R"(["a"]x)",
+       }) {
+    ExpectSame(json);
+  }
+}
+
+TEST(StructuralJsonParserTest, EscapedQuotesAcrossBlocks) {
+  // Backslash runs landing on each side of the 64-byte block boundaries.
+  for (auto pad = 0; pad < 70; ++pad) {
+    auto json = base::StringPrintf(R"(["%s\\", "\"%s\\\\\"", "]"])",
+                                   std::string(pad, 'x').c_str(),
+                                   std::string(pad % 7, '\\').c_str());
+    ExpectSame(json);
+  }
+}
+
+TEST(StructuralJsonParserTest, Tokens) {
+  auto tokens = ipfs::StructuralJsonParser::Tokens(R"({"a:[":[1,"\""]})");
+  ASSERT_TRUE(tokens);
+  // {, "a:[" quotes, :, [, ",", the quotes of "\"", ], }
+  std::vector<std::uint32_t> expected{0, 1, 5, 6, 7, 9, 10, 13, 14, 15};
+  EXPECT_EQ(*tokens, expected);
+  EXPECT_FALSE(ipfs::StructuralJsonParser::Tokens(R"(["open)"));
+}
+
+TEST(StructuralJsonParserTest, DeepNesting) {
+  auto k = ipfs::StructuralJsonParser::kMaxDepth;
+  ExpectSame(std::string(k, '[') + std::string(k, ']'));
+  ExpectSame(std::string(k + 1UL, '[') + std::string(k + 1UL, ']'));
+}
@@ -0,0 +1,78 @@
+#include <base/timer/elapsed_timer.h>
+#include <testing/gtest/include/gtest/gtest.h>
+#include <testing/perf/perf_result_reporter.h>
+#include <url/gurl.h>
+
+#include <string>
+#include <utility>
+
+namespace {
+constexpr int kPasses = 2000;
+
+/*! Already canonical: the fast path */
+constexpr char const* kCidV1[] = {
+    "ipfs://bafybeigdyrzt5sfp7udm7hu76uh7y26nf3efuylqabf3oclgtqy55fbzdi/",
+    "ipfs://bafkreigh2akiscaildcqabsyg3dfr6chu3fgpregiymsck7e7aqa4s52zy/",
+    "ipfs://bafybeifszd4wbkeekwzwitvgijrw6zkzijxutm4kdumkxnc6677drtslni/"
+    "wiki/index.html?q=1#top",
+};
+/*! Rewritten to CIDv1 base32: decoded once, then memoized */
+constexpr char const* kCidV0[] = {
+    "ipfs://QmPZ9gcCEpqKTo6aq61g2nXGUhM4iCL3ewB6LDXZCtioEB/",
+    "ipfs://QmbWqxBEKC3P8tqsKc98xmWNzrzDtRLMiMPL8wBuTGsMnR/readme",
+    "ipfs://BAFYBEIGDYRZT5SFP7UDM7HU76UH7Y26NF3EFUYLQABF3OCLGTQY55FBZDI/a.png",
+};
+
+void Report(std::string const& story, base::TimeDelta per_url) {
+  perf_test::PerfResultReporter reporter("CanonicalizeIpfsURL", story);
+  reporter.RegisterImportantMetric("gurl", "ns");
+  reporter.AddResult("gurl", per_url.InNanosecondsF());
+}
+template <std::size_t N>
+void Measure(std::string const& story, char const* const (&urls)[N]) {
+  std::size_t valid = 0UL;
+  base::ElapsedTimer timer;
+  for (auto p = 0; p < kPasses; ++p) {
+    for (auto u : urls) {
+      valid += GURL{u}.is_valid();
+    }
+  }
+  Report(story, timer.Elapsed() / (kPasses * N));
+  EXPECT_EQ(valid, kPasses * N);
+}
+}  // namespace
+
+TEST(UrlCanonIpfsPerfTest, AlreadyCanonical) {
+  Measure("cidv1_base32", kCidV1);
+  for (auto u : kCidV1) {
+    EXPECT_EQ(GURL{u}.spec(), u);
+  }
+}
+
+TEST(UrlCanonIpfsPerfTest, Rewritten) {
+  Measure("cidv0_and_uppercase", kCidV0);
+  EXPECT_EQ(GURL{kCidV0[2]}.host(),
+            "bafybeigdyrzt5sfp7udm7hu76uh7y26nf3efuylqabf3oclgtqy55fbzdi");
+}
+
+TEST(UrlCanonIpfsPerfTest, Utf16LongUrl) {
+  // Longer than the 2048 characters that used to be converted on the stack.
+  std::string path(4096UL, 'p');
+  std::u16string canonical =
+      u"ipfs://bafybeigdyrzt5sfp7udm7hu76uh7y26nf3efuylqabf3oclgtqy55fbzdi/";
+  canonical.append(path.begin(), path.end());
+  std::u16string v0 = u"ipfs://QmPZ9gcCEpqKTo6aq61g2nXGUhM4iCL3ewB6LDXZCtioEB/";
+  v0.append(path.begin(), path.end());
+  for (auto [story, url] : {std::pair{"utf16_cidv1_4k_path", &canonical},
+                            std::pair{"utf16_cidv0_4k_path", &v0}}) {
+    std::size_t valid = 0UL;
+    base::ElapsedTimer timer;
+    for (auto p = 0; p < kPasses; ++p) {
+      valid += GURL{*url}.is_valid();
+    }
+    Report(story, timer.Elapsed() / kPasses);
+    EXPECT_EQ(valid, static_cast<std::size_t>(kPasses));
+  }
+  EXPECT_EQ(GURL{v0}.path().size(), path.size() + 1UL);
+  EXPECT_EQ(GURL{v0}.host().substr(0UL, 4UL), "bafy");
+}
@@ -0,0 +1,73 @@
+#include <url/gurl.h>
+
+#include <gtest/gtest.h>
+
+#include <string>
+
+namespace {
+/*! Starts like a raw sha2-256 CIDv1, then zeros: only a CID at length 59.
+ *  At other lengths only the fast path leaves its text alone; decoding it
+ *  would turn it into an identity CID holding an error message.
+ */
+std::string LooksLikeCid(std::size_t length) {
+  std::string rv{"bafkrei"};
+  rv.resize(length, 'a');
+  return rv;
+}
+std::string HostOf(std::string const& host) {
+  return GURL{"ipfs://" + host + "/a/b.html"}.host();
+}
+}  // namespace
+
+TEST(UrlCanonIpfsTest, FastPathTakesCidV1Sha256) {
+  // 'b' + 58 characters of base32: the usual sha2-256 CIDv1.
+  auto fake = LooksLikeCid(59UL);
+  EXPECT_EQ(HostOf(fake), fake);
+  for (auto real :
+       {"bafybeigdyrzt5sfp7udm7hu76uh7y26nf3efuylqabf3oclgtqy55fbzdi",
+        "bafkreigh2akiscaildcqabsyg3dfr6chu3fgpregiymsck7e7aqa4s52zy"}) {
+    EXPECT_EQ(HostOf(real), real);
+  }
+}
+
+TEST(UrlCanonIpfsTest, FastPathLengthExcludesMultibasePrefix) {
+  // Whole bytes encode to 0, 2, 4, 5 or 7 base32 characters past a multiple
+  //   of 8; anything else must be decoded (and here, rejected).
+  for (auto base32 = 8UL; base32 < 72UL; ++base32) {
+    auto host = LooksLikeCid(base32 + 1UL);
+    switch (base32 % 8UL) {
+      case 1UL:
+      case 3UL:
+      case 6UL:
+        EXPECT_NE(HostOf(host), host) << base32;
+        break;
+      default:
+        EXPECT_EQ(HostOf(host), host) << base32;
+    }
+  }
+}
+
+TEST(UrlCanonIpfsTest, FastPathChecksVersionAndPadding) {
+  // Version 0, then version 2: lower-case base32, but not a CIDv1
+  for (auto prefix : {"baa", "bai"}) {
+    auto host = prefix + LooksLikeCid(59UL).substr(3UL);
+    EXPECT_NE(HostOf(host), host) << prefix;
+  }
+  // 58 base32 characters hold 36 bytes and 2 bits, which must be zero.
+  std::string padded{
+      "bafkreigh2akiscaildcqabsyg3dfr6chu3fgpregiymsck7e7aqa4s52zz"};
+  EXPECT_NE(HostOf(padded), padded);
+  padded.back() = 'y';
+  EXPECT_EQ(HostOf(padded), padded);
+}
+
+TEST(UrlCanonIpfsTest, OthersAreRewritten) {
+  auto upper = LooksLikeCid(59UL);
+  for (auto& c : upper) {
+    c = static_cast<char>(c - 'a' + 'A');
+  }
+  EXPECT_NE(HostOf(upper), upper);
+  EXPECT_EQ(
+      HostOf("BAFYBEIGDYRZT5SFP7UDM7HU76UH7Y26NF3EFUYLQABF3OCLGTQY55FBZDI"),
+      "bafybeigdyrzt5sfp7udm7hu76uh7y26nf3efuylqabf3oclgtqy55fbzdi");
+}
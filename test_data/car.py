@@ -0,0 +1,188 @@
+"""
+Just enough CID, dag-pb & CARv1 handling to serve and check trustless CAR
+responses built from the blocks/ directory. Shared by test_server.py and
+car_batch_bench.py.
+"""
+
+import base64
+import os
+from os.path import join
+
+B58 = '123456789ABCDEFGHJKLMNPQRSTUVWXYZabcdefghijkmnopqrstuvwxyz'
+DAG_PB = 0x70
+
+
+def varint(n):
+    out = bytearray()
+    while True:
+        b = n & 0x7F
+        n >>= 7
+        if n:
+            out.append(b | 0x80)
+        else:
+            out.append(b)
+            return bytes(out)
+
+
+def read_varint(b, i=0):
+    result = shift = 0
+    while True:
+        x = b[i]
+        i += 1
+        result |= (x & 0x7F) << shift
+        shift += 7
+        if not x & 0x80:
+            return result, i
+
+
+def b58decode(s):
+    n = 0
+    for c in s:
+        n = n * 58 + B58.index(c)
+    raw = n.to_bytes((n.bit_length() + 7) // 8, 'big')
+    return b'\0' * (len(s) - len(s.lstrip('1'))) + raw
+
+
+def b58encode(b):
+    n = int.from_bytes(b, 'big')
+    out = ''
+    while n:
+        n, r = divmod(n, 58)
+        out = B58[r] + out
+    return '1' * (len(b) - len(b.lstrip(b'\0'))) + out
+
+
+def cid_to_bytes(s):
+    """String CID -> binary. CIDv0 binary is the bare multihash."""
+    if s.startswith('Qm'):
+        return b58decode(s)
+    if s.startswith('b'):
+        body = s[1:].upper()
+        return base64.b32decode(body + '=' * (-len(body) % 8))
+    raise ValueError(f'Unsupported multibase: {s}')
+
+
+def cid_to_str(b):
+    """Binary CID -> the string form used for file names in blocks/"""
+    if b[:2] == b'\x12\x20':
+        return b58encode(b)
+    return 'b' + base64.b32encode(b).decode().lower().rstrip('=')
+
+
+def cid_length(b, i=0):
+    """Length of the binary CID starting at b[i]"""
+    if b[i:i + 2] == b'\x12\x20':
+        return 34
+    j = i
+    _, j = read_varint(b, j)  # version
+    _, j = read_varint(b, j)  # codec
+    _, j = read_varint(b, j)  # hash type
+    n, j = read_varint(b, j)  # digest length
+    return j + n - i
+
+
+def is_dag_pb(cid_bytes):
+    if cid_bytes[:2] == b'\x12\x20':
+        return True
+    _, j = read_varint(cid_bytes)
+    codec, _ = read_varint(cid_bytes, j)
+    return codec == DAG_PB
+
+
+def pb_fields(b):
+    i = 0
+    while i < len(b):
+        key, i = read_varint(b, i)
+        field, wire = key >> 3, key & 7
+        if wire == 0:
+            v, i = read_varint(b, i)
+            yield field, v
+        elif wire == 2:
+            n, i = read_varint(b, i)
+            yield field, b[i:i + n]
+            i += n
+        else:
+            raise ValueError(f'Unexpected wire type {wire}')
+
+
+def dag_pb_node(block):
+    """-> (list of binary child CIDs, UnixFS type or None)"""
+    links = []
+    unixfs_type = None
+    for field, v in pb_fields(block):
+        if field == 2:
+            links.extend(h for f, h in pb_fields(v) if f == 1)
+        elif field == 1:
+            unixfs_type = next((t for f, t in pb_fields(v) if f == 1), None)
+    return links, unixfs_type
+
+
+UNIXFS_FILE = 2
+
+
+class BlockStore:
+    def __init__(self, directory):
+        self.directory = directory
+
+    def get(self, cid_bytes):
+        try:
+            with open(join(self.directory, cid_to_str(cid_bytes)), 'rb') as f:
+                return f.read()
+        except OSError:
+            return None
+
+    def walk(self, root, scope):
+        """Yield (cid bytes, block) in the order a gateway would send them.
+        Missing blocks are skipped, as a partial CAR is still useful here."""
+        stack = [(root, True)]
+        seen = set()
+        while stack:
+            cid, is_root = stack.pop()
+            if cid in seen:
+                continue
+            seen.add(cid)
+            block = self.get(cid)
+            if block is None:
+                continue
+            yield cid, block
+            if scope == 'block' or not is_dag_pb(cid):
+                continue
+            links, unixfs_type = dag_pb_node(block)
+            # entity: all of a file, but only the node itself for a directory
+            if scope == 'entity' and is_root and unixfs_type != UNIXFS_FILE:
+                continue
+            stack.extend((link, False) for link in reversed(links))
+
+
+def car_header(root):
+    # DAG-CBOR {"roots": [CID], "version": 1}, keys in length-first order
+    link = b'\x00' + root
+    cbor = (b'\xa2' + b'\x65roots' + b'\x81' + b'\xd8\x2a' +
+            bytes([0x40 + len(link)] if len(link) < 24 else [0x58, len(link)]) + link +
+            b'\x67version' + b'\x01')
+    return varint(len(cbor)) + cbor
+
+
+def build_car(store, root, scope='all'):
+    out = bytearray(car_header(root))
+    for cid, block in store.walk(root, scope):
+        out += varint(len(cid) + len(block)) + cid + block
+    return bytes(out)
+
+
+def read_car(data):
+    """-> list of (cid bytes, block) from a CARv1"""
+    n, i = read_varint(data)
+    i += n
+    result = []
+    while i < len(data):
+        n, i = read_varint(data, i)
+        section = data[i:i + n]
+        i += n
+        c = cid_length(section)
+        result.append((section[:c], section[c:]))
+    return result
+
+
+def default_store():
+    return BlockStore(join(os.path.dirname(__file__), 'blocks'))
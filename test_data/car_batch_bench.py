@@ -0,0 +1,88 @@
+#!/usr/bin/env python3
+"""
+Benchmark: fetching a node's children one block at a time, versus one CAR.
+
+Run test_server.py first, then
+  ./car_batch_bench.py 8080
+  ./car_batch_bench.py 8080 --rtt-ms 40 --concurrency 6 ROOT_CID
+
+The individual fetches mimic what happens without batching - one
+application/vnd.ipld.raw request per child, at most --concurrency at a time
+(6 = Chromium's HTTP/1.1 per-host limit). The batched fetch is the single
+application/vnd.ipld.car request CarBatcher would make for the same parent.
+--rtt-ms adds a simulated round trip to every request, since a local server
+has none. Blocks from the CAR are checked against the individual responses.
+"""
+
+import argparse
+import sys
+import time
+import urllib.request
+from concurrent.futures import ThreadPoolExecutor
+
+import car
+
+DEFAULT_ROOT = 'bafybeihttif5tsjpdrmbgb644kmbfl4dnrx4agjqvxgj3az7dwh6s5sueu'
+
+
+def fetch(base, cid, accept, query='', rtt=0.0):
+    req = urllib.request.Request(f'{base}/ipfs/{cid}{query}', headers={'Accept': accept})
+    time.sleep(rtt)
+    try:
+        with urllib.request.urlopen(req) as resp:
+            return resp.read()
+    except urllib.error.HTTPError:
+        return None
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    ap.add_argument('port', type=int)
+    ap.add_argument('root', nargs='?', default=DEFAULT_ROOT)
+    ap.add_argument('--concurrency', type=int, default=6)
+    ap.add_argument('--rtt-ms', type=float, default=0.0)
+    ap.add_argument('--repeat', type=int, default=3)
+    args = ap.parse_args()
+    base = f'http://localhost:{args.port}'
+    rtt = args.rtt_ms / 1000
+
+    root_block = fetch(base, args.root, 'application/vnd.ipld.raw')
+    if root_block is None:
+        print(f'{args.root} not found on the test server', file=sys.stderr)
+        return 1
+    links, unixfs_type = car.dag_pb_node(root_block)
+    children = [car.cid_to_str(link) for link in links]
+    scope = 'entity' if unixfs_type == car.UNIXFS_FILE else 'all'
+    print(f'{args.root}: {len(children)} children, dag-scope={scope}')
+
+    individual = {}
+    best_single = best_car = float('inf')
+    for _ in range(args.repeat):
+        began = time.monotonic()
+        with ThreadPoolExecutor(args.concurrency) as pool:
+            bodies = pool.map(lambda c: fetch(base, c, 'application/vnd.ipld.raw', rtt=rtt), children)
+            individual = dict(zip(children, bodies))
+        best_single = min(best_single, time.monotonic() - began)
+
+        began = time.monotonic()
+        car_bytes = fetch(base, args.root, 'application/vnd.ipld.car', f'?dag-scope={scope}', rtt)
+        best_car = min(best_car, time.monotonic() - began)
+
+    found = {k: v for k, v in individual.items() if v is not None}
+    from_car = {car.cid_to_str(c): b for c, b in car.read_car(car_bytes or b'')}
+    mismatched = [c for c, b in found.items() if from_car.get(c) != b]
+    missing = [c for c in found if c not in from_car]
+    print(f'individual: {len(children)} requests, {sum(map(len, found.values()))} bytes, '
+          f'{best_single * 1000:.1f} ms')
+    print(f'CAR:        1 request, {len(car_bytes or b"")} bytes, {len(from_car)} blocks, '
+          f'{best_car * 1000:.1f} ms')
+    print(f'speed-up {best_single / best_car:.1f}x; '
+          f'{len(found) - len(missing)}/{len(found)} children demultiplexed from the CAR')
+    if mismatched or missing:
+        print(f'MISMATCH: {len(mismatched)} differ, {len(missing)} missing', file=sys.stderr)
+        return 2
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -0,0 +1,315 @@
+#!/usr/bin/env python3
+"""
+Stand-in gateway for benchmarking how the browser spreads load over gateways.
+
+Serves the same trustless responses as test_server.py (blocks/, cars/, names/)
+but over either HTTP/1.1 or HTTP/2, with an artificial per-request latency.
+It keeps track of how many requests it had in flight at once and how long
+they took, and prints a summary on ^C (or every --report seconds).
+
+  ./gateway_standin.py --proto h1 --port 8081 --latency-ms 40
+  ./gateway_standin.py --proto h2 --port 8443 --latency-ms 40 \
+      --cert cert.pem --key key.pem
+
+HTTP/2 needs TLS (browsers only negotiate h2 via ALPN) and the 'h2' package.
+A throwaway certificate can be made with
+  openssl req -x509 -newkey rsa:2048 -nodes -days 9 -subj /CN=localhost \
+      -keyout key.pem -out cert.pem
+and the browser started with --ignore-certificate-errors.
+
+To benchmark, point the ipfs.gateway preferences at one h1 and one h2
+stand-in (e.g. "http://localhost:8081/" and "https://localhost:8443/"),
+load a large directory listing or file, and compare the two summaries:
+the h1 stand-in should never see more than 6 concurrent requests, while
+the h2 one should see many more and finish its share sooner.
+
+--pool runs several HTTP/1.1 stand-ins at once, each with its own latency
+distribution, for benchmarking how requests get spread (or hedged) across
+gateways. Each is PORT:DIST:PARAMS, where DIST is one of
+  gauss:MEAN,JITTER          normal, in ms
+  lognormal:MEDIAN,SIGMA     heavy-tailed, median in ms
+  bimodal:FAST,SLOW,P        FAST ms, except SLOW ms with probability P
+e.g.
+  ./gateway_standin.py --seed 7 --report 10 --pool \
+      8081:lognormal:30,0.4 8082:lognormal:80,0.6 8083:bimodal:40,2000,0.05
+
+Samples come from a per-port generator seeded with --seed, so a given
+sequence of requests sees the same latencies from run to run. The summary
+includes how many requests the pool got per distinct path: 1.0 means no
+duplicates at all, racing every request to all N gateways gives N. Point
+ipfs.gateway at exactly the pool's gateways, clear the cache, then load the
+same content with ipfs.hedging.enabled true & false to compare.
+"""
+
+import argparse
+import asyncio
+import math
+import random
+import ssl
+import sys
+import threading
+import time
+from http.server import BaseHTTPRequestHandler, ThreadingHTTPServer
+from os.path import dirname, join
+
+here = dirname(__file__)
+
+
+class Stats:
+    def __init__(self, name):
+        self.name = name
+        self.lock = threading.Lock()
+        self.in_flight = 0
+        self.max_in_flight = 0
+        self.durations = []
+        self.paths = set()
+        self.first = None
+        self.last = None
+
+    def begin(self, path=None):
+        with self.lock:
+            self.paths.add(path)
+            now = time.monotonic()
+            if self.first is None:
+                self.first = now
+            self.in_flight += 1
+            self.max_in_flight = max(self.max_in_flight, self.in_flight)
+            return now
+
+    def end(self, began):
+        with self.lock:
+            now = time.monotonic()
+            self.in_flight -= 1
+            self.last = now
+            self.durations.append(now - began)
+
+    def report(self):
+        with self.lock:
+            d = sorted(self.durations)
+            if not d:
+                print(f'{self.name}: no requests yet')
+                return
+            span = (self.last or self.first) - self.first
+            p50 = d[len(d) // 2] * 1000
+            p90 = d[int(len(d) * 0.9)] * 1000
+            print(f'{self.name}: {len(d)} requests over {span:.2f}s, '
+                  f'max {self.max_in_flight} concurrent, '
+                  f'p50 {p50:.0f}ms p90 {p90:.0f}ms', flush=True)
+
+
+def resolve(path):
+    """Map a gateway request path to a file, the same way test_server.py does"""
+    components = path.split('?')[0].split('/')
+    if len(components) < 3:
+        return None
+    match components[1]:
+        case 'ipfs':
+            sub = 'blocks' if len(components) == 3 else 'cars'
+            return join(here, sub, components[2])
+        case 'ipns':
+            return join(here, 'names', *components[2:])
+    return None
+
+
+def body_for(path):
+    fp = resolve(path)
+    if not fp:
+        return None
+    try:
+        with open(fp, 'rb') as f:
+            return f.read()
+    except OSError:
+        return None
+
+
+class Latency:
+    def __init__(self, dist, params, rng=random):
+        self.dist = dist
+        self.params = [p / 1000 for p in params[:2]] + list(params[2:])
+        self.rng = rng
+        self.lock = threading.Lock()
+        if dist == 'lognormal':
+            self.params = [math.log(self.params[0]), params[1]]
+
+    @staticmethod
+    def parse(spec, rng):
+        dist, _, params = spec.partition(':')
+        params = [float(p) for p in params.split(',')]
+        arity = {'gauss': 2, 'lognormal': 2, 'bimodal': 3}
+        if arity.get(dist) != len(params):
+            raise ValueError(f'Bad latency distribution: {spec}')
+        return Latency(dist, params, rng)
+
+    def sample(self):
+        with self.lock:
+            match self.dist:
+                case 'gauss':
+                    return max(0.0, self.rng.gauss(*self.params))
+                case 'lognormal':
+                    return self.rng.lognormvariate(*self.params)
+                case 'bimodal':
+                    fast, slow, p = self.params
+                    return slow if self.rng.random() < p else fast
+
+
+def serve_h1(args, stats, latency):
+    class Handler(BaseHTTPRequestHandler):
+        protocol_version = 'HTTP/1.1'
+
+        def do_GET(self):
+            began = stats.begin(self.path)
+            try:
+                time.sleep(latency.sample())
+                content = body_for(self.path)
+                if content is None:
+                    self.send_response(404)
+                    self.send_header('Content-Length', '0')
+                    self.end_headers()
+                    return
+                self.send_response(200)
+                self.send_header('Content-Type', self.headers.get('Accept') or 'application/octet-stream')
+                self.send_header('Content-Length', str(len(content)))
+                self.end_headers()
+                self.wfile.write(content)
+            finally:
+                stats.end(began)
+
+        def log_message(self, *_):
+            pass
+
+    server = ThreadingHTTPServer(('localhost', args.port), Handler)
+    if getattr(args, 'cert', None):
+        ctx = ssl.SSLContext(ssl.PROTOCOL_TLS_SERVER)
+        ctx.load_cert_chain(args.cert, args.key)
+        ctx.set_alpn_protocols(['http/1.1'])
+        server.socket = ctx.wrap_socket(server.socket, server_side=True)
+    print(f'HTTP/1.1 stand-in gateway on {args.port}', flush=True)
+    server.serve_forever()
+
+
+async def serve_h2(args, stats, latency):
+    import h2.config
+    import h2.connection
+    import h2.events
+    import h2.settings
+
+    async def respond(conn, writer, stream_id, path, accept):
+        began = stats.begin(path)
+        try:
+            await asyncio.sleep(latency.sample())
+            content = body_for(path)
+            if content is None:
+                conn.send_headers(stream_id, [(':status', '404'), ('content-length', '0')], end_stream=True)
+            else:
+                conn.send_headers(stream_id, [
+                    (':status', '200'),
+                    ('content-type', accept or 'application/octet-stream'),
+                    ('content-length', str(len(content))),
+                ])
+                window = conn.local_flow_control_window(stream_id)
+                while len(content) > window:
+                    conn.send_data(stream_id, content[:window])
+                    content = content[window:]
+                    writer.write(conn.data_to_send())
+                    await writer.drain()
+                    await asyncio.sleep(0)
+                    window = max(1, conn.local_flow_control_window(stream_id))
+                conn.send_data(stream_id, content, end_stream=True)
+            writer.write(conn.data_to_send())
+            await writer.drain()
+        finally:
+            stats.end(began)
+
+    async def handle(reader, writer):
+        conn = h2.connection.H2Connection(config=h2.config.H2Configuration(client_side=False))
+        conn.initiate_connection()
+        conn.update_settings({h2.settings.SettingCodes.MAX_CONCURRENT_STREAMS: 100})
+        writer.write(conn.data_to_send())
+        while True:
+            data = await reader.read(65535)
+            if not data:
+                break
+            for event in conn.receive_data(data):
+                if isinstance(event, h2.events.RequestReceived):
+                    hdrs = {k.decode() if isinstance(k, bytes) else k: v.decode() if isinstance(v, bytes) else v
+                            for k, v in event.headers}
+                    asyncio.ensure_future(respond(conn, writer, event.stream_id, hdrs.get(':path', '/'), hdrs.get('accept')))
+            writer.write(conn.data_to_send())
+            await writer.drain()
+
+    ctx = ssl.SSLContext(ssl.PROTOCOL_TLS_SERVER)
+    ctx.load_cert_chain(args.cert, args.key)
+    ctx.set_alpn_protocols(['h2'])
+    server = await asyncio.start_server(handle, 'localhost', args.port, ssl=ctx)
+    print(f'HTTP/2 stand-in gateway on {args.port}', flush=True)
+    async with server:
+        await server.serve_forever()
+
+
+def serve_pool(args):
+    pool = []
+    for spec in args.pool:
+        port, _, dist = spec.partition(':')
+        rng = random.Random(f'{args.seed}:{port}')
+        pool.append((int(port), Stats(f'{port} {dist}'), Latency.parse(dist, rng)))
+    for port, stats, latency in pool:
+        sub_args = argparse.Namespace(port=port)
+        threading.Thread(target=serve_h1, args=(sub_args, stats, latency), daemon=True).start()
+
+    def report():
+        for _, stats, _ in pool:
+            stats.report()
+        requests = sum(len(stats.durations) for _, stats, _ in pool)
+        paths = set().union(*(stats.paths for _, stats, _ in pool))
+        if paths:
+            print(f'pool: {requests} requests for {len(paths)} distinct paths, '
+                  f'{requests / len(paths):.2f} per path', flush=True)
+    return report
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    ap.add_argument('--proto', choices=['h1', 'h2'], default='h1')
+    ap.add_argument('--port', type=int)
+    ap.add_argument('--pool', nargs='+', metavar='PORT:DIST:PARAMS')
+    ap.add_argument('--seed', default='0')
+    ap.add_argument('--latency-ms', type=float, default=30.0)
+    ap.add_argument('--jitter-ms', type=float, default=0.0)
+    ap.add_argument('--cert')
+    ap.add_argument('--key')
+    ap.add_argument('--report', type=float, default=0.0, help='Print a summary every N seconds')
+    args = ap.parse_args()
+    if args.pool:
+        report = serve_pool(args)
+        try:
+            while True:
+                time.sleep(args.report or 3600)
+                report()
+        except KeyboardInterrupt:
+            pass
+        report()
+        return
+    if args.port is None:
+        ap.error('--port or --pool is required')
+    if args.proto == 'h2' and not (args.cert and args.key):
+        ap.error('h2 requires --cert and --key')
+    stats = Stats(f'{args.proto}:{args.port}')
+    latency = Latency('gauss', [args.latency_ms, args.jitter_ms])
+    if args.report > 0:
+        def tick():
+            while True:
+                time.sleep(args.report)
+                stats.report()
+        threading.Thread(target=tick, daemon=True).start()
+    try:
+        if args.proto == 'h1':
+            serve_h1(args, stats, latency)
+        else:
+            asyncio.run(serve_h2(args, stats, latency))
+    except KeyboardInterrupt:
+        pass
+    stats.report()
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -1,9 +1,13 @@
 #!/usr/bin/env python3
 
 import http.server
+import json
 import sys
 from os.path import dirname, isfile, join
 from sys import argv
+from urllib.parse import parse_qs, urlsplit
+
+import car
 
 here = dirname(__file__)
 
@@ -22,6 +26,9 @@ class Handler(http.server.BaseHTTPRequestHandler):
         components = self.path.split('/')
         match components[1]:
             case 'ipfs':
+                if len(components) == 3 and self.wants_car():
+                    self.respond_car(components[2])
+                    return
                 if len(components) == 3:
                     path = join(here, 'blocks', components[2])
                 else:
@@ -34,11 +41,62 @@ class Handler(http.server.BaseHTTPRequestHandler):
             case 'routing':
                 self.respond(join(here, 'gotit.json'))
                 return
+            case doh if doh.startswith('dns-query'):
+                self.respond_doh()
+                return
             case _ :
                 print(f"{self.path} ({components}) not handled request type ({components[0]})", file=sys.stderr)
                 exit(9)
         self.respond(path)
 
+    def wants_car(self):
+        query = parse_qs(urlsplit(self.path).query)
+        return ('application/vnd.ipld.car' in (self.headers.get('Accept') or '')
+                or query.get('format') == ['car'])
+
+    def respond_car(self, cid_component):
+        """Build a CAR from blocks/, honoring dag-scope (default all)"""
+        split = urlsplit(cid_component)
+        scope = parse_qs(split.query).get('dag-scope', ['all'])[0]
+        try:
+            root = car.cid_to_bytes(split.path)
+        except ValueError:
+            self.send_response(400)
+            self.end_headers()
+            return
+        store = car.default_store()
+        if store.get(root) is None:
+            self.send_response(404)
+            self.end_headers()
+            return
+        content = car.build_car(store, root, scope)
+        self.send_response(200)
+        self.send_header("Content-type", 'application/vnd.ipld.car; version=1')
+        self.send_header("Content-Length", str(len(content)))
+        self.end_headers()
+        self.wfile.write(content)
+
+    def respond_doh(self):
+        """DNS-over-HTTPS JSON API stand-in: _dnslink.NAME answers with the
+        path in names/NAME, e.g. point ipfs.dnslink.doh_resolvers at
+        http://localhost:PORT/dns-query"""
+        query = parse_qs(urlsplit(self.path).query)
+        name = query.get('name', [''])[0].rstrip('.')
+        answer = {'Status': 3}
+        if query.get('type', ['TXT'])[0].upper() in ('TXT', '16') and name.startswith('_dnslink.'):
+            path = join(here, 'names', name[len('_dnslink.'):])
+            if isfile(path):
+                with open(path) as f:
+                    target = f.read().strip()
+                answer = {'Status': 0, 'Answer': [
+                    {'name': name + '.', 'type': 16, 'TTL': 300, 'data': f'"dnslink={target}"'}]}
+        content = json.dumps(answer).encode('utf-8')
+        self.send_response(200)
+        self.send_header("Content-type", 'application/dns-json')
+        self.send_header("Content-Length", str(len(content)))
+        self.end_headers()
+        self.wfile.write(content)
+
     def respond(self, path):
         try:
             with open(path, 'rb') as f:
@@ -61,6 +119,7 @@ class Handler(http.server.BaseHTTPRequestHandler):
         except OSError as e:
             print('test server does not have access to ', path, e)
         self.send_response(404)
+        self.end_headers()
 
 try:
     server = http.server.HTTPServer(('localhost', int(argv[1])), Handler)